@@ -128,15 +128,32 @@ class PyGetSetDefTable(NamedEntity):
 
 METH_VARARGS = 'METH_VARARGS'
 
+# The "fastcall" calling convention (METH_FASTCALL), in which arguments are
+# passed as a C array rather than as a tuple (and dict), is only usable from
+# Python 3.7 onwards:
+FASTCALL_CONDITION = 'PY_VERSION_HEX >= 0x03070000'
+
 class PyMethodDef:
-    def __init__(self, name, fn_name, args, docstring):
+    def __init__(self, name, fn_name, args, docstring, fastcall_args=None):
         self.name = name
         self.fn_name = fn_name
         #assert args in ('METH_VARARGS', ) # FIXME
-        self.args = args        
+        self.args = args
         self.docstring = docstring
+        # The flags to use instead of "args" when the fastcall convention is
+        # available, if any:
+        self.fastcall_args = fastcall_args
 
     def c_defn(self):
+        if self.fastcall_args:
+            return ('#if %s\n' % FASTCALL_CONDITION +
+                    '    {(char*)"%(name)s",  %(fn_name)s, %(fastcall_args)s,\n'
+                    % self.__dict__ +
+                    '#else\n' +
+                    '    {(char*)"%(name)s",  %(fn_name)s, %(args)s,\n'
+                    % self.__dict__ +
+                    '#endif\n' +
+                    '     (char*)"%(docstring)s"},\n' % self.__dict__)
         return ('    {(char*)"%(name)s",  %(fn_name)s, %(args)s,\n'
                 '     (char*)"%(docstring)s"},\n' % self.__dict__)
 
@@ -156,6 +173,368 @@ class PyMethodTable(NamedEntity):
     def add_method(self, name, fn_name, args, docstring):
         self.methods.append(PyMethodDef(name, fn_name, args, docstring))
 
+    def add_parsed_method(self, parser, docstring, extra_flags=None):
+        """
+        Add an entry for the function generated by a PyArgParser, using
+        whichever calling convention it was built with
+        """
+        args, fastcall_args = parser.get_flags()
+        if extra_flags:
+            args = '%s | %s' % (extra_flags, args)
+            fastcall_args = '%s | %s' % (extra_flags, fastcall_args)
+        self.methods.append(PyMethodDef(parser.name,
+                                        '(PyCFunction)%s' % parser.identifier,
+                                        args, docstring,
+                                        fastcall_args=fastcall_args))
+
+def c_type_is_pointer(c_type):
+    return c_type.endswith('*')
+
+class PyArg:
+    """
+    A parameter of a function wrapped by a PyArgParser.
+
+    The code is one of the PyArg_ParseTuple format units "O", "O!", "s" or
+    "i".  Parameters with a default (a C expression) are optional.
+    """
+    def __init__(self, name, code, typeobj=None, c_type=None, default=None):
+        assert code in ('O', 'O!', 's', 'i')
+        if code == 'O!':
+            assert typeobj
+        self.name = name
+        self.code = code
+        self.typeobj = typeobj
+        if c_type is None:
+            c_type = {'O': 'PyObject *',
+                      'O!': 'PyObject *',
+                      's': 'const char *',
+                      'i': 'int'}[code]
+        self.c_type = c_type
+        self.default = default
+
+    def c_decl(self):
+        if c_type_is_pointer(self.c_type):
+            result = '    %s%s' % (self.c_type, self.name)
+        else:
+            result = '    %s %s' % (self.c_type, self.name)
+        if self.default is not None:
+            result += ' = %s' % self.default
+        return result + ';\n'
+
+class PyArgParser(NamedEntity):
+    """
+    A precomputed parser for the arguments of a function or method, in the
+    style of CPython's "Argument Clinic".
+
+    This generates the function "identifier", which converts its arguments
+    to C values, and passes them on to "impl_name" (which must be written by
+    hand), as:
+        PyObject *impl_name(selftype *self, <c_type of each arg>...);
+
+    Where the Python runtime supports it, the generated function uses the
+    METH_FASTCALL calling convention, so that calls to it don't allocate a
+    tuple (and dict) for the arguments.  Otherwise it falls back to
+    METH_VARARGS, and PyArg_ParseTuple(AndKeywords).
+    """
+    def __init__(self, identifier, name, impl_name, args,
+                 selftype='PyObject', keywords=True, is_static=True):
+        NamedEntity.__init__(self, identifier)
+        self.name = name
+        self.impl_name = impl_name
+        self.args = args
+        self.selftype = selftype
+        self.keywords = keywords
+        self.is_static = is_static
+
+        self.min_args = 0
+        for arg in args:
+            if arg.default is None:
+                # Required parameters can't follow optional ones:
+                assert self.min_args == args.index(arg)
+                self.min_args += 1
+
+    def get_flags(self):
+        """
+        Get a (flags, fastcall_flags) pair for use in a PyMethodDef
+        """
+        if self.keywords:
+            return ('METH_VARARGS | METH_KEYWORDS',
+                    'METH_FASTCALL | METH_KEYWORDS')
+        else:
+            return ('METH_VARARGS', 'METH_FASTCALL')
+
+    def get_format(self):
+        result = ''
+        for i, arg in enumerate(self.args):
+            if i == self.min_args:
+                result += '|'
+            result += arg.code
+        return result + ':' + self.name
+
+    def c_keywords_identifier(self):
+        return '%s_keywords' % self.identifier
+
+    def c_parser_identifier(self):
+        return '%s_parser' % self.identifier
+
+    def c_storage(self):
+        if self.is_static:
+            return 'static '
+        return ''
+
+    def c_impl_call(self):
+        result = '    return %s((%s *)self' % (self.impl_name, self.selftype)
+        for arg in self.args:
+            result += ', %s' % arg.name
+        return result + ');\n'
+
+    def c_fastcall_conversion(self, index, arg):
+        item = 'argv[%i]' % index
+        if arg.default is not None:
+            result = '    if (%s) {\n' % item
+            indent = '        '
+        else:
+            result = ''
+            indent = '    '
+        if arg.code == 'O':
+            result += indent + '%s = %s;\n' % (arg.name, item)
+        elif arg.code == 'O!':
+            result += (indent + '%s = (%s)cpybuilder_arg_as_instance(&%s, %i, %s, (PyTypeObject*)&%s);\n'
+                       % (arg.name, arg.c_type, self.c_parser_identifier(),
+                          index, item, arg.typeobj))
+        elif arg.code == 's':
+            result += (indent + '%s = cpybuilder_arg_as_string(&%s, %i, %s);\n'
+                       % (arg.name, self.c_parser_identifier(), index, item))
+        elif arg.code == 'i':
+            result += (indent + '%s = cpybuilder_arg_as_int(&%s, %i, %s);\n'
+                       % (arg.name, self.c_parser_identifier(), index, item))
+        if arg.code == 'i':
+            result += (indent + 'if (%s == -1 && PyErr_Occurred()) {\n'
+                       % arg.name)
+        elif arg.code != 'O':
+            result += indent + 'if (!%s) {\n' % arg.name
+        if arg.code != 'O':
+            result += indent + '    return NULL;\n'
+            result += indent + '}\n'
+        if arg.default is not None:
+            result += '    }\n'
+        return result
+
+    def c_defn(self):
+        n = len(self.args)
+        keywords = 'static const char *%s[] = {' % self.c_keywords_identifier()
+        for arg in self.args:
+            keywords += '"%s", ' % arg.name
+        keywords += 'NULL};\n'
+        # (the METH_VARARGS fallback only needs the names when keyword
+        # arguments are accepted; the fastcall version always uses them, for
+        # error messages)
+        result = ''
+        if self.keywords:
+            result += keywords + '\n'
+        result += '#if %s\n' % FASTCALL_CONDITION
+        if not self.keywords:
+            result += keywords + '\n'
+        result += ('static const struct cpybuilder_arg_parser %s = {\n'
+                   % self.c_parser_identifier())
+        result += '    "%s", %s, %i, %i\n' % (self.name,
+                                            self.c_keywords_identifier(),
+                                            self.min_args, n)
+        result += '};\n'
+        result += '\n'
+        result += '%sPyObject *\n' % self.c_storage()
+        if self.keywords:
+            result += ('%s(PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)\n'
+                       % self.identifier)
+        else:
+            result += ('%s(PyObject *self, PyObject *const *args, Py_ssize_t nargs)\n'
+                       % self.identifier)
+        result += '{\n'
+        result += '    PyObject *argv[%i];\n' % max(n, 1)
+        for arg in self.args:
+            result += arg.c_decl()
+        result += '\n'
+        result += ('    if (!cpybuilder_unpack_args(&%s, args, nargs, %s, argv)) {\n'
+                   % (self.c_parser_identifier(),
+                      'kwnames' if self.keywords else 'NULL'))
+        result += '        return NULL;\n'
+        result += '    }\n'
+        for i, arg in enumerate(self.args):
+            result += self.c_fastcall_conversion(i, arg)
+        result += self.c_impl_call()
+        result += '}\n'
+        result += '#else\n'
+        result += '%sPyObject *\n' % self.c_storage()
+        if self.keywords:
+            result += ('%s(PyObject *self, PyObject *args, PyObject *kwargs)\n'
+                       % self.identifier)
+        else:
+            result += '%s(PyObject *self, PyObject *args)\n' % self.identifier
+        result += '{\n'
+        for arg in self.args:
+            result += arg.c_decl()
+        result += '\n'
+        if self.keywords:
+            result += ('    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "%s", (char**)%s'
+                       % (self.get_format(), self.c_keywords_identifier()))
+        else:
+            result += '    if (!PyArg_ParseTuple(args, "%s"' % self.get_format()
+        for arg in self.args:
+            if arg.code == 'O!':
+                result += ',\n                          &%s, &%s' % (arg.typeobj, arg.name)
+            else:
+                result += ',\n                          &%s' % arg.name
+        result += ')) {\n'
+        result += '        return NULL;\n'
+        result += '    }\n'
+        result += self.c_impl_call()
+        result += '}\n'
+        result += '#endif /* %s */\n' % FASTCALL_CONDITION
+        result += '\n'
+        return result
+
+# Support code used by the functions generated by PyArgParser, emitted once
+# into each CompilationUnit that uses it (as "static inline", so that unused
+# helpers don't trigger warnings):
+ARG_PARSER_SUPPORT = '''
+#if %(condition)s
+#include <limits.h>
+
+struct cpybuilder_arg_parser {
+    const char *fname;
+    const char **keywords;
+    Py_ssize_t min_args;
+    Py_ssize_t max_args;
+};
+
+/*
+  Gather the positional and keyword arguments of a METH_FASTCALL call into
+  "out", which must have room for parser->max_args items.  The items are
+  borrowed references; those for omitted optional arguments are NULL.
+*/
+static inline int
+cpybuilder_unpack_args(const struct cpybuilder_arg_parser *parser,
+                       PyObject *const *args, Py_ssize_t nargs,
+                       PyObject *kwnames, PyObject **out)
+{
+    Py_ssize_t i, j, nkwargs;
+
+    if (nargs > parser->max_args) {
+        PyErr_Format(PyExc_TypeError,
+                     "%%s() takes at most %%zd argument(s) (%%zd given)",
+                     parser->fname, parser->max_args, nargs);
+        return 0;
+    }
+    for (i = 0; i < parser->max_args; i++) {
+        out[i] = (i < nargs) ? args[i] : NULL;
+    }
+
+    nkwargs = kwnames ? PyTuple_GET_SIZE(kwnames) : 0;
+    for (i = 0; i < nkwargs; i++) {
+        PyObject *kwname = PyTuple_GET_ITEM(kwnames, i);
+        for (j = 0; j < parser->max_args; j++) {
+            if (PyUnicode_CompareWithASCIIString(kwname,
+                                                 parser->keywords[j]) == 0) {
+                break;
+            }
+        }
+        if (j == parser->max_args) {
+            PyErr_Format(PyExc_TypeError,
+                         "'%%U' is an invalid keyword argument for %%s()",
+                         kwname, parser->fname);
+            return 0;
+        }
+        if (out[j]) {
+            PyErr_Format(PyExc_TypeError,
+                         "argument for %%s() given by name ('%%s')"
+                         " and position (%%zd)",
+                         parser->fname, parser->keywords[j], j + 1);
+            return 0;
+        }
+        out[j] = args[nargs + i];
+    }
+
+    for (i = 0; i < parser->min_args; i++) {
+        if (!out[i]) {
+            PyErr_Format(PyExc_TypeError,
+                         "%%s() missing required argument '%%s' (pos %%zd)",
+                         parser->fname, parser->keywords[i], i + 1);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* The equivalent of the "O!" format unit: */
+static inline PyObject *
+cpybuilder_arg_as_instance(const struct cpybuilder_arg_parser *parser,
+                           Py_ssize_t i, PyObject *obj, PyTypeObject *type)
+{
+    if (!PyObject_TypeCheck(obj, type)) {
+        PyErr_Format(PyExc_TypeError,
+                     "%%s() argument %%zd must be %%s, not %%s",
+                     parser->fname, i + 1,
+                     type->tp_name, Py_TYPE(obj)->tp_name);
+        return NULL;
+    }
+    return obj;
+}
+
+/* The equivalent of the "s" format unit: */
+static inline const char *
+cpybuilder_arg_as_string(const struct cpybuilder_arg_parser *parser,
+                         Py_ssize_t i, PyObject *obj)
+{
+    const char *result;
+    Py_ssize_t size;
+
+    if (!PyUnicode_Check(obj)) {
+        PyErr_Format(PyExc_TypeError,
+                     "%%s() argument %%zd must be str, not %%s",
+                     parser->fname, i + 1, Py_TYPE(obj)->tp_name);
+        return NULL;
+    }
+    result = PyUnicode_AsUTF8AndSize(obj, &size);
+    if (!result) {
+        return NULL;
+    }
+    if ((size_t)size != strlen(result)) {
+        PyErr_SetString(PyExc_ValueError, "embedded null character");
+        return NULL;
+    }
+    return result;
+}
+
+/* The equivalent of the "i" format unit; returns -1 with an exception set
+   on failure: */
+static inline int
+cpybuilder_arg_as_int(const struct cpybuilder_arg_parser *parser,
+                      Py_ssize_t i, PyObject *obj)
+{
+    long result;
+
+    if (PyFloat_Check(obj)) {
+        PyErr_Format(PyExc_TypeError,
+                     "%%s() argument %%zd must be int, not float",
+                     parser->fname, i + 1);
+        return -1;
+    }
+    result = PyLong_AsLong(obj);
+    if (result == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+    if (result > INT_MAX || result < INT_MIN) {
+        PyErr_Format(PyExc_OverflowError,
+                     "%%s() argument %%zd is out of range for a C int",
+                     parser->fname, i + 1);
+        return -1;
+    }
+    return (int)result;
+}
+#endif /* %(condition)s */
+
+''' % dict(condition=FASTCALL_CONDITION)
+
 # See http://docs.python.org/c-api/typeobj.html#number-structs
 class PyNumberMethods(NamedEntity):
     def __init__(self, identifier):
@@ -224,6 +603,47 @@ class PyNumberMethods(NamedEntity):
     def add_method(self, name, fn_name, args, docstring):
         self.methods.append(PyMethodDef(name, fn_name, args, docstring))
 
+# See http://docs.python.org/c-api/typeobj.html#sequence-structs
+class PySequenceMethods(NamedEntity):
+    def __init__(self, identifier, **kwargs):
+        NamedEntity.__init__(self, identifier)
+        self.__dict__.update(kwargs)
+
+    def c_defn(self):
+        result = 'static PySequenceMethods %s = {\n' % self.identifier
+        result += self.c_ptr_field('sq_length', 'lenfunc')
+        result += self.c_ptr_field('sq_concat', 'binaryfunc')
+        result += self.c_ptr_field('sq_repeat', 'ssizeargfunc')
+        result += self.c_ptr_field('sq_item', 'ssizeargfunc')
+        result += '#if PY_MAJOR_VERSION < 3\n'
+        result += self.c_ptr_field('sq_slice', 'ssizessizeargfunc')
+        result += self.c_ptr_field('sq_ass_item', 'ssizeobjargproc')
+        result += self.c_ptr_field('sq_ass_slice', 'ssizessizeobjargproc')
+        result += '#else\n'
+        result += self.c_ptr_field('was_sq_slice')
+        result += self.c_ptr_field('sq_ass_item', 'ssizeobjargproc')
+        result += self.c_ptr_field('was_sq_ass_slice')
+        result += '#endif\n'
+        result += self.c_ptr_field('sq_contains', 'objobjproc')
+        result += self.c_ptr_field('sq_inplace_concat', 'binaryfunc')
+        result += self.c_ptr_field('sq_inplace_repeat', 'ssizeargfunc')
+        result += '};\n'
+        return result
+
+# See http://docs.python.org/c-api/typeobj.html#mapping-structs
+class PyMappingMethods(NamedEntity):
+    def __init__(self, identifier, **kwargs):
+        NamedEntity.__init__(self, identifier)
+        self.__dict__.update(kwargs)
+
+    def c_defn(self):
+        result = 'static PyMappingMethods %s = {\n' % self.identifier
+        result += self.c_ptr_field('mp_length', 'lenfunc')
+        result += self.c_ptr_field('mp_subscript', 'binaryfunc')
+        result += self.c_ptr_field('mp_ass_subscript', 'objobjargproc')
+        result += '};\n'
+        return result
+
 class PyTypeObject(NamedEntity):
     def __init__(self, identifier, localname, tp_name, struct_name, **kwargs):
         NamedEntity.__init__(self, identifier)
@@ -408,6 +828,8 @@ class CompilationUnit:
         
         self._definitions = ''
 
+        self._have_arg_parser_support = False
+
     def add_include(self, path):
         self._includes += '#include "%s"\n' % path
 
@@ -437,6 +859,14 @@ class CompilationUnit:
                       "}\n\n")
         return identifier
 
+    def add_arg_parser(self, parser):
+        """Define the function generated by a PyArgParser"""
+        if not self._have_arg_parser_support:
+            self.add_defn(ARG_PARSER_SUPPORT)
+            self._have_arg_parser_support = True
+        self.add_defn(parser.c_defn())
+        return parser.identifier
+
     def add_simple_setter(self, identifier, typename, attrname, c_typecheck_fn, c_assignment):
         """Define a simple setter, suitable for use by a PyGetSetDef"""
         self.add_defn("static int\n" +
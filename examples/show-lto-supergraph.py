@@ -19,7 +19,7 @@
 # Show the "supergraph": the CFG of all functions, linked by
 # interproceduraledges:
 import gcc
-from gccutils.graph.supergraph import Supergraph
+from gccutils.graph.supergraph import CompactSupergraph
 from gccutils import invoke_dot
 
 # We'll implement this as a custom pass, to be called directly before
@@ -29,10 +29,15 @@ class ShowSupergraph(gcc.IpaPass):
     def execute(self):
         # (the callgraph should be set up by this point)
         if gcc.is_lto():
-            sg = Supergraph(split_phi_nodes=False,
-                            add_fake_entry_node=False)
-            dot = sg.to_dot('supergraph')
-            invoke_dot(dot)
+            sg = CompactSupergraph(split_phi_nodes=False,
+                                   add_fake_entry_node=False)
+            # Stream the graph to graphviz, clustered per function, and
+            # truncating any function with more than 200 statements, so
+            # that this is usable on real programs:
+            def write_dot(out):
+                sg.write_dot(out, 'supergraph',
+                             cluster=True, max_subgraph_nodes=200)
+            invoke_dot(write_dot)
 
 ps = ShowSupergraph(name='show-supergraph')
 ps.register_before('whole-program')
@@ -0,0 +1,33 @@
+#   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2012 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+# Sample python script, to be run by our gcc plugin
+# Write a summary of the part of the supergraph within each partition of a
+# link-time optimization, for merging afterwards via
+# gccutils.graph.partitions.MergedSupergraph (see docs/lto.rst)
+#
+# The summaries are written to the directory given by the
+# SUPERGRAPH_SUMMARY_DIR environment variable (or the current directory)
+import os
+
+from gccutils.graph.partitions import PartitionSummarizer
+
+# Only the LTRANS stage has the function bodies, reading each one in as it's
+# compiled, after the IPA passes (with -flto-partition=none, the single lto1
+# process has all of them), so ignore the functions compiled by cc1:
+PartitionSummarizer(os.environ.get('SUPERGRAPH_SUMMARY_DIR', '.'),
+                    lto_only=True).register()
@@ -44,6 +44,12 @@
 #include "opts.h"
 #include "rtl.h"
 
+/* gcc 5 moved the dominance API into its own header */
+#if (GCC_VERSION >= 5000)
+#include "dominance.h"
+#endif
+#include "cfgloop.h"
+
 #include "gcc-private-compat.h"
 
 /***********************************************************
@@ -269,6 +275,77 @@ gcc_cfg_block_for_each_rtl_insn (gcc_cfg_block block,
   return false;
 }
 
+/* Dominance queries.
+
+   GCC stores the dominator trees within the blocks themselves, so these
+   don't need to know which function the block is within, but the tree
+   must have been built (see gcc_function_calculate_dominance_info).  */
+GCC_IMPLEMENT_PUBLIC_API (gcc_cfg_block)
+gcc_cfg_block_get_immediate_dominator (gcc_cfg_block block)
+{
+  return gcc_private_make_cfg_block (get_immediate_dominator (CDI_DOMINATORS,
+                                                              block.inner));
+}
+
+GCC_IMPLEMENT_PUBLIC_API (gcc_cfg_block)
+gcc_cfg_block_get_immediate_postdominator (gcc_cfg_block block)
+{
+  return
+    gcc_private_make_cfg_block (get_immediate_dominator (CDI_POST_DOMINATORS,
+                                                         block.inner));
+}
+
+static bool
+for_each_dominated_block (enum cdi_direction dir,
+                          gcc_cfg_block block,
+                          bool (*cb) (gcc_cfg_block block, void *user_data),
+                          void *user_data)
+{
+  basic_block son;
+
+  for (son = first_dom_son (dir, block.inner);
+       son;
+       son = next_dom_son (dir, son))
+    {
+      if (cb (gcc_private_make_cfg_block (son), user_data))
+        {
+          return true;
+        }
+    }
+
+  return false;
+}
+
+GCC_IMPLEMENT_PUBLIC_API (bool)
+gcc_cfg_block_for_each_dominated_block (gcc_cfg_block block,
+                                        bool (*cb) (gcc_cfg_block block,
+                                                    void *user_data),
+                                        void *user_data)
+{
+  return for_each_dominated_block (CDI_DOMINATORS, block, cb, user_data);
+}
+
+GCC_IMPLEMENT_PUBLIC_API (bool)
+gcc_cfg_block_for_each_postdominated_block (gcc_cfg_block block,
+                                            bool (*cb) (gcc_cfg_block block,
+                                                        void *user_data),
+                                            void *user_data)
+{
+  return for_each_dominated_block (CDI_POST_DOMINATORS, block, cb, user_data);
+}
+
+GCC_IMPLEMENT_PUBLIC_API (bool)
+gcc_cfg_block_is_dominated_by (gcc_cfg_block block, gcc_cfg_block other)
+{
+  return dominated_by_p (CDI_DOMINATORS, block.inner, other.inner);
+}
+
+GCC_IMPLEMENT_PUBLIC_API (bool)
+gcc_cfg_block_is_postdominated_by (gcc_cfg_block block, gcc_cfg_block other)
+{
+  return dominated_by_p (CDI_POST_DOMINATORS, block.inner, other.inner);
+}
+
 /***********************************************************
    gcc_cfg_edge
 ************************************************************/
@@ -331,6 +408,117 @@ gcc_cfg_edge_is_eh(gcc_cfg_edge edge)
   return (edge.inner->flags & EDGE_EH) == EDGE_EH;
 }
 
+/***********************************************************
+   gcc_loop
+************************************************************/
+GCC_IMPLEMENT_PRIVATE_API (struct gcc_loop)
+gcc_private_make_loop (struct loop *inner)
+{
+  struct gcc_loop result;
+  result.inner = inner;
+  return result;
+}
+
+GCC_IMPLEMENT_PUBLIC_API (void) gcc_loop_mark_in_use (gcc_loop loop)
+{
+  gt_ggc_mx_loop (loop.inner);
+}
+
+GCC_IMPLEMENT_PUBLIC_API (int) gcc_loop_get_num (gcc_loop loop)
+{
+  return loop.inner->num;
+}
+
+GCC_IMPLEMENT_PUBLIC_API (gcc_cfg_block) gcc_loop_get_header (gcc_loop loop)
+{
+  return gcc_private_make_cfg_block (loop.inner->header);
+}
+
+GCC_IMPLEMENT_PUBLIC_API (gcc_cfg_block) gcc_loop_get_latch (gcc_loop loop)
+{
+  return gcc_private_make_cfg_block (loop.inner->latch);
+}
+
+GCC_IMPLEMENT_PUBLIC_API (int) gcc_loop_get_depth (gcc_loop loop)
+{
+  return loop_depth (loop.inner);
+}
+
+GCC_IMPLEMENT_PUBLIC_API (gcc_loop) gcc_loop_get_outer (gcc_loop loop)
+{
+  return gcc_private_make_loop (loop_outer (loop.inner));
+}
+
+GCC_IMPLEMENT_PUBLIC_API (bool)
+gcc_loop_for_each_inner_loop (gcc_loop loop,
+                              bool (*cb) (gcc_loop loop, void *user_data),
+                              void *user_data)
+{
+  struct loop *iter;
+
+  for (iter = loop.inner->inner; iter; iter = iter->next)
+    {
+      if (cb (gcc_private_make_loop (iter), user_data))
+        {
+          return true;
+        }
+    }
+
+  return false;
+}
+
+GCC_IMPLEMENT_PUBLIC_API (bool)
+gcc_loop_for_each_block (gcc_loop loop,
+                         bool (*cb) (gcc_cfg_block block, void *user_data),
+                         void *user_data)
+{
+  basic_block *body = get_loop_body (loop.inner);
+  unsigned int i;
+  bool result = false;
+
+  for (i = 0; i < loop.inner->num_nodes; i++)
+    {
+      if (cb (gcc_private_make_cfg_block (body[i]), user_data))
+        {
+          result = true;
+          break;
+        }
+    }
+
+  free (body);
+  return result;
+}
+
+GCC_IMPLEMENT_PUBLIC_API (bool)
+gcc_loop_for_each_exit_edge (gcc_loop loop,
+                             bool (*cb) (gcc_cfg_edge edge, void *user_data),
+                             void *user_data)
+{
+  /* The signature of get_loop_exit_edges has changed between GCC
+     releases, so find the edges leaving the body directly: */
+  basic_block *body = get_loop_body (loop.inner);
+  unsigned int i;
+  bool result = false;
+
+  for (i = 0; i < loop.inner->num_nodes && !result; i++)
+    {
+      edge e;
+      edge_iterator ei;
+
+      FOR_EACH_EDGE (e, ei, body[i]->succs)
+        {
+          if (!flow_bb_inside_loop_p (loop.inner, e->dest)
+              && cb (gcc_private_make_cfg_edge (e), user_data))
+            {
+              result = true;
+              break;
+            }
+        }
+    }
+
+  free (body);
+  return result;
+}
 
 /*
 Local variables:
@@ -32,6 +32,14 @@
 #include "rtl.h"
 #include "ggc.h"
 
+/* gcc 5 moved the dominance API into its own header */
+#if (GCC_VERSION >= 5000)
+#include "dominance.h"
+#endif
+#include "cfgloop.h"
+
+#include "gcc-private-compat.h"
+
 /* Declarations: functions */
 
 /* gcc_function */
@@ -76,6 +84,114 @@ gcc_function_get_end (gcc_function func)
   return gcc_private_make_location (func.inner->function_end_locus);
 }
 
+static struct loops *
+get_loops (gcc_function func)
+{
+#if (GCC_VERSION >= 4009)
+  return loops_for_fn (func.inner);
+#else
+  return func.inner->x_current_loops;
+#endif
+}
+
+GCC_IMPLEMENT_PUBLIC_API (bool) gcc_function_get_has_loops (gcc_function func)
+{
+  return get_loops (func) != NULL;
+}
+
+GCC_IMPLEMENT_PUBLIC_API (bool)
+gcc_function_for_each_loop (gcc_function func,
+                            bool (*cb) (gcc_loop loop, void *user_data),
+                            void *user_data)
+{
+  struct loops *loops = get_loops (func);
+  struct loop *iter;
+
+  if (!loops)
+    {
+      return false;
+    }
+
+  /* The root of the loop tree represents the whole function; its children
+     are the outermost loops: */
+  for (iter = loops->tree_root->inner; iter; iter = iter->next)
+    {
+      if (cb (gcc_private_make_loop (iter), user_data))
+        {
+          return true;
+        }
+    }
+
+  return false;
+}
+
+GCC_IMPLEMENT_PUBLIC_API (bool)
+gcc_function_calculate_dominance_info (gcc_function func, bool post)
+{
+  enum cdi_direction dir = post ? CDI_POST_DOMINATORS : CDI_DOMINATORS;
+  bool switched = (func.inner != cfun);
+  bool built = false;
+
+  /* The dominance API acts on cfun: */
+  if (switched)
+    {
+      push_cfun (func.inner);
+    }
+  if (!dom_info_available_p (dir))
+    {
+      calculate_dominance_info (dir);
+      built = true;
+    }
+  if (switched)
+    {
+      pop_cfun ();
+    }
+  return built;
+}
+
+GCC_IMPLEMENT_PUBLIC_API (void)
+gcc_function_free_dominance_info (gcc_function func, bool post)
+{
+  enum cdi_direction dir = post ? CDI_POST_DOMINATORS : CDI_DOMINATORS;
+
+  /* Nothing to do if GCC has already thrown away the CFG: */
+  if (!func.inner->cfg)
+    {
+      return;
+    }
+  if (func.inner != cfun)
+    {
+      push_cfun (func.inner);
+      free_dominance_info (dir);
+      pop_cfun ();
+    }
+  else
+    {
+      free_dominance_info (dir);
+    }
+}
+
+GCC_IMPLEMENT_PUBLIC_API (bool)
+gcc_function_contains_block (gcc_function func, gcc_cfg_block block)
+{
+  int index = block.inner->index;
+
+  if (!func.inner->cfg)
+    {
+      return false;
+    }
+  if (index < 0
+      || index >= (int)GCC_COMPAT_VEC_LENGTH (basic_block,
+                                              func.inner->cfg->x_basic_block_info))
+    {
+      return false;
+    }
+  return (GCC_COMPAT_VEC_INDEX (basic_block,
+                                func.inner->cfg->x_basic_block_info,
+                                index)
+          == block.inner);
+}
+
 GCC_IMPLEMENT_PUBLIC_API (gcc_function) gcc_get_current_function (void)
 {
   return gcc_private_make_function (cfun);
@@ -75,6 +75,32 @@ class SourceWriter:
         self.writeln('}')
         self.writeln('#endif')
 
+    def write_public_function(self, c_return_type, c_name, paramstr,
+                              inline_body=None):
+        """
+        Write the declaration of a public API function.
+
+        If inline_body is given, also write a "static inline" definition
+        of it, to be used instead when GCC_C_API_INLINE is defined, so
+        that callers avoid a call into libgcc-c-api.so for trivial
+        accessors.  The out-of-line version in the library must do the
+        same thing.
+        """
+        if inline_body:
+            self.writeln('#ifdef GCC_C_API_INLINE')
+            self.writeln('static inline %s' % c_return_type)
+            self.writeln('%s(%s)' % (c_name, paramstr))
+            self.writeln('{')
+            self.indent()
+            self.writeln(inline_body)
+            self.outdent()
+            self.writeln('}')
+            self.writeln('#else')
+        self.writeln('GCC_PUBLIC_API(%s)' % c_return_type)
+        self.writeln('%s(%s);' % (c_name, paramstr))
+        if inline_body:
+            self.writeln('#endif')
+
 def write_api(api, out):
     writer = SourceWriter(out)
     write_header(out)
@@ -88,6 +114,14 @@ def write_api(api, out):
         out.write('#include "gcc-common.h"\n')
     writer.writeln()
 
+    # The inline definitions of the markers need the declarations of
+    # GCC's marking routines:
+    if any([type_.get_marker() for type_ in api.iter_types()]):
+        writer.writeln('#ifdef GCC_C_API_INLINE')
+        writer.writeln('#include "ggc.h"')
+        writer.writeln('#endif')
+        writer.writeln()
+
     writer.write_begin_extern_c()
 
     doc = api.get_doc()
@@ -103,11 +137,16 @@ def write_api(api, out):
             writer.write_doc_comment(doc)
 
         # mark_in_use:
-        writer.writeln('GCC_PUBLIC_API(void)')
-        writer.writeln('%s_mark_in_use(%s %s);'
-                       % (type_.get_c_prefix(),
-                          type_.get_c_name(),
-                          type_.get_varname()))
+        marker = type_.get_marker()
+        if marker:
+            inline_body = '%s (%s.inner);' % (marker, type_.get_varname())
+        else:
+            inline_body = None
+        writer.write_public_function('void',
+                                     '%s_mark_in_use' % type_.get_c_prefix(),
+                                     '%s %s' % (type_.get_c_name(),
+                                                type_.get_varname()),
+                                     inline_body)
         writer.writeln()
 
         # add getters for attributes:
@@ -118,19 +157,21 @@ def write_api(api, out):
             if attr.get_c_name().startswith('is_'):
                 # "gcc_foo_is_some_boolean", rather than
                 # "gcc_foo_get_is_some_boolean":
-                writer.writeln('GCC_PUBLIC_API(%s)' % attr.get_c_type())
-                writer.writeln('%s_%s(%s %s);'
-                               % (type_.get_c_prefix(),
-                                  attr.get_c_name(),
-                                  type_.get_c_name(),
-                                  type_.get_varname()))
+                c_name = '%s_%s' % (type_.get_c_prefix(),
+                                    attr.get_c_name())
+            else:
+                c_name = '%s_get_%s' % (type_.get_c_prefix(),
+                                        attr.get_c_name())
+            expr = attr.get_inline_expr()
+            if expr:
+                inline_body = 'return %s;' % expr
             else:
-                writer.writeln('GCC_PUBLIC_API(%s)' % attr.get_c_type())
-                writer.writeln('%s_get_%s(%s %s);'
-                               % (type_.get_c_prefix(),
-                                  attr.get_c_name(),
-                                  type_.get_c_name(),
-                                  type_.get_varname()))
+                inline_body = None
+            writer.write_public_function(attr.get_c_type(),
+                                         c_name,
+                                         '%s %s' % (type_.get_c_name(),
+                                                    type_.get_varname()),
+                                         inline_body)
             writer.writeln()
 
         # add iterators
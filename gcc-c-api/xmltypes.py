@@ -112,6 +112,13 @@ class Type(XmlWrapper, HasDocsMixin):
         base = self.get_base()
         return base.get_varname()
 
+    def get_marker(self):
+        """
+        Get the name of the GC marking routine for the inner type, if
+        mark_in_use can be inlined as a call to it
+        """
+        return self.node.get('marker')
+
     def get_inner_type(self):
         inner = self.node.get('inner')
         if inner:
@@ -179,6 +186,13 @@ class Attribute(XmlWrapper, HasDocsMixin):
         access = self.get_access()
         return 'r' in access
 
+    def get_inline_expr(self):
+        """
+        Get the C expression for the getter, if it is trivial enough to be
+        inlined into the header
+        """
+        return self.node.get('inline')
+
 class Iterator(XmlWrapper, HasDocsMixin):
     def get_xml_name(self):
         return self.node.get('name')
@@ -226,6 +226,14 @@ PyGcc_CallbackFor_PLUGIN_PASS_EXECUTION(void *gcc_data, void *user_data)
     PyGcc_FinishInvokingCallback(gstate, 
 					1, PyGccPass_New(pass),
 					user_data);
+
+    /*
+       The pass hasn't started yet, so free any dominance information that
+       the callback had us build, rather than leaving it for the pass to
+       find.  (GCC may run this before or after the plugin's own
+       on_pass_execution, depending on the order of registration):
+    */
+    PyGcc_FreeDominanceInfo();
 }
 
 static void
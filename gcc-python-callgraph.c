@@ -56,24 +56,37 @@ PyGccCallgraphNode_str(struct PyGccCallgraphNode * self)
                                          Py_TYPE(self)->tp_name);
 }
 
-IMPL_APPENDER(add_cgraph_edge_to_list,
-              gcc_cgraph_edge,
-              PyGccCallgraphEdge_New)
+IMPL_SEQUENCE_APPENDER(append_cgraph_edge_to_sequence,
+                       gcc_cgraph_edge)
+
+IMPL_SEQUENCE_ITEM_MAKER(make_cgraph_edge_item,
+                         gcc_cgraph_edge,
+                         PyGccCallgraphEdge_New)
+
+IMPL_SEQUENCE_FILLER(fill_callee_sequence,
+                     PyGccCallgraphNode, node,
+                     gcc_cgraph_node_for_each_callee,
+                     append_cgraph_edge_to_sequence)
+
+IMPL_SEQUENCE_FILLER(fill_caller_sequence,
+                     PyGccCallgraphNode, node,
+                     gcc_cgraph_node_for_each_caller,
+                     append_cgraph_edge_to_sequence)
 
 PyObject *
 PyGccCallgraphNode_get_callees(struct PyGccCallgraphNode * self)
 {
-    IMPL_LIST_MAKER(gcc_cgraph_node_for_each_callee,
-                    self->node,
-                    add_cgraph_edge_to_list)
+    return PyGccWrapperSequence_Get((PyObject*)self, "callees",
+                                    fill_callee_sequence,
+                                    make_cgraph_edge_item);
 }
 
 PyObject *
 PyGccCallgraphNode_get_callers(struct PyGccCallgraphNode * self)
 {
-    IMPL_LIST_MAKER(gcc_cgraph_node_for_each_caller,
-                    self->node,
-                    add_cgraph_edge_to_list)
+    return PyGccWrapperSequence_Get((PyObject*)self, "callers",
+                                    fill_caller_sequence,
+                                    make_cgraph_edge_item);
 }
 
 union gcc_cgraph_edge_as_ptr {
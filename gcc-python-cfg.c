@@ -21,6 +21,7 @@
 #include "gcc-python.h"
 #include "gcc-python-wrappers.h"
 #include "gcc-c-api/gcc-cfg.h"
+#include "gcc-c-api/gcc-function.h"
 #include "gcc-c-api/gcc-gimple.h"
 
 #include "gcc-c-api/gcc-private-compat.h" /* for now */
@@ -117,9 +118,17 @@ PyGccBasicBlock_get_succs(PyGccBasicBlock *self, void *closure)
                     add_edge_to_list)
 }
 
-IMPL_APPENDER(append_gimple_to_list,
-              gcc_gimple,
-              PyGccGimple_New)
+IMPL_SEQUENCE_APPENDER(append_gimple_to_sequence,
+                       gcc_gimple)
+
+IMPL_SEQUENCE_ITEM_MAKER(make_gimple_item,
+                         gcc_gimple,
+                         PyGccGimple_New)
+
+IMPL_SEQUENCE_FILLER(fill_gimple_sequence,
+                     PyGccBasicBlock, bb,
+                     gcc_cfg_block_for_each_gimple,
+                     append_gimple_to_sequence)
 
 PyObject *
 PyGccBasicBlock_get_gimple(PyGccBasicBlock *self, void *closure)
@@ -127,9 +136,9 @@ PyGccBasicBlock_get_gimple(PyGccBasicBlock *self, void *closure)
     assert(self);
     assert(self->bb.inner);
 
-    IMPL_LIST_MAKER(gcc_cfg_block_for_each_gimple,
-                    self->bb,
-                    append_gimple_to_list)
+    return PyGccWrapperSequence_Get((PyObject*)self, "gimple",
+                                    fill_gimple_sequence,
+                                    make_gimple_item);
 }
 
 static PyObject*
@@ -138,9 +147,17 @@ PyGccGimple_New_phi(gcc_gimple_phi phi)
     return PyGccGimple_New(gcc_gimple_phi_as_gcc_gimple(phi));
 }
 
-IMPL_APPENDER(append_gimple_phi_to_list,
-              gcc_gimple_phi,
-              PyGccGimple_New_phi)
+IMPL_SEQUENCE_APPENDER(append_gimple_phi_to_sequence,
+                       gcc_gimple_phi)
+
+IMPL_SEQUENCE_ITEM_MAKER(make_gimple_phi_item,
+                         gcc_gimple_phi,
+                         PyGccGimple_New_phi)
+
+IMPL_SEQUENCE_FILLER(fill_gimple_phi_sequence,
+                     PyGccBasicBlock, bb,
+                     gcc_cfg_block_for_each_gimple_phi,
+                     append_gimple_phi_to_sequence)
 
 PyObject *
 PyGccBasicBlock_get_phi_nodes(PyGccBasicBlock *self, void *closure)
@@ -148,11 +165,15 @@ PyGccBasicBlock_get_phi_nodes(PyGccBasicBlock *self, void *closure)
     assert(self);
     assert(self->bb.inner);
 
-    IMPL_LIST_MAKER(gcc_cfg_block_for_each_gimple_phi,
-                    self->bb,
-                    append_gimple_phi_to_list)
+    return PyGccWrapperSequence_Get((PyObject*)self, "phi_nodes",
+                                    fill_gimple_phi_sequence,
+                                    make_gimple_phi_item);
 }
 
+IMPL_APPENDER(add_block_to_list,
+              gcc_cfg_block,
+              PyGccBasicBlock_New)
+
 IMPL_APPENDER(append_rtl_to_list,
               gcc_rtl_insn,
               PyGccRtl_New)
@@ -377,55 +398,38 @@ PyGccBasicBlock_New(gcc_cfg_block bb)
 					    real_make_basic_block_wrapper);
 }
 
-static bool
-add_block_to_list(gcc_cfg_block bb, void *user_data)
-{
-    PyObject *result = (PyObject*)user_data;
-    PyObject *obj_var;
-    obj_var = PyGccBasicBlock_New(bb);
-    if (!obj_var) {
-        return true;
-    }
+/*
+  It appears that with optimization there can be occasional NULL blocks;
+  the appender skips them:
+*/
+IMPL_SEQUENCE_APPENDER(append_block_to_sequence,
+                       gcc_cfg_block)
 
-    /* It appears that with optimization there can be occasional NULLs,
-       which get turned into None.  Skip them:
-    */
-    if (obj_var != Py_None) {
-        if (-1 == PyList_Append(result, obj_var)) {
-            Py_DECREF(obj_var);
-            return true;
-        }
+IMPL_SEQUENCE_ITEM_MAKER(make_block_item,
+                         gcc_cfg_block,
+                         PyGccBasicBlock_New)
 
-        /* Success: */
-    }
-    Py_DECREF(obj_var);
-    return false;
-}
+IMPL_SEQUENCE_FILLER(fill_block_sequence,
+                     PyGccCfg, cfg,
+                     gcc_cfg_for_each_block,
+                     append_block_to_sequence)
 
 PyObject *
 PyGccCfg_get_basic_blocks(PyGccCfg *self, void *closure)
 {
-    IMPL_LIST_MAKER(gcc_cfg_for_each_block,
-                    self->cfg,
-                    add_block_to_list)
+    return PyGccWrapperSequence_Get((PyObject*)self, "basic_blocks",
+                                    fill_block_sequence,
+                                    make_block_item);
 }
 
-extern PyTypeObject PyGccLabelDecl_TypeObj;
-
+/* The arguments are parsed by the wrapper in autogenerated-cfg.c: */
 PyObject *
-PyGccCfg_get_block_for_label(PyObject *s, PyObject *args)
+PyGccCfg_get_block_for_label_impl(struct PyGccCfg *self,
+                                  struct PyGccTree *label_decl)
 {
-    struct PyGccCfg *self = (struct PyGccCfg *)s;
-    struct PyGccTree *label_decl;
     int uid;
     basic_block bb;
 
-    if (!PyArg_ParseTuple(args,
-                          "O!:get_block_for_label",
-                          &PyGccLabelDecl_TypeObj, &label_decl)) {
-        return NULL;
-    }
-
     /* See also gcc/tree-cfg.c: label_to_block_fn */
     uid = LABEL_DECL_UID(label_decl->t.inner);
 
@@ -499,6 +503,335 @@ PyGcc_WrtpMarkForPyGccCfg(PyGccCfg *wrapper)
     gcc_cfg_mark_in_use(wrapper->cfg);
 }
 
+/*
+  Dominance information is built on demand by GCC's
+  calculate_dominance_info, and is then reused for the rest of the current
+  pass on the current function (i.e. for as long as the generation of
+  PyGccWrapperSequence_GetGeneration stays the same).
+
+  Whatever we had to build ourselves is freed again once that pass is
+  over, so that GCC's own passes find the dominance information in the
+  state they left it in.
+*/
+#define DOMINANCE_FORWARD 1
+#define DOMINANCE_POST    2
+
+static unsigned long dominance_generation = 0;
+
+/* Bitmask of the DOMINANCE_* known to be available during
+   dominance_generation: */
+static int dominance_available = 0;
+
+/* The function for which we built dominance information, and a bitmask
+   of the DOMINANCE_* that we built for it (and so must free): */
+static gcc_function dominance_fun;
+static int dominance_built = 0;
+
+void
+PyGcc_FreeDominanceInfo(void)
+{
+    if (dominance_fun.inner) {
+        if (dominance_built & DOMINANCE_FORWARD) {
+            gcc_function_free_dominance_info(dominance_fun, false);
+        }
+        if (dominance_built & DOMINANCE_POST) {
+            gcc_function_free_dominance_info(dominance_fun, true);
+        }
+    }
+    dominance_fun.inner = NULL;
+    dominance_built = 0;
+    dominance_available = 0;
+}
+
+void
+PyGcc_FreeStaleDominanceInfo(void)
+{
+    unsigned long generation = PyGccWrapperSequence_GetGeneration();
+
+    if (generation == dominance_generation) {
+        return;
+    }
+    PyGcc_FreeDominanceInfo();
+    dominance_generation = generation;
+}
+
+void
+PyGcc_MarkDominanceInfo(void)
+{
+    /* Keep alive the function whose dominance information we have yet to
+       free: */
+    if (dominance_fun.inner) {
+        gcc_function_mark_in_use(dominance_fun);
+    }
+}
+
+static int
+ensure_dominance_info(PyGccBasicBlock *block, int kind)
+{
+    gcc_function fun;
+
+    PyGcc_FreeStaleDominanceInfo();
+
+    fun = gcc_get_current_function();
+    if (!fun.inner || !gcc_function_contains_block(fun, block->bb)) {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "dominance information is only available for the"
+                        " blocks of the current function");
+        return -1;
+    }
+
+    if (!(dominance_available & kind)) {
+        if (gcc_function_calculate_dominance_info(fun,
+                                                  kind == DOMINANCE_POST)) {
+            dominance_fun = fun;
+            dominance_built |= kind;
+        }
+        dominance_available |= kind;
+    }
+    return 0;
+}
+
+PyObject *
+PyGccBasicBlock_get_idom(PyGccBasicBlock *self, void *closure)
+{
+    if (ensure_dominance_info(self, DOMINANCE_FORWARD)) {
+        return NULL;
+    }
+    return PyGccBasicBlock_New(gcc_cfg_block_get_immediate_dominator(self->bb));
+}
+
+PyObject *
+PyGccBasicBlock_get_ipostdom(PyGccBasicBlock *self, void *closure)
+{
+    if (ensure_dominance_info(self, DOMINANCE_POST)) {
+        return NULL;
+    }
+    return PyGccBasicBlock_New(
+               gcc_cfg_block_get_immediate_postdominator(self->bb));
+}
+
+PyObject *
+PyGccBasicBlock_get_dom_children(PyGccBasicBlock *self, void *closure)
+{
+    if (ensure_dominance_info(self, DOMINANCE_FORWARD)) {
+        return NULL;
+    }
+
+    IMPL_LIST_MAKER(gcc_cfg_block_for_each_dominated_block,
+                    self->bb,
+                    add_block_to_list)
+}
+
+PyObject *
+PyGccBasicBlock_get_postdom_children(PyGccBasicBlock *self, void *closure)
+{
+    if (ensure_dominance_info(self, DOMINANCE_POST)) {
+        return NULL;
+    }
+
+    IMPL_LIST_MAKER(gcc_cfg_block_for_each_postdominated_block,
+                    self->bb,
+                    add_block_to_list)
+}
+
+/* The arguments are parsed by the wrappers in autogenerated-cfg.c: */
+PyObject *
+PyGccBasicBlock_dominated_by_impl(struct PyGccBasicBlock *self,
+                                  struct PyGccBasicBlock *other)
+{
+    if (ensure_dominance_info(self, DOMINANCE_FORWARD)
+        || ensure_dominance_info(other, DOMINANCE_FORWARD)) {
+        return NULL;
+    }
+    return PyBool_FromLong(gcc_cfg_block_is_dominated_by(self->bb,
+                                                         other->bb));
+}
+
+PyObject *
+PyGccBasicBlock_postdominated_by_impl(struct PyGccBasicBlock *self,
+                                      struct PyGccBasicBlock *other)
+{
+    if (ensure_dominance_info(self, DOMINANCE_POST)
+        || ensure_dominance_info(other, DOMINANCE_POST)) {
+        return NULL;
+    }
+    return PyBool_FromLong(gcc_cfg_block_is_postdominated_by(self->bb,
+                                                             other->bb));
+}
+
+/*
+  Iterate over the dominator tree rooted at this block, in preorder.  This
+  uses an explicit stack rather than recursion, since the tree can be as
+  deep as the function is long.
+*/
+PyObject *
+PyGccBasicBlock_iter_dominated(PyGccBasicBlock *self, PyObject *args)
+{
+    PyObject *result = NULL;
+    PyObject *stack = NULL;
+    PyObject *iter = NULL;
+
+    if (ensure_dominance_info(self, DOMINANCE_FORWARD)) {
+        return NULL;
+    }
+
+    result = PyList_New(0);
+    if (!result) {
+        goto error;
+    }
+
+    stack = PyList_New(0);
+    if (!stack) {
+        goto error;
+    }
+    if (PyList_Append(stack, (PyObject*)self)) {
+        goto error;
+    }
+
+    while (PyList_GET_SIZE(stack)) {
+        Py_ssize_t size = PyList_GET_SIZE(stack);
+        PyObject *item = PyList_GET_ITEM(stack, size - 1);
+        PyObject *children;
+        Py_ssize_t i;
+
+        if (PyList_Append(result, item)) {
+            goto error;
+        }
+        children = PyGccBasicBlock_get_dom_children((PyGccBasicBlock*)item,
+                                                    NULL);
+        if (!children) {
+            goto error;
+        }
+        if (PyList_SetSlice(stack, size - 1, size, NULL)) {
+            Py_DECREF(children);
+            goto error;
+        }
+        /* Push the children in reverse, so that they're visited in order: */
+        for (i = PyList_GET_SIZE(children) - 1; i >= 0; i--) {
+            if (PyList_Append(stack, PyList_GET_ITEM(children, i))) {
+                Py_DECREF(children);
+                goto error;
+            }
+        }
+        Py_DECREF(children);
+    }
+
+    iter = PyObject_GetIter(result);
+
+error:
+    Py_XDECREF(stack);
+    Py_XDECREF(result);
+    return iter;
+}
+
+/*
+  gcc.Loop
+*/
+PyObject *
+PyGccLoop_repr(struct PyGccLoop *self)
+{
+    return PyGccString_FromFormat("%s(num=%i)",
+                                  Py_TYPE(self)->tp_name,
+                                  gcc_loop_get_num(self->loop));
+}
+
+PyObject *
+PyGccLoop_get_outer(struct PyGccLoop *self, void *closure)
+{
+    gcc_loop outer = gcc_loop_get_outer(self->loop);
+
+    /* Don't expose the root of the loop tree, which is the whole function
+       rather than a loop: */
+    if (!outer.inner || !gcc_loop_get_outer(outer).inner) {
+        Py_RETURN_NONE;
+    }
+    return PyGccLoop_New(outer);
+}
+
+IMPL_APPENDER(add_loop_to_list,
+              gcc_loop,
+              PyGccLoop_New)
+
+PyObject *
+PyGccLoop_get_inner(struct PyGccLoop *self, void *closure)
+{
+    IMPL_LIST_MAKER(gcc_loop_for_each_inner_loop,
+                    self->loop,
+                    add_loop_to_list)
+}
+
+PyObject *
+PyGccLoop_get_blocks(struct PyGccLoop *self, void *closure)
+{
+    IMPL_LIST_MAKER(gcc_loop_for_each_block,
+                    self->loop,
+                    add_block_to_list)
+}
+
+PyObject *
+PyGccLoop_get_exits(struct PyGccLoop *self, void *closure)
+{
+    IMPL_LIST_MAKER(gcc_loop_for_each_exit_edge,
+                    self->loop,
+                    add_edge_to_list)
+}
+
+PyObject *
+PyGccFunction_get_loops(struct PyGccFunction *self, void *closure)
+{
+    if (!gcc_function_get_has_loops(self->fun)) {
+        Py_RETURN_NONE;
+    }
+
+    IMPL_LIST_MAKER(gcc_function_for_each_loop,
+                    self->fun,
+                    add_loop_to_list)
+}
+
+union gcc_loop_as_ptr {
+    gcc_loop loop;
+    void *ptr;
+};
+
+static PyObject *
+real_make_loop_wrapper(void *ptr)
+{
+    struct PyGccLoop *obj;
+    union gcc_loop_as_ptr u;
+    u.ptr = ptr;
+
+    if (!u.loop.inner) {
+        Py_RETURN_NONE;
+    }
+
+    obj = PyGccWrapper_New(struct PyGccLoop, &PyGccLoop_TypeObj);
+    if (!obj) {
+        return NULL;
+    }
+
+    obj->loop = u.loop;
+
+    return (PyObject*)obj;
+}
+
+static PyObject *loop_wrapper_cache = NULL;
+PyObject *
+PyGccLoop_New(gcc_loop loop)
+{
+    union gcc_loop_as_ptr u;
+    u.loop = loop;
+    return PyGcc_LazilyCreateWrapper(&loop_wrapper_cache,
+                                     u.ptr,
+                                     real_make_loop_wrapper);
+}
+
+void
+PyGcc_WrtpMarkForPyGccLoop(PyGccLoop *wrapper)
+{
+    /* Mark the underlying object (recursing into its fields): */
+    gcc_loop_mark_in_use(wrapper->loop);
+}
+
 /*
   PEP-7  
 Local variables:
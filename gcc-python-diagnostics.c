@@ -38,25 +38,18 @@
   the python level.
 
   Thus we instead just wrap "error_at" and its analogs
+
+  The arguments of each of these are parsed by the entry points generated
+  into autogenerated-diagnostics.c (see generate-diagnostics-c.py), which
+  then call the "_impl" functions here.
 */
 
 PyObject*
-PyGcc_permerror(PyObject *self, PyObject *args)
+PyGcc_permerror_impl(PyObject *self, PyGccLocation *loc_obj, const char *msg)
 {
-    PyGccLocation *loc_obj = NULL;
-    const char *msg = NULL;
     PyObject *result_obj = NULL;
     bool result_b;
 
-    if (!PyArg_ParseTuple(args,
-			  "O!"
-			  "s"
-			  ":permerror",
-			  &PyGccLocation_TypeObj, &loc_obj,
-			  &msg)) {
-        return NULL;
-    }
-
     /* Invoke the GCC function: */
     result_b = gcc_permerror(loc_obj->loc, msg);
 
@@ -66,53 +59,20 @@ PyGcc_permerror(PyObject *self, PyObject *args)
 }
 
 PyObject *
-PyGcc_error(PyObject *self, PyObject *args, PyObject *kwargs)
+PyGcc_error_impl(PyObject *self, PyGccLocation *loc_obj, const char *msg)
 {
-    PyGccLocation *loc_obj;
-    const char *msg;
-    const char *keywords[] = {"location",
-                              "message",
-                              NULL};
-
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs,
-                                     "O!s:error", (char**)keywords,
-                                     &PyGccLocation_TypeObj, &loc_obj,
-                                     &msg)) {
-        return NULL;
-    }
-
     gcc_error_at(loc_obj->loc, msg);
 
     Py_RETURN_NONE;
 }
 
 PyObject *
-PyGcc_warning(PyObject *self, PyObject *args, PyObject *kwargs)
+PyGcc_warning_impl(PyObject *self, PyGccLocation *loc_obj, const char *msg,
+                   PyObject *opt_obj)
 {
-    PyGccLocation *loc_obj;
-    const char *msg;
-    PyObject *opt_obj = &_Py_NoneStruct;
     int opt_code;
-    const char *keywords[] = {"location",
-                              "message",
-                              "option",
-                              NULL};
     bool was_reported;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs,
-                                     "O!s|O:warning", (char**)keywords,
-
-                                     /* code "O!": */
-                                     &PyGccLocation_TypeObj, &loc_obj,
-                                     /* code: "s": */
-                                     &msg,
-
-                                     /* optional args: */
-                                     /* code: "O": */
-                                     &opt_obj)) {
-        return NULL;
-    }
-
     assert(opt_obj);
 
     /* If a gcc.Option was given, extract the code: */
@@ -141,22 +101,10 @@ PyGcc_warning(PyObject *self, PyObject *args, PyObject *kwargs)
     return PyBool_FromLong(was_reported);
 }
 
+#if (GCC_VERSION >= 6000)
 PyObject *
-PyGcc_inform(PyObject *self, PyObject *args, PyObject *kwargs)
+PyGcc_inform_impl(PyObject *self, PyObject *obj, const char *msg)
 {
-    const char *msg;
-    const char *keywords[] = {"location",
-                              "message",
-                              NULL};
-#if (GCC_VERSION >= 6000)
-    PyObject *obj;
-
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs,
-                                     "Os:inform", (char**)keywords,
-                                     &obj, &msg)) {
-        return NULL;
-    }
-
     /* Check for location vs rich_location.  */
     if (Py_TYPE (obj) == (PyTypeObject *)&PyGccLocation_TypeObj) {
         PyGccLocation *loc_obj = (PyGccLocation *)obj;
@@ -175,21 +123,16 @@ PyGcc_inform(PyObject *self, PyObject *args, PyObject *kwargs)
                             ("type of location must be either gcc.Location"
                              " or gcc.RichLocation"));
     }
+}
 #else
-    PyGccLocation *loc_obj;
-
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs,
-                                     "O!s:inform", (char**)keywords,
-                                     &PyGccLocation_TypeObj, &loc_obj,
-                                     &msg)) {
-        return NULL;
-    }
-
+PyObject *
+PyGcc_inform_impl(PyObject *self, PyGccLocation *loc_obj, const char *msg)
+{
     gcc_inform(loc_obj->loc, msg);
 
     Py_RETURN_NONE;
-#endif
 }
+#endif
 
 /*
   PEP-7
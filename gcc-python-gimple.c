@@ -321,6 +321,181 @@ PyGccGimpleCall_get_args(struct PyGccGimple *self, void *closure)
                     add_tree_to_list)
 }
 
+/*
+  gcc.GimpleAssign.decoded and gcc.GimpleCall.decoded
+
+  The refcount checker reads the operands of each assignment and call many
+  times per trace, and each read of e.g. "stmt.args" builds a fresh list of
+  fresh wrapper objects.  Instead, "stmt.decoded" gives an immutable record
+  of all of them, built once and then memoized per statement, in the same
+  way as gcc.WrapperSequence (flushed whenever the current pass or function
+  changes).
+*/
+static PyStructSequence_Field decoded_fields[] = {
+    {(char*)"loc", (char*)"Source code location, as a gcc.Location (or None)"},
+    {(char*)"exprcode", (char*)"The kind of the expression, as a gcc.Tree subclass"},
+    {(char*)"lhs", (char*)"Left-hand-side, as a gcc.Tree (or None)"},
+    {(char*)"rhs", (char*)"The operands on the right-hand-side, as a tuple of gcc.Tree"},
+    {(char*)"fn", (char*)"Call: the function being called, as a gcc.Tree (None otherwise)"},
+    {(char*)"fndecl", (char*)"Call: the declaration of the function being called (if any)"},
+    {(char*)"args", (char*)"Call: the arguments, as a tuple of gcc.Tree (None otherwise)"},
+    {(char*)"noreturn", (char*)"Call: has this call been marked as not returning (None otherwise)"},
+    /* Not part of the tuple; keeps the statement alive whilst memoized: */
+    {(char*)"stmt", (char*)"The gcc.Gimple statement"},
+    {NULL}
+};
+
+#define NUM_DECODED_FIELDS_IN_SEQUENCE 8
+
+static PyStructSequence_Desc decoded_desc = {
+    (char*)"gcc.DecodedGimple",
+    NULL,
+    decoded_fields,
+    NUM_DECODED_FIELDS_IN_SEQUENCE
+};
+
+PyTypeObject PyGccDecodedGimple_TypeObj;
+static int decoded_type_ready = 0;
+
+/* Called by autogenerated_gimple_init_types, so that the type can be added
+   to the "gcc" module: */
+int
+PyGccDecodedGimple_InitType(void)
+{
+    if (!decoded_type_ready) {
+        PyStructSequence_InitType(&PyGccDecodedGimple_TypeObj, &decoded_desc);
+        if (PyErr_Occurred()) {
+            return 0;
+        }
+        decoded_type_ready = 1;
+    }
+    return 1;
+}
+
+static PyObject *decoded_cache = NULL;
+static unsigned long decoded_generation = 0;
+
+/* Convert a new reference to a list into a new reference to a tuple: */
+static PyObject *
+list_to_tuple(PyObject *list)
+{
+    PyObject *result;
+    if (!list) {
+        return NULL;
+    }
+    result = PyList_AsTuple(list);
+    Py_DECREF(list);
+    return result;
+}
+
+static PyObject *
+make_decoded(struct PyGccGimple *self)
+{
+    PyObject *result;
+    PyObject *items[NUM_DECODED_FIELDS_IN_SEQUENCE + 1];
+    int i;
+
+    if (!PyGccDecodedGimple_InitType()) {
+        return NULL;
+    }
+
+    for (i = 0; i < NUM_DECODED_FIELDS_IN_SEQUENCE + 1; i++) {
+        items[i] = NULL;
+    }
+
+    items[0] = PyGccLocation_New(gcc_gimple_get_location(self->stmt));
+    items[1] = (PyObject*)PyGcc_autogenerated_tree_type_for_tree_code(
+                             gimple_expr_code(self->stmt.inner), 0);
+    if (gimple_code(self->stmt.inner) == GIMPLE_CALL) {
+        gcc_gimple_call call = PyGccGimple_as_gcc_gimple_call(self);
+        items[2] = PyGccTree_New(gcc_gimple_call_get_lhs(call));
+        items[3] = list_to_tuple(PyGccGimple_get_rhs(self, NULL));
+        items[4] = PyGccTree_New(gcc_gimple_call_get_fn(call));
+        items[5] = PyGccTree_New(gcc_gimple_call_get_fndecl(call));
+        items[6] = list_to_tuple(PyGccGimpleCall_get_args(self, NULL));
+        items[7] = PyBool_FromLong(gcc_gimple_call_is_noreturn(call));
+    } else {
+        gcc_gimple_assign assign = PyGccGimple_as_gcc_gimple_assign(self);
+        items[2] = PyGccTree_New(gcc_gimple_assign_get_lhs(assign));
+        items[3] = list_to_tuple(PyGccGimple_get_rhs(self, NULL));
+        for (i = 4; i < NUM_DECODED_FIELDS_IN_SEQUENCE; i++) {
+            Py_INCREF(Py_None);
+            items[i] = Py_None;
+        }
+    }
+    Py_INCREF(self);
+    items[NUM_DECODED_FIELDS_IN_SEQUENCE] = (PyObject*)self;
+
+    for (i = 0; i < NUM_DECODED_FIELDS_IN_SEQUENCE + 1; i++) {
+        if (!items[i]) {
+            goto error;
+        }
+    }
+
+    result = PyStructSequence_New(&PyGccDecodedGimple_TypeObj);
+    if (!result) {
+        goto error;
+    }
+    for (i = 0; i < NUM_DECODED_FIELDS_IN_SEQUENCE + 1; i++) {
+        /* (steals the reference) */
+        PyStructSequence_SET_ITEM(result, i, items[i]);
+    }
+    return result;
+
+ error:
+    for (i = 0; i < NUM_DECODED_FIELDS_IN_SEQUENCE + 1; i++) {
+        Py_XDECREF(items[i]);
+    }
+    return NULL;
+}
+
+PyObject *
+PyGccGimple_get_decoded(struct PyGccGimple *self, void *closure)
+{
+    unsigned long generation = PyGccWrapperSequence_GetGeneration();
+    PyObject *key;
+    PyObject *result;
+
+    if (!decoded_cache) {
+        decoded_cache = PyDict_New();
+        if (!decoded_cache) {
+            return NULL;
+        }
+    }
+    if (decoded_generation != generation) {
+        PyDict_Clear(decoded_cache);
+        decoded_generation = generation;
+    }
+
+    /* The record holds a reference to a wrapper for the statement, keeping
+       it alive with respect to GCC's garbage collector, so the address
+       can't be reused whilst it's in the cache: */
+    key = PyLong_FromVoidPtr(self->stmt.inner);
+    if (!key) {
+        return NULL;
+    }
+
+    result = PyDict_GetItem(decoded_cache, key);
+    if (result) {
+        Py_DECREF(key);
+        Py_INCREF(result);
+        return result;
+    }
+
+    result = make_decoded(self);
+    if (!result) {
+        Py_DECREF(key);
+        return NULL;
+    }
+    if (PyDict_SetItem(decoded_cache, key, result)) {
+        Py_DECREF(key);
+        Py_DECREF(result);
+        return NULL;
+    }
+    Py_DECREF(key);
+    return result;
+}
+
 PyObject *
 PyGccGimpleLabel_repr(PyObject *self)
 {
@@ -195,15 +195,10 @@ PyGccLocation_hash(struct PyGccLocation * self)
 
 #if (GCC_VERSION >= 5000)
 
+/* The arguments are parsed by the wrapper in autogenerated-location.c: */
 PyObject *
-PyGccLocation_offset_column(PyGccLocation *self, PyObject *args)
+PyGccLocation_offset_column_impl(PyGccLocation *self, int offset)
 {
-    int offset;
-
-    if (!PyArg_ParseTuple(args, "i", &offset)) {
-        return NULL;
-    }
-
     return PyGccLocation_New(gcc_location_offset_column(self->loc, offset));
 }
 
@@ -42,6 +42,30 @@
 */
 static PyObject *pass_wrapper_cache = NULL;
 
+/*
+   The passes that have been disabled by setting "enabled" to False on their
+   gcc.Pass wrapper.
+
+   This is checked before any Python objects are created, so that a disabled
+   pass defined in Python costs nothing for each function it would otherwise
+   have been called on.
+*/
+static struct opt_pass **disabled_passes = NULL;
+static int num_disabled_passes = 0;
+
+static int
+find_disabled_pass(struct opt_pass *pass)
+{
+    int i;
+
+    for (i = 0; i < num_disabled_passes; i++) {
+        if (disabled_passes[i] == pass) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 static bool impl_gate(function *fun)
 {
     PyObject *pass_obj;
@@ -62,6 +86,10 @@ static bool impl_gate(function *fun)
         return true;
     }
 
+    if (num_disabled_passes && find_disabled_pass(current_pass) >= 0) {
+        return false;
+    }
+
     assert(current_pass);
     pass_obj = PyGccPass_New(current_pass);
     assert(pass_obj); /* we own a ref at this point */
@@ -478,6 +506,52 @@ PyGccPass_set_dump_enabled(struct PyGccPass *self, PyObject *value, void *closur
     }
 }
 
+PyObject *
+PyGccPass_get_enabled(struct PyGccPass *self, void *closure)
+{
+    return PyBool_FromLong(find_disabled_pass(self->pass) < 0);
+}
+
+int
+PyGccPass_set_enabled(struct PyGccPass *self, PyObject *value, void *closure)
+{
+    int newbool;
+    int idx;
+
+    if (!value) {
+        PyErr_SetString(PyExc_TypeError, "can't delete \"enabled\"");
+        return -1;
+    }
+
+    newbool = PyObject_IsTrue(value);
+    if (newbool == -1) {
+        return -1;
+    }
+
+    idx = find_disabled_pass(self->pass);
+    if (newbool) {
+        if (idx >= 0) {
+            /* Re-enabling: move the last entry into this slot: */
+            disabled_passes[idx] = disabled_passes[--num_disabled_passes];
+        }
+    } else {
+        if (idx < 0) {
+            struct opt_pass **new_passes;
+
+            new_passes = (struct opt_pass **)PyMem_Realloc(
+                disabled_passes,
+                sizeof(struct opt_pass *) * (num_disabled_passes + 1));
+            if (!new_passes) {
+                PyErr_NoMemory();
+                return -1;
+            }
+            disabled_passes = new_passes;
+            disabled_passes[num_disabled_passes++] = self->pass;
+        }
+    }
+    return 0;
+}
+
 /* In GCC 4.9, passes moved from being globals to fields of the
    pass_manager.  */
 #if (GCC_VERSION >= 4009)
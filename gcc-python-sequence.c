@@ -0,0 +1,343 @@
+/*
+   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+   Copyright 2012 Red Hat, Inc.
+
+   This is free software: you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see
+   <http://www.gnu.org/licenses/>.
+*/
+
+#include <Python.h>
+#include "gcc-python.h"
+#include "gcc-python-wrappers.h"
+#include "function.h"
+
+/*
+  Implementation of gcc.WrapperSequence
+
+  Attributes such as gcc.BasicBlock.gimple used to build a new list of
+  wrapper objects on every access, so that e.g.
+      if bb.gimple:
+          for stmt in bb.gimple:
+  would build the list twice.
+
+  Instead, such attributes now return a gcc.WrapperSequence, which merely
+  records the underlying pointers, creating wrapper objects for the
+  elements that are actually accessed.
+
+  The sequences are memoized: within one pass acting on one function,
+  repeated accesses to the same attribute of the same owner return the
+  same sequence.  The IR can change between passes, so we track a
+  "generation", bumped whenever the current pass or function changes.
+  The memo is flushed when the generation changes, and any sequence that
+  is still alive from an earlier generation is lazily repopulated from its
+  owner when next used.
+*/
+
+static PyObject *sequence_cache = NULL;
+static unsigned long sequence_generation = 1;
+static struct opt_pass *sequence_pass = NULL;
+static struct function *sequence_fun = NULL;
+
+static unsigned long
+get_generation(void)
+{
+    if (current_pass != sequence_pass || cfun != sequence_fun) {
+        sequence_pass = current_pass;
+        sequence_fun = cfun;
+        sequence_generation++;
+        if (sequence_cache) {
+            PyDict_Clear(sequence_cache);
+        }
+    }
+    return sequence_generation;
+}
+
+/*
+  Get the current generation, for use by other memoized attributes (e.g.
+  gcc.GimpleCall.decoded) that need to be invalidated at the same times
+*/
+unsigned long
+PyGccWrapperSequence_GetGeneration(void)
+{
+    return get_generation();
+}
+
+static int
+refill(PyGccWrapperSequence *self)
+{
+    self->num_items = 0;
+    if (self->fill(self)) {
+        return -1;
+    }
+    self->generation = sequence_generation;
+    return 0;
+}
+
+/* Ensure that the sequence reflects the current state of the IR: */
+static int
+sync_with_ir(PyGccWrapperSequence *self)
+{
+    if (self->generation != get_generation()) {
+        return refill(self);
+    }
+    return 0;
+}
+
+int
+PyGccWrapperSequence_Append(PyGccWrapperSequence *seq, void *ptr)
+{
+    if (seq->num_items == seq->allocated) {
+        Py_ssize_t new_allocated = seq->allocated ? seq->allocated * 2 : 8;
+        void **new_items = (void **)PyMem_Realloc(seq->items,
+                                                  new_allocated * sizeof(void *));
+        if (!new_items) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        seq->items = new_items;
+        seq->allocated = new_allocated;
+    }
+    seq->items[seq->num_items++] = ptr;
+    return 0;
+}
+
+static PyObject *
+make_sequence(PyObject *owner,
+              PyGccWrapperSequence_FillFn fill,
+              PyGccWrapperSequence_ItemFn make_item)
+{
+    PyGccWrapperSequence *seq;
+
+    seq = PyObject_New(PyGccWrapperSequence, &PyGccWrapperSequence_TypeObj);
+    if (!seq) {
+        return NULL;
+    }
+    Py_INCREF(owner);
+    seq->owner = owner;
+    seq->fill = fill;
+    seq->make_item = make_item;
+    seq->num_items = 0;
+    seq->allocated = 0;
+    seq->items = NULL;
+
+    if (refill(seq)) {
+        Py_DECREF(seq);
+        return NULL;
+    }
+    return (PyObject*)seq;
+}
+
+/*
+  Get the sequence for the attribute with the given name of the given
+  owner, reusing an earlier one from the same pass and function if
+  possible
+*/
+PyObject *
+PyGccWrapperSequence_Get(PyObject *owner,
+                         const char *name,
+                         PyGccWrapperSequence_FillFn fill,
+                         PyGccWrapperSequence_ItemFn make_item)
+{
+    PyObject *key = NULL;
+    PyObject *seq = NULL;
+
+    assert(owner);
+    assert(name);
+    assert(fill);
+    assert(make_item);
+
+    get_generation();
+
+    /* The cache is lazily created: */
+    if (!sequence_cache) {
+        sequence_cache = PyDict_New();
+        if (!sequence_cache) {
+            return NULL;
+        }
+    }
+
+    /* The cached sequence holds a reference to the owner, so the owner's
+       address can't be reused whilst it's in the cache: */
+    key = Py_BuildValue("(Ns)", PyLong_FromVoidPtr(owner), name);
+    if (!key) {
+        return NULL;
+    }
+
+    seq = PyDict_GetItem(sequence_cache, key);
+    if (seq) {
+        Py_DECREF(key);
+        Py_INCREF(seq);
+        return seq;
+    }
+
+    seq = make_sequence(owner, fill, make_item);
+    if (!seq) {
+        Py_DECREF(key);
+        return NULL;
+    }
+
+    if (PyDict_SetItem(sequence_cache, key, seq)) {
+        Py_DECREF(key);
+        Py_DECREF(seq);
+        return NULL;
+    }
+    Py_DECREF(key);
+    return seq;
+}
+
+void
+PyGccWrapperSequence_dealloc(PyObject *obj)
+{
+    PyGccWrapperSequence *self = (PyGccWrapperSequence *)obj;
+    Py_XDECREF(self->owner);
+    PyMem_Free(self->items);
+    Py_TYPE(obj)->tp_free(obj);
+}
+
+Py_ssize_t
+PyGccWrapperSequence_len(PyGccWrapperSequence *self)
+{
+    if (sync_with_ir(self)) {
+        return -1;
+    }
+    return self->num_items;
+}
+
+PyObject *
+PyGccWrapperSequence_item(PyGccWrapperSequence *self, Py_ssize_t i)
+{
+    if (sync_with_ir(self)) {
+        return NULL;
+    }
+    if (i < 0 || i >= self->num_items) {
+        PyErr_SetString(PyExc_IndexError,
+                        "gcc.WrapperSequence index out of range");
+        return NULL;
+    }
+    return self->make_item(self->items[i]);
+}
+
+/* Build a list of wrapper objects for all of the items: */
+static PyObject *
+as_list(PyGccWrapperSequence *self)
+{
+    PyObject *result;
+    Py_ssize_t i;
+
+    if (sync_with_ir(self)) {
+        return NULL;
+    }
+    result = PyList_New(self->num_items);
+    if (!result) {
+        return NULL;
+    }
+    for (i = 0; i < self->num_items; i++) {
+        PyObject *item = self->make_item(self->items[i]);
+        if (!item) {
+            Py_DECREF(result);
+            return NULL;
+        }
+        PyList_SET_ITEM(result, i, item);
+    }
+    return result;
+}
+
+PyObject *
+PyGccWrapperSequence_subscript(PyGccWrapperSequence *self, PyObject *key)
+{
+    PyObject *list;
+    PyObject *result;
+
+    if (PyIndex_Check(key)) {
+        Py_ssize_t i = PyNumber_AsSsize_t(key, PyExc_IndexError);
+        if (i == -1 && PyErr_Occurred()) {
+            return NULL;
+        }
+        if (sync_with_ir(self)) {
+            return NULL;
+        }
+        if (i < 0) {
+            i += self->num_items;
+        }
+        return PyGccWrapperSequence_item(self, i);
+    }
+
+    /* Slices give a list, for simplicity: */
+    list = as_list(self);
+    if (!list) {
+        return NULL;
+    }
+    result = PyObject_GetItem(list, key);
+    Py_DECREF(list);
+    return result;
+}
+
+PyObject *
+PyGccWrapperSequence_repr(PyGccWrapperSequence *self)
+{
+    PyObject *list;
+    PyObject *result;
+
+    /* Same as the repr of the equivalent list: */
+    list = as_list(self);
+    if (!list) {
+        return NULL;
+    }
+    result = PyObject_Repr(list);
+    Py_DECREF(list);
+    return result;
+}
+
+/* Get a new reference to obj, or to the list equivalent to it: */
+static PyObject *
+as_comparable(PyObject *obj)
+{
+    if (Py_TYPE(obj) == &PyGccWrapperSequence_TypeObj) {
+        return as_list((PyGccWrapperSequence *)obj);
+    }
+    Py_INCREF(obj);
+    return obj;
+}
+
+PyObject *
+PyGccWrapperSequence_richcompare(PyObject *o1, PyObject *o2, int op)
+{
+    PyObject *l1 = NULL;
+    PyObject *l2 = NULL;
+    PyObject *result = NULL;
+
+    /* Compare as lists: */
+    l1 = as_comparable(o1);
+    if (!l1) {
+        goto cleanup;
+    }
+    l2 = as_comparable(o2);
+    if (!l2) {
+        goto cleanup;
+    }
+    result = PyObject_RichCompare(l1, l2, op);
+
+ cleanup:
+    Py_XDECREF(l1);
+    Py_XDECREF(l2);
+    return result;
+}
+
+/*
+  PEP-7
+Local variables:
+c-basic-offset: 4
+indent-tabs-mode: nil
+End:
+*/
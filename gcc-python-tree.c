@@ -344,6 +344,17 @@ PyGccFunctionDecl_get_fullname(struct PyGccTree *self, void *closure)
     return PyGccString_FromString(str);
 }
 
+PyObject *
+PyGccFunctionDecl_get_assembler_name(struct PyGccTree *self, void *closure)
+{
+    /* (this computes the name, if it hasn't been set yet) */
+    tree name = DECL_ASSEMBLER_NAME(self->t.inner);
+    if (!name) {
+        Py_RETURN_NONE;
+    }
+    return PyGccString_FromString(IDENTIFIER_POINTER(name));
+}
+
 PyObject *
 PyGccFunctionDecl_get_callgraph_node(struct PyGccTree *self, void *closure)
 {
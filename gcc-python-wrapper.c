@@ -314,6 +314,10 @@ my_walker(void *arg ATTRIBUTE_UNUSED)
     if (debug_PyGcc_wrapper) {
         printf("  finished walking the live PyGccWrapper objects\n");
     }
+
+    /* Also keep alive any function whose dominance information we built
+       on demand (see gcc-python-cfg.c): */
+    PyGcc_MarkDominanceInfo();
 }
 
 static struct ggc_root_tab myroottab[] = {
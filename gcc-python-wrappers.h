@@ -80,6 +80,51 @@ As per IMPL_LIST_MAKER, but for a global iterator that takes no ARG
     }                                 \
     return result;
 
+/*
+  Create a callback for use in a gcc for_each iterator, recording the
+  underlying pointers of the gcc objects being iterated into a
+  gcc.WrapperSequence (NULL pointers are skipped)
+*/
+#define IMPL_SEQUENCE_APPENDER(FNNAME, KIND)                  \
+  static bool FNNAME(KIND var, void *user_data)                 \
+  {                                                             \
+      union { KIND var; void *ptr; } u;                         \
+      u.var = var;                                              \
+      if (!u.ptr) {                                             \
+          return false;                                         \
+      }                                                         \
+      return (-1 == PyGccWrapperSequence_Append(                \
+                        (PyGccWrapperSequence*)user_data,       \
+                        u.ptr));                                \
+  }
+
+/*
+  Create a PyGccWrapperSequence_ItemFn, converting one of the recorded
+  pointers back to a KIND and calling MAKE_WRAPPER on it
+*/
+#define IMPL_SEQUENCE_ITEM_MAKER(FNNAME, KIND, MAKE_WRAPPER)  \
+  static PyObject *FNNAME(void *ptr)                            \
+  {                                                             \
+      union { KIND var; void *ptr; } u;                         \
+      u.ptr = ptr;                                              \
+      return MAKE_WRAPPER(u.var);                               \
+  }
+
+/*
+  Create a PyGccWrapperSequence_FillFn, calling a for_each ITERATOR on
+  the owner's OWNER_FIELD (the owner being a wrapper of type OWNER_TYPE),
+  with the given APPENDER callback
+*/
+#define IMPL_SEQUENCE_FILLER(FNNAME, OWNER_TYPE, OWNER_FIELD, ITERATOR, APPENDER) \
+  static int FNNAME(PyGccWrapperSequence *seq)                          \
+  {                                                                     \
+      OWNER_TYPE *owner = (OWNER_TYPE *)seq->owner;                     \
+      if (ITERATOR(owner->OWNER_FIELD, APPENDER, seq)) {                \
+          return -1;                                                    \
+      }                                                                 \
+      return 0;                                                         \
+  }
+
 PyMODINIT_FUNC initoptpass(void);
 
 /* gcc-python-attribute.c: */
@@ -114,18 +159,40 @@ PyGccCallgraphNode_get_callees(struct PyGccCallgraphNode * self);
 PyObject *
 PyGcc_get_callgraph_nodes(PyObject *self, PyObject *args);
 
+/* autogenerated-diagnostics.c: */
+PyObject*
+PyGcc_permerror(PyObject *self, PYGCC_FASTCALL_ARGS);
+
+PyObject *
+PyGcc_error(PyObject *self, PYGCC_FASTCALL_KWARGS);
+
+PyObject *
+PyGcc_warning(PyObject *self, PYGCC_FASTCALL_KWARGS);
+
+PyObject *
+PyGcc_inform(PyObject *self, PYGCC_FASTCALL_KWARGS);
+
 /* gcc-python-diagnostics.c: */
 PyObject*
-PyGcc_permerror(PyObject *self, PyObject *args);
+PyGcc_permerror_impl(PyObject *self, struct PyGccLocation *loc_obj,
+                     const char *msg);
 
 PyObject *
-PyGcc_error(PyObject *self, PyObject *args, PyObject *kwargs);
+PyGcc_error_impl(PyObject *self, struct PyGccLocation *loc_obj,
+                 const char *msg);
 
 PyObject *
-PyGcc_warning(PyObject *self, PyObject *args, PyObject *kwargs);
+PyGcc_warning_impl(PyObject *self, struct PyGccLocation *loc_obj,
+                   const char *msg, PyObject *opt_obj);
 
+#if (GCC_VERSION >= 6000)
+PyObject *
+PyGcc_inform_impl(PyObject *self, PyObject *obj, const char *msg);
+#else
 PyObject *
-PyGcc_inform(PyObject *self, PyObject *args, PyObject *kwargs);
+PyGcc_inform_impl(PyObject *self, struct PyGccLocation *loc_obj,
+                  const char *msg);
+#endif
 
 /* gcc-python-pass.c: */
 extern PyObject *
@@ -148,7 +215,7 @@ long
 PyGccLocation_hash(struct PyGccLocation * self);
 
 PyObject *
-PyGccLocation_offset_column(PyGccLocation *self, PyObject *args);
+PyGccLocation_offset_column_impl(PyGccLocation *self, int offset);
 
 #if (GCC_VERSION >= 6000)
 
@@ -185,7 +252,58 @@ PyObject *
 PyGccCfg_get_basic_blocks(PyGccCfg *self, void *closure);
 
 PyObject *
-PyGccCfg_get_block_for_label(PyObject *self, PyObject *args);
+PyGccCfg_get_block_for_label_impl(struct PyGccCfg *self,
+                                  struct PyGccTree *label_decl);
+
+PyObject *
+PyGccBasicBlock_get_idom(PyGccBasicBlock *self, void *closure);
+
+PyObject *
+PyGccBasicBlock_get_ipostdom(PyGccBasicBlock *self, void *closure);
+
+PyObject *
+PyGccBasicBlock_get_dom_children(PyGccBasicBlock *self, void *closure);
+
+PyObject *
+PyGccBasicBlock_get_postdom_children(PyGccBasicBlock *self, void *closure);
+
+PyObject *
+PyGccBasicBlock_dominated_by_impl(struct PyGccBasicBlock *self,
+                                  struct PyGccBasicBlock *other);
+
+PyObject *
+PyGccBasicBlock_postdominated_by_impl(struct PyGccBasicBlock *self,
+                                      struct PyGccBasicBlock *other);
+
+PyObject *
+PyGccBasicBlock_iter_dominated(PyGccBasicBlock *self, PyObject *args);
+
+void
+PyGcc_FreeDominanceInfo(void);
+
+void
+PyGcc_FreeStaleDominanceInfo(void);
+
+void
+PyGcc_MarkDominanceInfo(void);
+
+PyObject *
+PyGccLoop_repr(struct PyGccLoop *self);
+
+PyObject *
+PyGccLoop_get_outer(struct PyGccLoop *self, void *closure);
+
+PyObject *
+PyGccLoop_get_inner(struct PyGccLoop *self, void *closure);
+
+PyObject *
+PyGccLoop_get_blocks(struct PyGccLoop *self, void *closure);
+
+PyObject *
+PyGccLoop_get_exits(struct PyGccLoop *self, void *closure);
+
+PyObject *
+PyGccFunction_get_loops(struct PyGccFunction *self, void *closure);
 
 /* autogenerated-tree.c: */
 
@@ -194,6 +312,25 @@ int
 PyGcc_tree_type_object_as_tree_code(PyObject *cls,
                                          enum tree_code *out);
 
+/* gcc-python-sequence.c: */
+void
+PyGccWrapperSequence_dealloc(PyObject *obj);
+
+Py_ssize_t
+PyGccWrapperSequence_len(PyGccWrapperSequence *self);
+
+PyObject *
+PyGccWrapperSequence_item(PyGccWrapperSequence *self, Py_ssize_t i);
+
+PyObject *
+PyGccWrapperSequence_subscript(PyGccWrapperSequence *self, PyObject *key);
+
+PyObject *
+PyGccWrapperSequence_repr(PyGccWrapperSequence *self);
+
+PyObject *
+PyGccWrapperSequence_richcompare(PyObject *o1, PyObject *o2, int op);
+
 /* gcc-python-tree.c: */
 /* FIXME: autogenerate these: */
 extern gcc_decl
@@ -271,6 +408,9 @@ PyGccDeclaration_repr(struct PyGccTree * self);
 PyObject *
 PyGccFunctionDecl_get_fullname(struct PyGccTree *self, void *closure);
 
+PyObject *
+PyGccFunctionDecl_get_assembler_name(struct PyGccTree *self, void *closure);
+
 PyObject *
 PyGccFunctionDecl_get_callgraph_node(struct PyGccTree *self, void *closure);
 
@@ -401,6 +541,14 @@ PyGccGimple_get_str_no_uid(struct PyGccGimple *self, void *closure);
 PyObject *
 PyGccGimpleCall_get_args(struct PyGccGimple *self, void *closure);
 
+PyObject *
+PyGccGimple_get_decoded(struct PyGccGimple *self, void *closure);
+
+extern PyTypeObject PyGccDecodedGimple_TypeObj;
+
+int
+PyGccDecodedGimple_InitType(void);
+
 PyObject *
 PyGccGimpleLabel_repr(PyObject * self);
 
@@ -447,6 +595,12 @@ PyGccPass_get_dump_enabled(struct PyGccPass *self, void *closure);
 int
 PyGccPass_set_dump_enabled(struct PyGccPass *self, PyObject *value, void *closure);
 
+PyObject *
+PyGccPass_get_enabled(struct PyGccPass *self, void *closure);
+
+int
+PyGccPass_set_enabled(struct PyGccPass *self, PyObject *value, void *closure);
+
 PyObject *
 PyGccPass_get_roots(PyObject *cls, PyObject *noargs);
 
@@ -18,6 +18,7 @@
 */
 
 #include <Python.h>
+#include <time.h>
 #include "gcc-python.h"
 
 #include "gcc-python-closure.h"
@@ -418,21 +419,23 @@ static PyMethodDef GccMethods[] = {
      "Pre-define a named value in the preprocessor."},
 
     /* Diagnostics: */
-    {"permerror", PyGcc_permerror, METH_VARARGS,
+    {"permerror",
+     (PyCFunction)PyGcc_permerror,
+     PYGCC_METH_FASTCALL,
      NULL},
     {"error",
      (PyCFunction)PyGcc_error,
-     (METH_VARARGS | METH_KEYWORDS),
+     PYGCC_METH_FASTCALL_KEYWORDS,
      ("Report an error\n"
       "FIXME\n")},
     {"warning",
      (PyCFunction)PyGcc_warning,
-     (METH_VARARGS | METH_KEYWORDS),
+     PYGCC_METH_FASTCALL_KEYWORDS,
      ("Report a warning\n"
       "FIXME\n")},
     {"inform",
      (PyCFunction)PyGcc_inform,
-     (METH_VARARGS | METH_KEYWORDS),
+     PYGCC_METH_FASTCALL_KEYWORDS,
      ("Report an information message\n"
       "FIXME\n")},
     {"set_location",
@@ -674,6 +677,11 @@ setup_sys(struct plugin_name_args *plugin_info)
      find modules relative to itself without needing PYTHONPATH to be set up.
      (sys.path has already been initialized by the call to Py_Initialize)
 
+     * If there's a "PLUGIN_BASE_NAME-modules.zip" alongside the plugin (as
+     built by misc/make-modules-zip.py), add it to "sys.path" ahead of the
+     plugin's directory, so that gccutils, libcpychecker etc are imported
+     as precompiled bytecode from a single archive
+
      * If PLUGIN_PYTHONPATH is defined, add it to "sys.path"
 
     */
@@ -683,7 +691,13 @@ setup_sys(struct plugin_name_args *plugin_info)
     const char *program =
       "import sys;\n"
       "import os;\n"
-      "sys.path.append(os.path.abspath(os.path.dirname(sys.plugin_full_name)))\n";
+      "_plugin_dir = os.path.abspath(os.path.dirname(sys.plugin_full_name))\n"
+      "_modules_zip = os.path.join(_plugin_dir,\n"
+      "                            sys.plugin_base_name + '-modules.zip')\n"
+      "if os.path.exists(_modules_zip):\n"
+      "    sys.path.append(_modules_zip)\n"
+      "sys.path.append(_plugin_dir)\n"
+      "del _plugin_dir, _modules_zip\n";
 
     /* Setup "sys.plugin_full_name" */
     full_name = PyGccString_FromString(plugin_info->full_name);
@@ -738,6 +752,19 @@ setup_sys(struct plugin_name_args *plugin_info)
     return result;
 }
 
+/*
+  Wired up to PLUGIN_PASS_EXECUTION, this callback frees any dominance
+  information that was built on demand during the previous pass, before
+  the next one runs.  Information built by a script's own
+  PLUGIN_PASS_EXECUTION callbacks is freed as each of them returns (see
+  gcc-python-callbacks.c), whichever order GCC runs them in:
+*/
+static void
+on_pass_execution(void *gcc_data, void *user_data)
+{
+    PyGcc_FreeStaleDominanceInfo();
+}
+
 /*
   Wired up to PLUGIN_FINISH, this callback handles finalization for the plugin:
 */
@@ -752,6 +779,72 @@ on_plugin_finish(void *gcc_data, void *user_data)
     Py_Finalize();
 }
 
+/*
+  Support for -fplugin-arg-python-startup-stats, which reports to stderr on
+  how long each phase of plugin_init took, to help track down where the
+  per-invocation startup cost of the plugin goes:
+*/
+static int startup_stats_enabled;
+static double startup_stats_start_time;
+static double startup_stats_prev_time;
+
+static double
+get_monotonic_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+static void
+startup_stats_init(struct plugin_name_args *plugin_info)
+{
+    int i;
+
+    for (i = 0; i < plugin_info->argc; i++) {
+        if (0 == strcmp(plugin_info->argv[i].key, "startup-stats")) {
+            startup_stats_enabled = 1;
+        }
+    }
+    if (startup_stats_enabled) {
+        startup_stats_start_time = get_monotonic_time();
+        startup_stats_prev_time = startup_stats_start_time;
+    }
+}
+
+static void
+startup_stats_phase(const char *phase)
+{
+    double now;
+
+    if (!startup_stats_enabled) {
+        return;
+    }
+    now = get_monotonic_time();
+    fprintf(stderr, "startup-stats: %-24s %9.3f ms\n",
+            phase, (now - startup_stats_prev_time) * 1000.0);
+    startup_stats_prev_time = now;
+}
+
+static void
+startup_stats_finish(void)
+{
+    PyObject *modules; /* borrowed ref */
+
+    if (!startup_stats_enabled) {
+        return;
+    }
+    fprintf(stderr, "startup-stats: %-24s %9.3f ms\n",
+            "total",
+            (get_monotonic_time() - startup_stats_start_time) * 1000.0);
+    modules = PySys_GetObject((char*)"modules");
+    if (modules) {
+        fprintf(stderr, "startup-stats: %-24s %9i\n",
+                "modules imported", (int)PyDict_Size(modules));
+    }
+}
+
 extern int
 plugin_init (struct plugin_name_args *plugin_info,
              struct plugin_gcc_version *version) __attribute__((nonnull));
@@ -766,6 +859,8 @@ plugin_init (struct plugin_name_args *plugin_info,
         return 1;
     }
 
+    startup_stats_init(plugin_info);
+
 #if PY_MAJOR_VERSION >= 3
     /*
       Python 3 added internal buffering to sys.stdout and sys.stderr, but this
@@ -786,6 +881,8 @@ plugin_init (struct plugin_name_args *plugin_info,
 
     LOG("Py_Initialize finished");
 
+    startup_stats_phase("Py_Initialize");
+
     PyGcc_globals.module = PyImport_ImportModule("gcc");
 
     PyEval_InitThreads();
@@ -798,6 +895,8 @@ plugin_init (struct plugin_name_args *plugin_info,
         return 1;
     }
 
+    startup_stats_phase("gcc module, sys.path");
+
     /* Init other modules */
     PyGcc_wrapper_init();
 
@@ -815,6 +914,7 @@ plugin_init (struct plugin_name_args *plugin_info,
     autogenerated_pass_init_types();  /* FIXME: error checking! */
     autogenerated_pretty_printer_init_types();  /* FIXME: error checking! */
     autogenerated_rtl_init_types(); /* FIXME: error checking! */
+    autogenerated_sequence_init_types(); /* FIXME: error checking! */
     autogenerated_tree_init_types(); /* FIXME: error checking! */
     autogenerated_variable_init_types(); /* FIXME: error checking! */
 
@@ -830,16 +930,26 @@ plugin_init (struct plugin_name_args *plugin_info,
     autogenerated_pass_add_types(PyGcc_globals.module);
     autogenerated_pretty_printer_add_types(PyGcc_globals.module);
     autogenerated_rtl_add_types(PyGcc_globals.module);
+    autogenerated_sequence_add_types(PyGcc_globals.module);
     autogenerated_tree_add_types(PyGcc_globals.module);
     autogenerated_variable_add_types(PyGcc_globals.module);
 
+    startup_stats_phase("wrapper types");
 
     /* Register at-exit finalization for the plugin: */
     register_callback(plugin_info->base_name, PLUGIN_FINISH,
                       on_plugin_finish, NULL);
 
+    register_callback(plugin_info->base_name, PLUGIN_PASS_EXECUTION,
+                      on_pass_execution, NULL);
+
     PyGcc_run_any_command();
+    startup_stats_phase("command");
+
     PyGcc_run_any_script();
+    startup_stats_phase("script");
+
+    startup_stats_finish();
 
     //printf("%s:%i:got here\n", __FILE__, __LINE__);
 
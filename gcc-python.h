@@ -216,6 +216,11 @@ DECLARE_SIMPLE_WRAPPER(PyGccCfg,
 		       cfg,
                        gcc_cfg, cfg)
 
+DECLARE_SIMPLE_WRAPPER(PyGccLoop,
+		       PyGccLoop_TypeObj,
+		       loop,
+                       gcc_loop, loop)
+
 DECLARE_SIMPLE_WRAPPER(PyGccFunction, 
 		       PyGccFunction_TypeObj,
 		       function,
@@ -293,6 +298,10 @@ int autogenerated_pretty_printer_init_types(void);
 void autogenerated_pretty_printer_add_types(PyObject *m);
 
 
+/* autogenerated-sequence.c */
+int autogenerated_sequence_init_types(void);
+void autogenerated_sequence_add_types(PyObject *m);
+
 /* autogenerated-rtl.c */
 int autogenerated_rtl_init_types(void);
 void autogenerated_rtl_add_types(PyObject *m);
@@ -356,6 +365,51 @@ PyGcc_insert_new_wrapper_into_cache(PyObject **cache,
                                          PyObject *obj);
 
 
+/*
+  gcc.WrapperSequence: a read-only sequence of wrapper objects for a list
+  of GCC objects belonging to some "owner" wrapper (e.g. the gcc.Gimple
+  statements within a gcc.BasicBlock).
+
+  Only the underlying GCC pointers are gathered; the Python wrappers are
+  created on demand, when individual items are accessed.  The sequence
+  holds a reference to the owner, so that the underlying objects are kept
+  alive with respect to GCC's garbage collector.
+*/
+struct PyGccWrapperSequence;
+
+/* Callback to (re)populate a sequence from its owner: */
+typedef int (*PyGccWrapperSequence_FillFn)(struct PyGccWrapperSequence *seq);
+
+/* Callback to make a wrapper object for one of the pointers: */
+typedef PyObject *(*PyGccWrapperSequence_ItemFn)(void *ptr);
+
+struct PyGccWrapperSequence {
+    PyObject_HEAD
+    PyObject *owner;
+    PyGccWrapperSequence_FillFn fill;
+    PyGccWrapperSequence_ItemFn make_item;
+    Py_ssize_t num_items;
+    Py_ssize_t allocated;
+    void **items;
+    unsigned long generation;
+};
+
+typedef struct PyGccWrapperSequence PyGccWrapperSequence;
+
+extern PyTypeObject PyGccWrapperSequence_TypeObj;
+
+unsigned long
+PyGccWrapperSequence_GetGeneration(void);
+
+PyObject *
+PyGccWrapperSequence_Get(PyObject *owner,
+                         const char *name,
+                         PyGccWrapperSequence_FillFn fill,
+                         PyGccWrapperSequence_ItemFn make_item);
+
+int
+PyGccWrapperSequence_Append(PyGccWrapperSequence *seq, void *ptr);
+
 /* gcc-python.c */
 int PyGcc_IsWithinEvent(enum plugin_event *out_event);
 
@@ -369,6 +423,28 @@ void PyGcc_PrintException(const char *msg);
 PyObject *
 PyGcc_GetReprOfAttribute(PyObject *obj, const char *attrname);
 
+/*
+  The functions generated by cpybuilder.PyArgParser use the METH_FASTCALL
+  calling convention where the Python runtime supports it (see
+  cpybuilder.FASTCALL_CONDITION), and METH_VARARGS elsewhere.  These macros
+  give their parameters and flags, for use by hand-written code:
+*/
+#if PY_VERSION_HEX >= 0x03070000
+#define PYGCC_FASTCALL_ARGS \
+    PyObject *const *args, Py_ssize_t nargs
+#define PYGCC_FASTCALL_KWARGS \
+    PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames
+#define PYGCC_METH_FASTCALL METH_FASTCALL
+#define PYGCC_METH_FASTCALL_KEYWORDS (METH_FASTCALL | METH_KEYWORDS)
+#else
+#define PYGCC_FASTCALL_ARGS \
+    PyObject *args
+#define PYGCC_FASTCALL_KWARGS \
+    PyObject *args, PyObject *kwargs
+#define PYGCC_METH_FASTCALL METH_VARARGS
+#define PYGCC_METH_FASTCALL_KEYWORDS (METH_VARARGS | METH_KEYWORDS)
+#endif
+
 /* Python 2 vs Python 3 compat: */
 #if PY_MAJOR_VERSION == 3
 /* Python 3: use PyUnicode for "str" and PyLong for "int": */
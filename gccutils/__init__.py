@@ -17,6 +17,8 @@
 
 import gcc
 
+from six import StringIO
+
 def sorted_dict_repr(d):
     return '{' + ', '.join(['%r: %r' % (k, d[k])
                             for k in sorted(d.keys())]) + '}'
@@ -45,6 +47,47 @@ def get_global_typedef(name):
                 if isinstance(v, gcc.TypeDecl):
                     if v.name == name:
                         return v
+    if gcc.is_lto():
+        return get_lto_typedefs().get(name)
+
+# Within lto1, the translation units are read back in without their
+# top-level blocks, so get_lto_typedefs() gathers the typedefs from the
+# types that the program's declarations use (they survive as the names of
+# those types).  It's only gathered once per process:
+_lto_typedefs = None
+
+def get_lto_typedefs():
+    """
+    Get a dict from name to gcc.TypeDecl, for the typedefs reachable from the
+    types of the variables and functions of the program being linked
+    """
+    global _lto_typedefs
+    if _lto_typedefs is not None:
+        return _lto_typedefs
+    _lto_typedefs = {}
+    seen = set()
+    todo = [var.decl.type for var in gcc.get_variables()]
+    for node in gcc.get_callgraph_nodes():
+        todo.append(node.decl.type)
+        fun = node.decl.function
+        if fun:
+            todo += [decl.type for decl in (fun.local_decls or [])]
+    while todo:
+        t = todo.pop()
+        if t is None or t in seen:
+            continue
+        seen.add(t)
+        if isinstance(t.name, gcc.TypeDecl) and t.name.name:
+            _lto_typedefs.setdefault(t.name.name, t.name)
+        if isinstance(t, (gcc.PointerType, gcc.ArrayType)):
+            todo.append(t.dereference)
+        elif isinstance(t, (gcc.RecordType, gcc.UnionType)):
+            todo += [field.type for field in t.fields
+                     if isinstance(field, gcc.FieldDecl)]
+        elif isinstance(t, (gcc.FunctionType, gcc.MethodType)):
+            todo.append(t.type)
+            todo += list(t.argument_types or [])
+    return _lto_typedefs
 
 def get_variables_as_dict():
     result = {}
@@ -99,25 +142,34 @@ def get_nonnull_arguments(funtype):
         # No "nonnull" attribute was given:
         return frozenset()
 
-def invoke_dot(dot, name='test'):
+def invoke_dot(dot, name='test', fmt='png'):
+    """
+    Render graphviz source using "dot", and open the result in a viewer.
+
+    "dot" can either be the source as a string, or a callable that writes
+    the source to the file-like object it is passed (e.g. the write_dot
+    method of a CfgPrettyPrinter), in which case it's streamed directly
+    to graphviz, without building the whole document in memory.
+
+    fmt is the output format e.g. 'png' or 'svg'.  (SVG generation seems
+    to work, but am seeing some text-width issues with rendering of the SVG
+    by eog and firefox on this machine (though not chromium).  Looks like X
+    coordinates allocated by graphviz don't contain quite enough space for
+    the <text> elements.  Presumably a font selection/font metrics issue)
+    """
     from subprocess import Popen, PIPE
 
-    if 1:
-        fmt = 'png'
-    else:
-        # SVG generation seems to work, but am seeing some text-width issues
-        # with rendering of the SVG  by eog and firefox on this machine (though
-        # not chromium).
-        #
-        # Looks like X coordinates allocated by graphviz don't contain quite
-        # enough space for the <text> elements.
-        #
-        # Presumably a font selection/font metrics issue
-        fmt = 'svg'
     filename = '%s.%s' % (name, fmt)
-    p = Popen(['dot', '-T%s' % fmt, '-o', filename],
-              stdin=PIPE)
-    p.communicate(dot.encode('ascii'))
+    if hasattr(dot, '__call__'):
+        p = Popen(['dot', '-T%s' % fmt, '-o', filename],
+                  stdin=PIPE, universal_newlines=True)
+        dot(p.stdin)
+        p.stdin.close()
+        p.wait()
+    else:
+        p = Popen(['dot', '-T%s' % fmt, '-o', filename],
+                  stdin=PIPE)
+        p.communicate(dot.encode('ascii'))
 
     p = Popen(['xdg-open', filename])
     p.communicate()
@@ -260,82 +312,100 @@ class DotPrettyPrinter(PrettyPrinter):
     def _dot_tr(self, td_text):
         return ('<tr>%s</tr>\n' % self._dot_td(td_text))
 
-try:
-    from pygments.formatter import Formatter
-    from pygments.token import Token
-    from pygments.styles import get_style_by_name
-
-    class GraphvizHtmlFormatter(Formatter, DotPrettyPrinter):
-        """
-        A pygments Formatter to turn source code fragments into graphviz's
-        pseudo-HTML format.
-        """
-        def __init__(self, style):
-            Formatter.__init__(self)
-            self.style = style
-
-        def style_for_token(self, token):
-            # Return a (hexcolor, isbold) pair, where hexcolor could be None
-
-            # Lookup up pygments' color for this token type:
-            col = self.style.styles[token]
-
-            isbold = False
-
-            # Extract a pure hex color specifier of the form that graphviz can
-            # deal with
-            if col:
-                if col.startswith('bold '):
-                    isbold = True
-                    col = col[5:]
-            return (col, isbold)
-
-        def format_unencoded(self, tokensource, outfile):
-            from pprint import pprint
-            for t, piece in tokensource:
-                # graphviz seems to choke on font elements with no inner text:
-                if piece == '':
-                    continue
-
-                # pygments seems to add this:
-                if piece == '\n':
-                    continue
-
-                # avoid croaking on '\n':
-                if t == Token.Literal.String.Escape:
-                    continue
+# Whether pygments is available (None until we've tried to import it)
+using_pygments = None
 
-                color, isbold = self.style_for_token(t)
-                if 0:
-                    print ('(color, isbold): (%r, %r)' % (color, isbold))
+def _load_pygments():
+    """
+    Import pygments, defining GraphvizHtmlFormatter and
+    code_to_graphviz_html() if it's available.
 
-                if isbold:
-                    outfile.write('<b>')
+    This is deferred until the first time that source code is rendered:
+    importing pygments is a significant part of the plugin's startup time,
+    and most compilations never need it.
+    """
+    global using_pygments, GraphvizHtmlFormatter, code_to_graphviz_html
+    try:
+        from pygments.formatter import Formatter
+        from pygments.token import Token
+        from pygments.styles import get_style_by_name
+
+        class GraphvizHtmlFormatter(Formatter, DotPrettyPrinter):
+            """
+            A pygments Formatter to turn source code fragments into graphviz's
+            pseudo-HTML format.
+            """
+            def __init__(self, style):
+                Formatter.__init__(self)
+                self.style = style
+
+            def style_for_token(self, token):
+                # Return a (hexcolor, isbold) pair, where hexcolor could be None
+
+                # Lookup up pygments' color for this token type:
+                col = self.style.styles[token]
+
+                isbold = False
+
+                # Extract a pure hex color specifier of the form that graphviz can
+                # deal with
+                if col:
+                    if col.startswith('bold '):
+                        isbold = True
+                        col = col[5:]
+                return (col, isbold)
+
+            def format_unencoded(self, tokensource, outfile):
+                from pprint import pprint
+                for t, piece in tokensource:
+                    # graphviz seems to choke on font elements with no inner text:
+                    if piece == '':
+                        continue
+
+                    # pygments seems to add this:
+                    if piece == '\n':
+                        continue
+
+                    # avoid croaking on '\n':
+                    if t == Token.Literal.String.Escape:
+                        continue
+
+                    color, isbold = self.style_for_token(t)
+                    if 0:
+                        print ('(color, isbold): (%r, %r)' % (color, isbold))
+
+                    if isbold:
+                        outfile.write('<b>')
+
+                    # Avoid empty color="" values:
+                    if color:
+                        outfile.write('<font color="%s">' % color
+                                      + self.to_html(piece)
+                                      + '</font>')
+                    else:
+                        outfile.write(self.to_html(piece))
 
-                # Avoid empty color="" values:
-                if color:
-                    outfile.write('<font color="%s">' % color
-                                  + self.to_html(piece)
-                                  + '</font>')
-                else:
-                    outfile.write(self.to_html(piece))
+                    if isbold:
+                        outfile.write('</b>')
 
-                if isbold:
-                    outfile.write('</b>')
+        from pygments import highlight
+        from pygments.lexers import CLexer
+        from pygments.formatters import HtmlFormatter
 
-    from pygments import highlight
-    from pygments.lexers import CLexer
-    from pygments.formatters import HtmlFormatter
+        def code_to_graphviz_html(code):
+            style = get_style_by_name('default')
+            return highlight(code,
+                             CLexer(), # FIXME
+                             GraphvizHtmlFormatter(style))
 
-    def code_to_graphviz_html(code):
-        style = get_style_by_name('default')
-        return highlight(code,
-                         CLexer(), # FIXME
-                         GraphvizHtmlFormatter(style))
+        using_pygments = True
+    except ImportError:
+        using_pygments = False
 
-    using_pygments = True
-except ImportError:
-    using_pygments = False
+def have_pygments():
+    if using_pygments is None:
+        _load_pygments()
+    return using_pygments
 
 class CfgPrettyPrinter(DotPrettyPrinter):
     # Generate graphviz source for this gcc.Cfg instance, as a string
@@ -357,10 +427,9 @@ class CfgPrettyPrinter(DotPrettyPrinter):
         result = '<font face="monospace"><table cellborder="0" border="0" cellspacing="0">\n'
         result += '<tr> <td>BLOCK %i</td> <td></td> </tr>\n' % bb.index
         curloc = None
-        if isinstance(bb.phi_nodes, list):
-            for stmtidx, phi in enumerate(bb.phi_nodes):
-                result += '<tr><td></td>' + self.stmt_to_html(phi, stmtidx) + '</tr>\n'
-        if isinstance(bb.gimple, list) and bb.gimple != []:
+        for stmtidx, phi in enumerate(bb.phi_nodes):
+            result += '<tr><td></td>' + self.stmt_to_html(phi, stmtidx) + '</tr>\n'
+        if bb.gimple:
             for stmtidx, stmt in enumerate(bb.gimple):
                 if curloc != stmt.loc:
                     curloc = stmt.loc
@@ -383,7 +452,7 @@ class CfgPrettyPrinter(DotPrettyPrinter):
         return result
 
     def code_to_html(self, code):
-        if using_pygments:
+        if have_pygments():
             return code_to_graphviz_html(code)
         else:
             return self.to_html(code)
@@ -438,31 +507,41 @@ class CfgPrettyPrinter(DotPrettyPrinter):
         # Hook for expansion
         return ''
 
+    def write_extra_items(self, out):
+        # Hook for expansion, for subclasses that want to stream their
+        # extra material rather than building it as a string
+        out.write(self.extra_items())
+
     def to_dot(self):
+        out = StringIO()
+        self.write_dot(out)
+        return out.getvalue()
+
+    def write_dot(self, out):
+        # Write the graphviz source to "out", a block at a time
         if hasattr(self, 'name'):
             name = self.name
         else:
             name = 'G'
-        result = 'digraph %s {\n' % name
-        result += ' subgraph cluster_cfg {\n'
-        #result += '  label="CFG";\n'
-        result += '  node [shape=box];\n'
+        out.write('digraph %s {\n' % name)
+        out.write(' subgraph cluster_cfg {\n')
+        #out.write('  label="CFG";\n')
+        out.write('  node [shape=box];\n')
         for block in self.cfg.basic_blocks:
 
-            result += ('  %s [label=<%s>];\n'
-                       % (self.block_id(block), self.block_to_dot_label(block)))
+            out.write('  %s [label=<%s>];\n'
+                      % (self.block_id(block), self.block_to_dot_label(block)))
 
             for edge in block.succs:
-                result += self.edge_to_dot(edge)
+                out.write(self.edge_to_dot(edge))
             # FIXME: this will have duplicates:
             #for edge in block.preds:
-            #    result += edge_to_dot(edge)
-        result += ' }\n'
+            #    out.write(edge_to_dot(edge))
+        out.write(' }\n')
 
         # Potentially add extra material:
-        result += self.extra_items()
-        result += '}\n'
-        return result
+        self.write_extra_items(out)
+        out.write('}\n')
 
 class TreePrettyPrinter(DotPrettyPrinter):
     # Generate a graphviz visualization of this gcc.Tree and the graphs of
@@ -653,27 +732,45 @@ def sorted_callgraph():
 def topological_sort(nodes, get_srcs, get_dsts):
     """
     Topological sort in O(n), based on depth-first traversal
+
+    The traversal uses an explicit stack rather than recursion, so that
+    deep graphs (e.g. long chains of calls) don't hit Python's recursion
+    limit.
+
+    It starts from the nodes with no dsts, and then from any nodes not yet
+    visited, so that cycles with no path to such a node (e.g. a pair of
+    mutually-recursive functions that call nothing else) are included.
     """
     result = []
     visited = set()
     debug = False
-    def visit(n):
-        if n not in visited:
-            if debug:
-                print('first visit to %s' % n.decl)
-            visited.add(n)
-            for m in get_srcs(n):
-                visit(m)
-            if debug:
-                print('adding to result: %s' % n.decl)
-            result.append(n)
-        else:
-            if debug:
-                print('already visited %s' % n.decl)
 
-    for n in nodes:
-        if not get_dsts(n):
-            visit(n)
+    nodes = list(nodes)
+    sinks = [n for n in nodes if not get_dsts(n)]
+    for root in sinks + nodes:
+        if root in visited:
+            if debug:
+                print('already visited %s' % root.decl)
+            continue
+        if debug:
+            print('first visit to %s' % root.decl)
+        visited.add(root)
+        # Each stack entry is a (node, iterator over its srcs) pair; a node
+        # is added to the result once all of its srcs have been visited:
+        stack = [(root, iter(get_srcs(root)))]
+        while stack:
+            n, srcs = stack[-1]
+            for m in srcs:
+                if m not in visited:
+                    if debug:
+                        print('first visit to %s' % m.decl)
+                    visited.add(m)
+                    stack.append((m, iter(get_srcs(m))))
+                    break
+            else:
+                stack.pop()
+                if debug:
+                    print('adding to result: %s' % n.decl)
+                result.append(n)
 
     return result
-
@@ -15,6 +15,8 @@
 #   along with this program.  If not, see
 #   <http://www.gnu.org/licenses/>.
 
+from six import StringIO
+
 from gccutils.dot import to_html
 
 ############################################################################
@@ -67,36 +69,78 @@ class Graph(object):
                 victims += self.remove_node(edge.dstnode)
         return victims
 
-    def to_dot(self, name, ctxt=None):
-        result = 'digraph %s {\n' % name
-        result += '  node [shape=box];\n'
-        result += self._nodes_to_dot(ctxt)
-        result += self._edges_to_dot(ctxt)
-        result += '}\n'
-        return result
+    def to_dot(self, name, ctxt=None, **kwargs):
+        """
+        Generate graphviz source for this graph, as a string.
+
+        The keyword arguments are as per write_dot
+        """
+        out = StringIO()
+        self.write_dot(out, name, ctxt, **kwargs)
+        return out.getvalue()
+
+    def write_dot(self, out, name, ctxt=None,
+                  cluster=True, max_subgraph_nodes=None):
+        """
+        Write graphviz source for this graph to "out" (a file-like object,
+        such as a pipe to "dot"), a node or edge at a time, without
+        building the whole document in memory.
+
+        cluster: if true, group the nodes into clusters according to their
+        get_subgraph_path() (e.g. per function); if false, emit them as one
+        flat graph
+
+        max_subgraph_nodes: if not None, the maximum number of nodes to
+        emit for each cluster; the rest are replaced by a single placeholder
+        node, with their edges redirected to it
+        """
+        out.write('digraph %s {\n' % name)
+        out.write('  node [shape=box];\n')
+        placeholders = self._write_nodes_dot(out, ctxt,
+                                             cluster, max_subgraph_nodes)
+        self._write_edges_dot(out, ctxt, placeholders)
+        out.write('}\n')
+
+    def _write_node_dot(self, out, node, ctxt, indent):
+        out.write('%s%s [label=<%s>];\n'
+                  % (' ' * indent,
+                     node.to_dot_id(),
+                     node.to_dot_label(ctxt)))
+
+    def _write_nodes_dot(self, out, ctxt, cluster, max_subgraph_nodes):
+        """
+        Write out the nodes, returning a dict mapping from the dot id of
+        each node omitted due to max_subgraph_nodes to the dot id of the
+        placeholder node that replaces it
+        """
+        placeholders = {}
+
+        if not cluster:
+            count = 0
+            for node in self.nodes:
+                if max_subgraph_nodes is not None \
+                        and count >= max_subgraph_nodes:
+                    placeholders[node.to_dot_id()] = 'omitted'
+                else:
+                    self._write_node_dot(out, node, ctxt, 2)
+                count += 1
+            if placeholders:
+                out.write('  omitted [label="(%i more nodes)"];\n'
+                          % len(placeholders))
+            return placeholders
 
-    def _nodes_to_dot(self, ctxt):
         # A subgraph path is a tuple of Subgraph instances
 
-        from pprint import pprint
-
         # 1st pass: get the subgraph path for every node
-        # This is a dict from subgraph path to set of nodes:
+        # This is a dict from subgraph path to list of nodes:
         subgraph_paths = {}
         for node in self.nodes:
             subgraph_path = node.get_subgraph_path(ctxt)
             assert isinstance(subgraph_path, tuple)
-            if 0:
-                print('node: %s' % node)
-                print('subgraph_path: %s' % (subgraph_path, ))
             if subgraph_path in subgraph_paths:
-                subgraph_paths[subgraph_path].add(node)
+                subgraph_paths[subgraph_path].append(node)
             else:
-                subgraph_paths[subgraph_path] = set([node])
-
-        if 0:
-            print('subgraph_paths:')
-            pprint(subgraph_paths)
+                subgraph_paths[subgraph_path] = [node]
 
         # 2nd pass: construct a tree of subgraphs:
         # dict from subgraph path (parent) to set of subgraph paths
@@ -108,146 +152,376 @@ class Graph(object):
             if path:
                 for i in range(len(path) + 1):
                     subpath = path[0:i]
-                    if 0:
-                        print('subpath: %s' % (subpath, ))
                     if subpath:
                         parent = subpath[0:-1]
                         if parent in child_paths:
                             child_paths[parent].add(subpath)
                         else:
                             child_paths[parent] = set([subpath])
-        if 0:
-            print('child_paths:')
-            pprint(child_paths)
-
-        # 3rd pass: recursively render the subgraph paths:
-        def render_subgraph_path(subgraph_path, indent):
-            def _indent():
-                return ' ' * indent
-            result = ''
+
+        # 3rd pass: recursively write out the subgraph paths:
+        def write_subgraph_path(subgraph_path, indent):
             if subgraph_path:
-                result += ('%ssubgraph cluster_%s {\n'
-                           % (_indent(), subgraph_path[-1].id))
+                out.write('%ssubgraph cluster_%s {\n'
+                          % (' ' * indent, subgraph_path[-1].id))
                 indent += 2
-                result += ('%slabel = "%s";\n'
-                           % (_indent(), subgraph_path[-1].label))
-
-            for node in subgraph_paths.get(subgraph_path, set()):
-                result += ('%s%s [label=<%s>];\n'
-                           % (_indent(),
-                              node.to_dot_id(),
-                              node.to_dot_label(ctxt)))
+                out.write('%slabel = "%s";\n'
+                          % (' ' * indent, subgraph_path[-1].label))
+
+            nodes = subgraph_paths.get(subgraph_path, [])
+            if max_subgraph_nodes is not None \
+                    and len(nodes) > max_subgraph_nodes:
+                placeholder = 'omitted_%i' % len(placeholders)
+                for node in nodes[max_subgraph_nodes:]:
+                    placeholders[node.to_dot_id()] = placeholder
+                nodes = nodes[:max_subgraph_nodes]
+                out.write('%s%s [label="(%i more nodes)"];\n'
+                          % (' ' * indent, placeholder,
+                             len(subgraph_paths[subgraph_path]) - len(nodes)))
+            for node in nodes:
+                self._write_node_dot(out, node, ctxt, indent)
+
             # Recurse:
             for child_path in child_paths.get(subgraph_path, set()):
-                result += render_subgraph_path(child_path, indent)
+                write_subgraph_path(child_path, indent)
 
             if subgraph_path:
                 indent -= 2
-                result += '%s}\n' % _indent()
-            return result
+                out.write('%s}\n' % (' ' * indent))
 
-        return render_subgraph_path( (), 2)
+        write_subgraph_path( (), 2)
+        return placeholders
 
-    def _edges_to_dot(self, ctxt):
-        result = ''
+    def _write_edges_dot(self, out, ctxt, placeholders):
+        # Edges to/from omitted nodes are redirected to the placeholders;
+        # only emit one such edge per pair of endpoints:
+        redirected = set()
         for edge in self.edges:
-            result += ('    %s -> %s [label=<%s>%s];\n'
-                       % (edge.srcnode.to_dot_id(),
-                          edge.dstnode.to_dot_id(),
-                          edge.to_dot_label(ctxt),
-                          edge.to_dot_attrs(ctxt)))
-        return result
+            srcid = edge.srcnode.to_dot_id()
+            dstid = edge.dstnode.to_dot_id()
+            if placeholders:
+                if srcid in placeholders or dstid in placeholders:
+                    srcid = placeholders.get(srcid, srcid)
+                    dstid = placeholders.get(dstid, dstid)
+                    if srcid == dstid or (srcid, dstid) in redirected:
+                        continue
+                    redirected.add( (srcid, dstid) )
+                    out.write('    %s -> %s;\n' % (srcid, dstid))
+                    continue
+            out.write('    %s -> %s [label=<%s>%s];\n'
+                      % (srcid,
+                         dstid,
+                         edge.to_dot_label(ctxt),
+                         edge.to_dot_attrs(ctxt)))
+
+    def get_index(self):
+        """
+        Get a GraphIndex for the current state of this graph, giving dense
+        integer indices for the nodes and adjacency arrays for the edges.
+
+        This is a snapshot: it doesn't track later changes to the graph.
+        """
+        return GraphIndex.for_nodes(self.nodes)
 
     def topologically_sorted_nodes(self):
-        from gccutils import topological_sort
-        def get_srcs(node):
-            for pred in node.preds:
-                yield pred.srcnode
-        def get_dsts(node):
-            for succ in node.succs:
-                yield succ.dstnode
-        return topological_sort(self.nodes,
-                                get_srcs,
-                                get_dsts)
+        """
+        Get a list of the nodes, with each node appearing after all of its
+        predecessors (within cycles, the order is arbitrary)
+        """
+        idx = self.get_index()
+        n = len(idx.nodes)
+        visited = bytearray(n)
+        result = []
+        # Depth-first traversal backwards from the nodes with no successors,
+        # emitting nodes in postorder.  Use an explicit stack of
+        # (node index, position within its predecessors) pairs, rather than
+        # recursion.  Cycles that can't reach such a node are then picked
+        # up by starting from every node not yet visited:
+        pred_offsets, pred_targets = idx.pred_offsets, idx.pred_targets
+        succ_offsets = idx.succ_offsets
+        sinks = [i for i in range(n)
+                 if succ_offsets[i] == succ_offsets[i + 1]]
+        for root in sinks + list(range(n)):
+            if visited[root]:
+                continue
+            visited[root] = 1
+            stack = [[root, pred_offsets[root]]]
+            while stack:
+                top = stack[-1]
+                i, pos = top
+                end = pred_offsets[i + 1]
+                while pos < end and visited[pred_targets[pos]]:
+                    pos += 1
+                if pos < end:
+                    top[1] = pos + 1
+                    j = pred_targets[pos]
+                    visited[j] = 1
+                    stack.append([j, pred_offsets[j]])
+                else:
+                    stack.pop()
+                    result.append(idx.nodes[i])
+        return result
 
     def get_shortest_path(self, srcnode, dstnode):
         '''
         Locate the shortest path from the srcnode to the dstnode
-        Return a list of Edge instances, or None if no such path exists
+        Return a list of Edge instances, or [] if no such path exists
         '''
-        # Dijkstra's algorithm
-        # A dict giving for each node the length of the shortest known path
-        # from srcnode to this node:
-        distance = {}
-
-        # A dict giving for each node the previous node within that shortest
-        # path:
-        inedge = {}
-
-        INFINITY = 0x80000000
-        for node in self.nodes:
-            distance[node] = INFINITY
-            inedge[node] = None
-        distance[srcnode] = 0
-
-        # We use a heapq to keep the nodes sorted by distance
-        # The items in the heapq are lists of the form:
-        #    [distance_to_node, node, is_live)
-        # The first entry in the list ensures that the heapq is sorted
-        # into the order needed for Dijkstra's algorithm
-        #
-        # Since we can't change the priority of items within a heapq,
-        # whenever we need to update the distance we mark the existing
-        # item as dead (setting the is_live boolean to False), and add a
-        # new entry with the correct value; we ignore dead items during
-        # the iteration
+        # All edges have the same weight, so a breadth-first search finds
+        # the shortest path.  We only touch the nodes that are closer to
+        # srcnode than dstnode is, stopping as soon as we reach dstnode,
+        # rather than initializing state for every node in the graph.
         #
-        # This gets the time taken for a simple 10000 node graph down to
-        # ~3 seconds, compared to minutes/hours.
-        from heapq import heapify, heappop, heappush
-        item_for_node = {}
-        for node in self.nodes:
-            item_for_node[node] = [distance[node], node, True]
-
-        worklist = list(item_for_node.values())
-        heapify(worklist)
-        while worklist:
-            def get_next():
-                while 1:
-                    if not worklist:
-                        return None
-                    disttonode, node, islive = heappop(worklist)
-                    if islive:
-                        return node
-            node = get_next()
-            if node is None:
-                # disjoint
-                break
-            if node == dstnode:
-                # We've found the target node; build a path of the edges to
-                # follow to get here:
-                path = []
-                while inedge[node]:
-                    path = [inedge[node]] + path
-                    node = inedge[node].srcnode
-                return path
-            if distance[node] == INFINITY:
-                # disjoint
-                break
+        # A dict giving for each reached node the edge by which we first
+        # reached it:
+        inedge = {srcnode: None}
+        frontier = [srcnode]
+        while frontier:
+            nextfrontier = []
+            for node in frontier:
+                for edge in node.succs:
+                    dst = edge.dstnode
+                    if dst in inedge:
+                        continue
+                    inedge[dst] = edge
+                    if dst == dstnode:
+                        # We've found the target node; build a path of the
+                        # edges to follow to get here:
+                        path = []
+                        while inedge[dst]:
+                            path.append(inedge[dst])
+                            dst = inedge[dst].srcnode
+                        path.reverse()
+                        return path
+                    nextfrontier.append(dst)
+            frontier = nextfrontier
+        # disjoint
+        return []
+
+    def get_strongly_connected_components(self):
+        """
+        Get the strongly connected components of the graph, using Tarjan's
+        algorithm.
+
+        Return a list of lists of nodes.  The components are in reverse
+        topological order: no edge leads from a component to one
+        earlier in the list.
+        """
+        idx = self.get_index()
+        n = len(idx.nodes)
+        succ_offsets, succ_targets = idx.succ_offsets, idx.succ_targets
+        UNVISITED = -1
+        index = [UNVISITED] * n
+        lowlink = [0] * n
+        onstack = bytearray(n)
+        sccstack = []
+        result = []
+        counter = 0
+        for root in range(n):
+            if index[root] != UNVISITED:
+                continue
+            index[root] = lowlink[root] = counter
+            counter += 1
+            sccstack.append(root)
+            onstack[root] = 1
+            # The "call stack" of the traversal: lists of
+            # (node index, position within its successors):
+            stack = [[root, succ_offsets[root]]]
+            while stack:
+                top = stack[-1]
+                i, pos = top
+                end = succ_offsets[i + 1]
+                descended = False
+                while pos < end:
+                    j = succ_targets[pos]
+                    pos += 1
+                    if index[j] == UNVISITED:
+                        top[1] = pos
+                        index[j] = lowlink[j] = counter
+                        counter += 1
+                        sccstack.append(j)
+                        onstack[j] = 1
+                        stack.append([j, succ_offsets[j]])
+                        descended = True
+                        break
+                    elif onstack[j]:
+                        if index[j] < lowlink[i]:
+                            lowlink[i] = index[j]
+                if descended:
+                    continue
+                # All successors of i have been handled:
+                stack.pop()
+                if stack:
+                    parent = stack[-1][0]
+                    if lowlink[i] < lowlink[parent]:
+                        lowlink[parent] = lowlink[i]
+                if lowlink[i] == index[i]:
+                    # i is the root of a component:
+                    scc = []
+                    while 1:
+                        j = sccstack.pop()
+                        onstack[j] = 0
+                        scc.append(idx.nodes[j])
+                        if j == i:
+                            break
+                    result.append(scc)
+        return result
+
+    def get_immediate_dominators(self, entrynode):
+        """
+        Get a dict mapping from each node reachable from entrynode to its
+        immediate dominator (or None, for entrynode itself)
+
+        Uses the iterative algorithm from Cooper, Harvey and Kennedy's
+        "A Simple, Fast Dominance Algorithm"
+        """
+        idx = self.get_index()
+        return idx.get_immediate_dominators(entrynode, False)
+
+    def get_immediate_postdominators(self, exitnode):
+        """
+        Get a dict mapping from each node that can reach exitnode to its
+        immediate postdominator (or None, for exitnode itself)
+        """
+        idx = self.get_index()
+        return idx.get_immediate_dominators(exitnode, True)
+
+class GraphIndex(object):
+    """
+    A compact snapshot of the structure of a Graph, for use by the graph
+    algorithms.
+
+    Each node is given a dense integer index into self.nodes.  The edges
+    are stored in compressed-sparse-row form: the successors of node i are
+    the node indices:
+        succ_targets[succ_offsets[i]:succ_offsets[i + 1]]
+    and succ_edges holds the corresponding Edge instances, in parallel with
+    succ_targets.  The predecessors are stored similarly.
+    """
+    __slots__ = ('nodes', 'index_of',
+                 'succ_offsets', 'succ_targets', 'succ_edges',
+                 'pred_offsets', 'pred_targets')
+
+    def __init__(self, nodes, index_of,
+                 succ_offsets, succ_targets, succ_edges,
+                 pred_offsets, pred_targets):
+        self.nodes = nodes
+        self.index_of = index_of
+        self.succ_offsets = succ_offsets
+        self.succ_targets = succ_targets
+        self.succ_edges = succ_edges
+        self.pred_offsets = pred_offsets
+        self.pred_targets = pred_targets
+
+    @staticmethod
+    def for_nodes(nodes):
+        """
+        Build a GraphIndex by walking the preds/succs of the given nodes
+        """
+        from array import array
+        nodes = list(nodes)
+        index_of = {}
+        for i, node in enumerate(nodes):
+            index_of[node] = i
+
+        succ_offsets = []
+        succ_targets = []
+        succ_edges = []
+        pred_offsets = []
+        pred_targets = []
+        for node in nodes:
+            succ_offsets.append(len(succ_targets))
             for edge in node.succs:
-                alt = distance[node] + 1
-                if alt < distance[edge.dstnode]:
-                    distance[edge.dstnode] = alt
-                    # Changing the distance of edge.dstnode requires us to
-                    # update the heapq:
-                    # Mark the existing item as dead:
-                    item_for_node[edge.dstnode][2] = False
-                    # Create a new itemwith the new distance:
-                    newitem = [alt, edge.dstnode, True]
-                    item_for_node[edge.dstnode] = newitem
-                    heappush(worklist, newitem)
-                    inedge[edge.dstnode] = edge
-        return None
+                succ_targets.append(index_of[edge.dstnode])
+                succ_edges.append(edge)
+            pred_offsets.append(len(pred_targets))
+            for edge in node.preds:
+                pred_targets.append(index_of[edge.srcnode])
+        succ_offsets.append(len(succ_targets))
+        pred_offsets.append(len(pred_targets))
+
+        return GraphIndex(nodes, index_of,
+                          array('l', succ_offsets),
+                          array('l', succ_targets),
+                          succ_edges,
+                          array('l', pred_offsets),
+                          array('l', pred_targets))
+
+    def get_immediate_dominators(self, rootnode, reverse):
+        if reverse:
+            # Postdominators: walk the edges backwards
+            fwd_offsets, fwd_targets = self.pred_offsets, self.pred_targets
+            back_offsets, back_targets = self.succ_offsets, self.succ_targets
+        else:
+            fwd_offsets, fwd_targets = self.succ_offsets, self.succ_targets
+            back_offsets, back_targets = self.pred_offsets, self.pred_targets
+
+        root = self.index_of[rootnode]
+        n = len(self.nodes)
+
+        # Number the reachable nodes in postorder, iteratively:
+        UNVISITED = -1
+        postorder_num = [UNVISITED] * n
+        postorder = []
+        visited = bytearray(n)
+        visited[root] = 1
+        stack = [[root, fwd_offsets[root]]]
+        while stack:
+            top = stack[-1]
+            i, pos = top
+            end = fwd_offsets[i + 1]
+            while pos < end and visited[fwd_targets[pos]]:
+                pos += 1
+            if pos < end:
+                top[1] = pos + 1
+                j = fwd_targets[pos]
+                visited[j] = 1
+                stack.append([j, fwd_offsets[j]])
+            else:
+                stack.pop()
+                postorder_num[i] = len(postorder)
+                postorder.append(i)
+
+        idom = [UNVISITED] * n
+        idom[root] = root
+
+        def intersect(a, b):
+            while a != b:
+                while postorder_num[a] < postorder_num[b]:
+                    a = idom[a]
+                while postorder_num[b] < postorder_num[a]:
+                    b = idom[b]
+            return a
+
+        # Iterate in reverse postorder until we reach a fixed point:
+        rpo = postorder[::-1]
+        changed = True
+        while changed:
+            changed = False
+            for i in rpo:
+                if i == root:
+                    continue
+                newidom = UNVISITED
+                for pos in range(back_offsets[i], back_offsets[i + 1]):
+                    p = back_targets[pos]
+                    if idom[p] == UNVISITED:
+                        continue
+                    if newidom == UNVISITED:
+                        newidom = p
+                    else:
+                        newidom = intersect(p, newidom)
+                if idom[i] != newidom:
+                    idom[i] = newidom
+                    changed = True
+
+        result = {}
+        nodes = self.nodes
+        for i in postorder:
+            if i == root:
+                result[nodes[i]] = None
+            else:
+                result[nodes[i]] = nodes[idom[i]]
+        return result
 
 
 class Node(object):
@@ -0,0 +1,369 @@
+#   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2012 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+from array import array
+
+from gccutils.graph import Graph, GraphIndex
+
+############################################################################
+# An alternative backend for Graph, for very large graphs (e.g. the
+# supergraph of a whole program).
+#
+# Rather than holding a Node object per node (each with its own "preds" and
+# "succs" sets) and an Edge object per edge, the graph is stored in packed
+# arrays: a "kind" per node and per edge (an index into a table of classes),
+# the source and destination of each edge, plus a column per field named in
+# node_fields/edge_fields.  The adjacency is held in compressed sparse row
+# form, rebuilt lazily after edges are added.
+#
+# Subclasses with fields that can be stored more compactly than as a list
+# of objects (e.g. as integer ids) can instead override _add_node_fields and
+# _add_edge_fields, and supply their own node_view_mixin/edge_view_mixin
+# (subclasses of NodeView/EdgeView), with properties to look up the fields.
+#
+# Node and Edge instances are created on demand as lightweight "views" of
+# the arrays.  A view is an instance of a subclass of the class that was
+# originally passed to add_node/add_edge, so isinstance() checks continue
+# to work.  Views compare equal (and hash) by their position within the
+# graph, so they can be used as dict keys even though a fresh view is made
+# each time one is looked up.
+#
+# Compact graphs are append-only: nodes and edges can't be removed.
+############################################################################
+
+class NodeView(object):
+    """
+    Mixin for the on-demand views of the nodes within a CompactGraph
+    """
+    __slots__ = ()
+
+    @property
+    def preds(self):
+        return self._graph._get_preds(self._index)
+
+    @property
+    def succs(self):
+        return self._graph._get_succs(self._index)
+
+    def to_dot_id(self):
+        return 'node%i' % self._index
+
+    def __eq__(self, other):
+        if isinstance(other, NodeView):
+            return self._graph is other._graph and self._index == other._index
+        return False
+
+    def __ne__(self, other):
+        return not self.__eq__(other)
+
+    def __hash__(self):
+        return self._index
+
+    def __lt__(self, other):
+        return self._index < other._index
+
+class EdgeView(object):
+    """
+    Mixin for the on-demand views of the edges within a CompactGraph
+    """
+    __slots__ = ()
+
+    def __eq__(self, other):
+        if isinstance(other, EdgeView):
+            return self._graph is other._graph and self._index == other._index
+        return False
+
+    def __ne__(self, other):
+        return not self.__eq__(other)
+
+    def __hash__(self):
+        return self._index
+
+class CompactGraph(Graph):
+    __slots__ = ('_kinds', '_kind_index',
+                 '_view_classes',
+                 '_node_kind', '_node_columns',
+                 '_edge_kind', '_edge_src', '_edge_dst', '_edge_columns',
+                 '_csr')
+
+    # Names of the attributes to be stored per node/edge; subclasses
+    # should override these:
+    node_fields = ()
+    edge_fields = ()
+
+    # Mixins for the classes of the views:
+    node_view_mixin = NodeView
+    edge_view_mixin = EdgeView
+
+    def __init__(self):
+        # (deliberately not calling Graph.__init__, since "nodes" and
+        # "edges" are properties here)
+
+        # Table of classes for the "kind" arrays:
+        self._kinds = []
+        self._kind_index = {}
+        # Dict from class to the class used for views of it:
+        self._view_classes = {}
+
+        self._node_kind = array('B')
+        self._node_columns = [[] for field in self.node_fields]
+
+        self._edge_kind = array('B')
+        self._edge_src = array('l')
+        self._edge_dst = array('l')
+        self._edge_columns = [[] for field in self.edge_fields]
+
+        # Lazily-built (succ_offsets, succ_edge_ids,
+        #               pred_offsets, pred_edge_ids):
+        self._csr = None
+
+    #######################################################################
+    # The Graph API
+    #######################################################################
+    @property
+    def nodes(self):
+        return NodeSet(self)
+
+    @property
+    def edges(self):
+        return EdgeSet(self)
+
+    def add_node(self, node):
+        """
+        Record the given Node into the arrays, returning a view of it.
+
+        The Node instance itself is not retained.
+        """
+        idx = len(self._node_kind)
+        self._node_kind.append(self._get_kind(node.__class__))
+        self._add_node_fields(node)
+        return self._make_node_view(idx)
+
+    def add_edge(self, srcnode, dstnode, *args, **kwargs):
+        assert isinstance(srcnode, NodeView)
+        assert isinstance(dstnode, NodeView)
+        assert srcnode._graph is self
+        assert dstnode._graph is self
+        e = self._make_edge(srcnode, dstnode, *args, **kwargs)
+        idx = len(self._edge_kind)
+        self._edge_kind.append(self._get_kind(e.__class__))
+        self._edge_src.append(srcnode._index)
+        self._edge_dst.append(dstnode._index)
+        self._add_edge_fields(e)
+        self._csr = None
+        return self._make_edge_view(idx)
+
+    def _add_node_fields(self, node):
+        for field, column in zip(self.node_fields, self._node_columns):
+            column.append(getattr(node, field, None))
+
+    def _add_edge_fields(self, edge):
+        for field, column in zip(self.edge_fields, self._edge_columns):
+            column.append(getattr(edge, field, None))
+
+    def remove_node(self, node):
+        raise NotImplementedError('compact graphs are append-only')
+
+    def remove_edge(self, edge):
+        raise NotImplementedError('compact graphs are append-only')
+
+    def get_index(self):
+        succ_offsets, succ_edge_ids, pred_offsets, pred_edge_ids = \
+            self._get_csr()
+        edge_src, edge_dst = self._edge_src, self._edge_dst
+        return GraphIndex(NodeList(self),
+                          ViewIndex(self),
+                          succ_offsets,
+                          array('l', [edge_dst[e] for e in succ_edge_ids]),
+                          EdgeList(self, succ_edge_ids),
+                          pred_offsets,
+                          array('l', [edge_src[e] for e in pred_edge_ids]))
+
+    #######################################################################
+    # Views
+    #######################################################################
+    def _get_kind(self, cls):
+        kind = self._kind_index.get(cls)
+        if kind is None:
+            kind = len(self._kinds)
+            assert kind < 256
+            self._kinds.append(cls)
+            self._kind_index[cls] = kind
+        return kind
+
+    def _get_view_class(self, cls, mixin):
+        viewcls = self._view_classes.get(cls)
+        if viewcls is None:
+            # Keep the name of the original class, so that repr() etc
+            # are unaffected:
+            viewcls = type(cls.__name__, (mixin, cls),
+                           {'__slots__': ('_graph', '_index')})
+            self._view_classes[cls] = viewcls
+        return viewcls
+
+    def _make_node_view(self, idx):
+        cls = self._get_view_class(self._kinds[self._node_kind[idx]],
+                                   self.node_view_mixin)
+        node = cls.__new__(cls)
+        node._graph = self
+        node._index = idx
+        for field, column in zip(self.node_fields, self._node_columns):
+            setattr(node, field, column[idx])
+        return node
+
+    def _make_edge_view(self, idx):
+        cls = self._get_view_class(self._kinds[self._edge_kind[idx]],
+                                   self.edge_view_mixin)
+        edge = cls.__new__(cls)
+        edge._graph = self
+        edge._index = idx
+        edge.srcnode = self._make_node_view(self._edge_src[idx])
+        edge.dstnode = self._make_node_view(self._edge_dst[idx])
+        for field, column in zip(self.edge_fields, self._edge_columns):
+            setattr(edge, field, column[idx])
+        return edge
+
+    def _get_csr(self):
+        if self._csr is None:
+            numnodes = len(self._node_kind)
+            succ_offsets, succ_edge_ids = \
+                _counting_sort(numnodes, self._edge_src)
+            pred_offsets, pred_edge_ids = \
+                _counting_sort(numnodes, self._edge_dst)
+            self._csr = (succ_offsets, succ_edge_ids,
+                         pred_offsets, pred_edge_ids)
+        return self._csr
+
+    def _get_succs(self, idx):
+        succ_offsets, succ_edge_ids, pred_offsets, pred_edge_ids = \
+            self._get_csr()
+        return [self._make_edge_view(succ_edge_ids[pos])
+                for pos in range(succ_offsets[idx], succ_offsets[idx + 1])]
+
+    def _get_preds(self, idx):
+        succ_offsets, succ_edge_ids, pred_offsets, pred_edge_ids = \
+            self._get_csr()
+        return [self._make_edge_view(pred_edge_ids[pos])
+                for pos in range(pred_offsets[idx], pred_offsets[idx + 1])]
+
+def _counting_sort(numnodes, keys):
+    """
+    Given an array of node indices per edge, return an (offsets, edge_ids)
+    pair of arrays, in which the ids of the edges for node i are:
+        edge_ids[offsets[i]:offsets[i + 1]]
+    """
+    counts = array('l', [0]) * (numnodes + 1)
+    for key in keys:
+        counts[key + 1] += 1
+    for i in range(numnodes):
+        counts[i + 1] += counts[i]
+    offsets = array('l', counts)
+    edge_ids = array('l', [0]) * len(keys)
+    for edge_id, key in enumerate(keys):
+        pos = counts[key]
+        edge_ids[pos] = edge_id
+        counts[key] = pos + 1
+    return offsets, edge_ids
+
+class NodeSet(object):
+    """
+    Set-like view of the nodes within a CompactGraph
+    """
+    __slots__ = ('graph', )
+
+    def __init__(self, graph):
+        self.graph = graph
+
+    def __len__(self):
+        return len(self.graph._node_kind)
+
+    def __iter__(self):
+        graph = self.graph
+        for idx in range(len(graph._node_kind)):
+            yield graph._make_node_view(idx)
+
+    def __contains__(self, node):
+        return (isinstance(node, NodeView)
+                and node._graph is self.graph)
+
+class EdgeSet(object):
+    """
+    Set-like view of the edges within a CompactGraph
+    """
+    __slots__ = ('graph', )
+
+    def __init__(self, graph):
+        self.graph = graph
+
+    def __len__(self):
+        return len(self.graph._edge_kind)
+
+    def __iter__(self):
+        graph = self.graph
+        for idx in range(len(graph._edge_kind)):
+            yield graph._make_edge_view(idx)
+
+    def __contains__(self, edge):
+        return (isinstance(edge, EdgeView)
+                and edge._graph is self.graph)
+
+class NodeList(object):
+    """
+    Sequence of views of the nodes within a CompactGraph, indexed by
+    node index
+    """
+    __slots__ = ('graph', )
+
+    def __init__(self, graph):
+        self.graph = graph
+
+    def __len__(self):
+        return len(self.graph._node_kind)
+
+    def __getitem__(self, idx):
+        return self.graph._make_node_view(idx)
+
+class EdgeList(object):
+    """
+    Sequence of views of some of the edges within a CompactGraph, given
+    an array of edge indices
+    """
+    __slots__ = ('graph', 'edge_ids')
+
+    def __init__(self, graph, edge_ids):
+        self.graph = graph
+        self.edge_ids = edge_ids
+
+    def __len__(self):
+        return len(self.edge_ids)
+
+    def __getitem__(self, pos):
+        return self.graph._make_edge_view(self.edge_ids[pos])
+
+class ViewIndex(object):
+    """
+    Mapping from node view to node index, for use as GraphIndex.index_of
+    """
+    __slots__ = ('graph', )
+
+    def __init__(self, graph):
+        self.graph = graph
+
+    def __getitem__(self, node):
+        if node not in self.graph.nodes:
+            raise KeyError(node)
+        return node._index
@@ -0,0 +1,644 @@
+#   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2012 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+############################################################################
+# Iterative dataflow analysis over graphs of statements
+#
+# A DataflowProblem describes the facts of interest (numbered densely by a
+# Numbering, so that a set of facts is a Python int used as a bit-vector),
+# and how each node changes them.  solve() finds the fixed point with a
+# worklist over a GraphIndex, so that it works on any Graph, including
+# StmtGraph, Supergraph and CompactSupergraph.
+#
+# Within a Supergraph the solution is context-insensitive: the facts
+# flowing out of a function's exit reach the return sites of all of its
+# callers.
+############################################################################
+
+from collections import deque
+
+import gcc
+
+from gccutils.graph.stmtgraph import SplitPhiNode
+
+FORWARD = 'forward'
+BACKWARD = 'backward'
+
+class Numbering(object):
+    """
+    A dense numbering of hashable objects (variables, definitions, etc),
+    so that a set of them can be stored as a Python int, with bit i set if
+    the i-th object is in the set
+    """
+    __slots__ = ('items', 'index_of')
+
+    def __init__(self, items=()):
+        self.items = []
+        self.index_of = {}
+        for item in items:
+            self.get_index(item)
+
+    def __len__(self):
+        return len(self.items)
+
+    def __contains__(self, item):
+        return item in self.index_of
+
+    def get_index(self, item):
+        """
+        Get the index of the given item, numbering it if it's new
+        """
+        idx = self.index_of.get(item)
+        if idx is None:
+            idx = len(self.items)
+            self.index_of[item] = idx
+            self.items.append(item)
+        return idx
+
+    def get_bit(self, item):
+        return 1 << self.get_index(item)
+
+    def get_bits(self, items):
+        bits = 0
+        for item in items:
+            bits |= 1 << self.get_index(item)
+        return bits
+
+    def get_all_bits(self):
+        return (1 << len(self.items)) - 1
+
+    def get_items(self, bits):
+        """
+        Get the list of items within the given set of bits, in the order
+        in which they were numbered
+        """
+        return [self.items[idx] for idx in iter_bits(bits)]
+
+def iter_bits(bits):
+    """
+    Generate the indices of the set bits of the given int, lowest first
+    """
+    while bits:
+        lowest = bits & -bits
+        yield lowest.bit_length() - 1
+        bits ^= lowest
+
+class DataflowProblem(object):
+    """
+    Base class for dataflow problems.
+
+    Subclasses set the direction (FORWARD or BACKWARD) and whether facts
+    are merged by union ("may" problems, such as liveness) or intersection
+    ("must" problems, such as available expressions), and override get_gen
+    and get_kill to give the bits that each node generates and kills.
+
+    Problems that can't be expressed as gen/kill sets (e.g. where a copy
+    propagates facts from one variable to another) can set "separable" to
+    False, and override transfer() instead.
+    """
+    direction = FORWARD
+
+    # True for a union at the meet, False for an intersection:
+    may = True
+
+    # If False, transfer() is called for each node, rather than using the
+    # precomputed gen and kill bits:
+    separable = True
+
+    # If True, transfer_edge() is called on the facts flowing along each
+    # edge, e.g. to refine them based on the outcome of a condition:
+    refines_edges = False
+
+    def get_boundary_value(self):
+        """
+        Get the facts holding at the entry nodes of a FORWARD problem, or
+        at the exit nodes of a BACKWARD one
+        """
+        return 0
+
+    def get_universe(self):
+        """
+        Get all of the bits: the initial (top) value for a "must" problem
+        """
+        raise NotImplementedError
+
+    def get_gen(self, node):
+        return 0
+
+    def get_kill(self, node):
+        return 0
+
+    def transfer(self, node, bits):
+        """
+        Get the facts leaving a node in the direction of the analysis, given
+        the facts entering it.  Only called if "separable" is False
+        """
+        return (bits & ~self.get_kill(node)) | self.get_gen(node)
+
+    def transfer_edge(self, edge, bits):
+        """
+        Get the facts that flow along the given edge, given those leaving
+        the node that it flows from.  Only called if "refines_edges" is True
+        """
+        return bits
+
+class DataflowResult(object):
+    """
+    The fixed point found by solve(), as bits before and after each node,
+    in program order (so that for a BACKWARD problem, "after" is the value
+    before the transfer function was applied)
+    """
+    __slots__ = ('problem', 'index', 'before_bits', 'after_bits',
+                 'iterations')
+
+    def __init__(self, problem, index, before_bits, after_bits, iterations):
+        self.problem = problem
+        self.index = index
+        self.before_bits = before_bits
+        self.after_bits = after_bits
+        # The number of times a transfer function was applied:
+        self.iterations = iterations
+
+    def get_before(self, node):
+        return self.before_bits[self.index.index_of[node]]
+
+    def get_after(self, node):
+        return self.after_bits[self.index.index_of[node]]
+
+def _get_flow_order(n, roots, offsets, targets):
+    """
+    Get a list of all n node indices, in reverse postorder of a depth-first
+    traversal from the roots (so that a node is normally visited after the
+    nodes that flow into it), followed by any unreached nodes
+    """
+    visited = bytearray(n)
+    order = []
+    for root in list(roots) + list(range(n)):
+        if visited[root]:
+            continue
+        visited[root] = 1
+        postorder = []
+        stack = [[root, offsets[root]]]
+        while stack:
+            top = stack[-1]
+            i, pos = top
+            end = offsets[i + 1]
+            while pos < end and visited[targets[pos]]:
+                pos += 1
+            if pos < end:
+                top[1] = pos + 1
+                j = targets[pos]
+                visited[j] = 1
+                stack.append([j, offsets[j]])
+            else:
+                stack.pop()
+                postorder.append(i)
+        postorder.reverse()
+        order += postorder
+    return order
+
+def solve(problem, graph, boundary_nodes=None):
+    """
+    Solve the DataflowProblem over the given graph, returning a
+    DataflowResult.
+
+    The boundary value flows into the given boundary_nodes; by default
+    these are the nodes with no predecessors (for a FORWARD problem) or no
+    successors (for a BACKWARD problem).
+    """
+    check_direction(problem.direction)
+    idx = graph.get_index()
+    nodes = idx.nodes
+    n = len(nodes)
+    forward = (problem.direction == FORWARD)
+
+    # "in" and "out" here are with respect to the direction of flow:
+    if forward:
+        in_offsets, in_targets = idx.pred_offsets, idx.pred_targets
+        out_offsets, out_targets = idx.succ_offsets, idx.succ_targets
+    else:
+        in_offsets, in_targets = idx.succ_offsets, idx.succ_targets
+        out_offsets, out_targets = idx.pred_offsets, idx.pred_targets
+
+    if boundary_nodes is None:
+        boundary = [i for i in range(n)
+                    if in_offsets[i] == in_offsets[i + 1]]
+    else:
+        boundary = [idx.index_of[node] for node in boundary_nodes]
+    is_boundary = bytearray(n)
+    for i in boundary:
+        is_boundary[i] = 1
+    boundary_value = problem.get_boundary_value()
+
+    # For each node, the list of (source index, edge) pairs flowing into
+    # it, if the edges refine the facts:
+    inputs = None
+    if problem.refines_edges:
+        inputs = [[] for i in range(n)]
+        succ_offsets, succ_targets = idx.succ_offsets, idx.succ_targets
+        succ_edges = idx.succ_edges
+        for i in range(n):
+            for pos in range(succ_offsets[i], succ_offsets[i + 1]):
+                j = succ_targets[pos]
+                if forward:
+                    inputs[j].append((i, succ_edges[pos]))
+                else:
+                    inputs[i].append((j, succ_edges[pos]))
+
+    if problem.separable:
+        gen = [problem.get_gen(node) for node in nodes]
+        kill = [~problem.get_kill(node) for node in nodes]
+    transfer = problem.transfer
+    transfer_edge = problem.transfer_edge
+
+    if problem.may:
+        top = 0
+    else:
+        top = problem.get_universe()
+    inbits = [top] * n
+    outbits = [top] * n
+
+    order = _get_flow_order(n, boundary, out_offsets, out_targets)
+    worklist = deque(order)
+    inqueue = bytearray(b'\x01' * n)
+    may = problem.may
+    iterations = 0
+    while worklist:
+        i = worklist.popleft()
+        inqueue[i] = 0
+
+        # Meet the facts flowing into the node:
+        if is_boundary[i]:
+            bits = boundary_value
+            first = False
+        else:
+            bits = top
+            first = True
+        if inputs is not None:
+            for j, edge in inputs[i]:
+                value = transfer_edge(edge, outbits[j])
+                if may:
+                    bits |= value
+                elif first:
+                    bits = value
+                    first = False
+                else:
+                    bits &= value
+        else:
+            for pos in range(in_offsets[i], in_offsets[i + 1]):
+                value = outbits[in_targets[pos]]
+                if may:
+                    bits |= value
+                elif first:
+                    bits = value
+                    first = False
+                else:
+                    bits &= value
+        inbits[i] = bits
+
+        if problem.separable:
+            bits = (bits & kill[i]) | gen[i]
+        else:
+            bits = transfer(nodes[i], bits)
+        iterations += 1
+        # Every node starts on the worklist, so the nodes that this one flows
+        # into only need revisiting if its value changed:
+        if bits == outbits[i]:
+            continue
+        outbits[i] = bits
+        for pos in range(out_offsets[i], out_offsets[i + 1]):
+            j = out_targets[pos]
+            if not inqueue[j]:
+                inqueue[j] = 1
+                worklist.append(j)
+
+    if forward:
+        return DataflowResult(problem, idx, inbits, outbits, iterations)
+    else:
+        return DataflowResult(problem, idx, outbits, inbits, iterations)
+
+def check_direction(direction):
+    if direction not in (FORWARD, BACKWARD):
+        raise ValueError('unknown direction: %r' % (direction, ))
+
+############################################################################
+# Locating the variables defined and used by a node
+############################################################################
+VARIABLE_TYPES = (gcc.VarDecl, gcc.ParmDecl, gcc.ResultDecl, gcc.SsaName)
+
+def is_variable(t):
+    return isinstance(t, VARIABLE_TYPES)
+
+def _get_stmtnode(node):
+    # Unwrap a SupergraphNode:
+    return getattr(node, 'stmtnode', node)
+
+def _is_call_node(node):
+    from gccutils.graph.supergraph import CallNode
+    return isinstance(node, CallNode)
+
+def _is_return_node(node):
+    from gccutils.graph.supergraph import ReturnNode
+    return isinstance(node, ReturnNode)
+
+def get_defined_variable(node):
+    """
+    Get the variable that the given node assigns to, or None.
+
+    Within a Supergraph, a call's result is defined at its ReturnNode,
+    rather than its CallNode.
+    """
+    stmt = node.stmt
+    if stmt is None or _is_call_node(node):
+        return None
+    if isinstance(stmt, (gcc.GimpleAssign, gcc.GimpleCall, gcc.GimplePhi)):
+        if is_variable(stmt.lhs):
+            return stmt.lhs
+    return None
+
+def get_used_variables(node):
+    """
+    Get the list of variables read by the given node (with repeats).
+
+    Within a Supergraph, a call's arguments are used at its CallNode,
+    rather than its ReturnNode.
+    """
+    stmt = node.stmt
+    if stmt is None or _is_return_node(node):
+        return []
+    stmtnode = _get_stmtnode(node)
+    if isinstance(stmtnode, SplitPhiNode):
+        if is_variable(stmtnode.rhs):
+            return [stmtnode.rhs]
+        return []
+    if isinstance(stmt, gcc.GimplePhi):
+        return [arg for arg, edge in stmt.args
+                if is_variable(arg)]
+    result = []
+    def visit(t, result):
+        if is_variable(t):
+            result.append(t)
+    stmt.walk_tree(visit, result)
+    # walk_tree visits the LHS too; that's a definition, not a use, unless
+    # it's something more complicated (e.g. "*p = " reads p):
+    lhs = getattr(stmt, 'lhs', None)
+    if is_variable(lhs):
+        result.remove(lhs)
+    return result
+
+############################################################################
+# Ready-made problems
+############################################################################
+class ReachingDefinitions(DataflowProblem):
+    """
+    Which definitions (nodes assigning to a variable) may reach each node
+    without being overwritten
+    """
+    direction = FORWARD
+    may = True
+
+    def __init__(self, graph):
+        # The bits are the defining nodes:
+        self.defs = Numbering()
+        self.var_of_def = {}
+        self.defs_of_var = {}
+        for node in graph.nodes:
+            var = get_defined_variable(node)
+            if var is not None:
+                bit = self.defs.get_bit(node)
+                self.var_of_def[node] = var
+                self.defs_of_var[var] = self.defs_of_var.get(var, 0) | bit
+
+    def get_gen(self, node):
+        if node in self.var_of_def:
+            return self.defs.get_bit(node)
+        return 0
+
+    def get_kill(self, node):
+        var = self.var_of_def.get(node)
+        if var is not None:
+            return self.defs_of_var[var] & ~self.defs.get_bit(node)
+        return 0
+
+    def get_definitions(self, result, node, var=None):
+        """
+        Get the list of definitions reaching the given node (optionally, of
+        just the given variable)
+        """
+        bits = result.get_before(node)
+        if var is not None:
+            bits &= self.defs_of_var.get(var, 0)
+        return self.defs.get_items(bits)
+
+class Liveness(DataflowProblem):
+    """
+    Which variables may be read later, before being overwritten
+    """
+    direction = BACKWARD
+    may = True
+
+    def __init__(self, graph):
+        self.vars = Numbering()
+        self.uses = {}
+        self.defs = {}
+        for node in graph.nodes:
+            uses = self.vars.get_bits(get_used_variables(node))
+            if uses:
+                self.uses[node] = uses
+            var = get_defined_variable(node)
+            if var is not None:
+                self.defs[node] = self.vars.get_bit(var)
+
+    def get_gen(self, node):
+        return self.uses.get(node, 0)
+
+    def get_kill(self, node):
+        return self.defs.get(node, 0)
+
+    def get_live_before(self, result, node):
+        return self.vars.get_items(result.get_before(node))
+
+    def get_live_after(self, result, node):
+        return self.vars.get_items(result.get_after(node))
+
+def is_null_constant(t):
+    return isinstance(t, gcc.IntegerCst) and t.constant == 0
+
+def is_parameter_value(t):
+    """
+    Is the given tree the value of a parameter on entry to its function:
+    either the gcc.ParmDecl itself, or (in SSA form) its default definition,
+    such as "p_1(D)", which no statement assigns to?
+    """
+    if isinstance(t, gcc.ParmDecl):
+        return True
+    return (isinstance(t, gcc.SsaName)
+            and isinstance(t.var, gcc.ParmDecl)
+            and isinstance(t.def_stmt, gcc.GimpleNop))
+
+class MaybeNull(DataflowProblem):
+    """
+    Which pointer variables may be NULL.
+
+    A variable is only tracked if nothing can change it behind our back: a
+    parameter (or, in SSA form, its default definition), or a local that
+    doesn't have its address taken and isn't static.  Other pointers are
+    always considered to be possibly NULL, as is the result of anything we
+    can't see through, such as a call (see call_may_return_null) or a read
+    from memory.  A comparison against NULL refines the facts along each
+    outgoing edge.
+    """
+    direction = FORWARD
+    may = True
+    separable = False
+    refines_edges = True
+
+    def __init__(self, graph):
+        self.vars = Numbering()
+        self.untracked = set()
+        if hasattr(graph, 'get_functions'):
+            funs = list(graph.get_functions())
+        else:
+            funs = [graph.fun]
+        for fun in funs:
+            for var in fun.decl.arguments or []:
+                if isinstance(var.type, gcc.PointerType):
+                    self.vars.get_index(var)
+            for var in fun.local_decls or []:
+                if var.static:
+                    self.untracked.add(var)
+        # Find the variables that have their address taken, and the
+        # default definitions of the parameters (which no node defines):
+        def visit(t, problem):
+            if isinstance(t, gcc.AddrExpr) and is_variable(t.operand):
+                problem.untracked.add(t.operand)
+            elif is_parameter_value(t) and problem.is_tracked(t):
+                problem.vars.get_index(t)
+        for node in graph.nodes:
+            stmt = node.stmt
+            if stmt is None:
+                continue
+            if isinstance(stmt, gcc.GimplePhi):
+                for arg, edge in stmt.args:
+                    visit(arg, self)
+            else:
+                stmt.walk_tree(visit, self)
+        for node in graph.nodes:
+            var = get_defined_variable(node)
+            if self.is_tracked(var):
+                self.vars.get_index(var)
+
+    def is_tracked(self, var):
+        if isinstance(var, gcc.SsaName):
+            return isinstance(var.type, gcc.PointerType)
+        if isinstance(var, (gcc.VarDecl, gcc.ParmDecl)):
+            return (isinstance(var.type, gcc.PointerType)
+                    and var not in self.untracked)
+        return False
+
+    def get_boundary_value(self):
+        # Any of the parameters could be NULL:
+        return self.vars.get_bits([var for var in self.vars.items
+                                   if is_parameter_value(var)])
+
+    def call_may_return_null(self, stmt):
+        """
+        Can the given gcc.GimpleCall return NULL?  Override this to make use
+        of knowledge of particular functions
+        """
+        return True
+
+    def _rhs_may_be_null(self, t, bits):
+        if is_null_constant(t):
+            return True
+        if t in self.vars:
+            return bool(bits & self.vars.get_bit(t))
+        # An untracked variable could be anything:
+        return is_variable(t)
+
+    def value_may_be_null(self, node, bits):
+        """
+        Could the value assigned by the given node be NULL, given the facts
+        holding before it?
+        """
+        stmt = node.stmt
+        stmtnode = _get_stmtnode(node)
+        if isinstance(stmtnode, SplitPhiNode):
+            return self._rhs_may_be_null(stmtnode.rhs, bits)
+        if isinstance(stmt, gcc.GimplePhi):
+            for arg, edge in stmt.args:
+                if self._rhs_may_be_null(arg, bits):
+                    return True
+            return False
+        if isinstance(stmt, gcc.GimpleCall):
+            return self.call_may_return_null(stmt)
+        if isinstance(stmt, gcc.GimpleAssign):
+            if stmt.exprcode in (gcc.AddrExpr, gcc.StringCst):
+                return False
+            if stmt.exprcode in (gcc.IntegerCst, gcc.SsaName, gcc.VarDecl,
+                                 gcc.ParmDecl, gcc.NopExpr, gcc.ConvertExpr,
+                                 gcc.PointerPlusExpr):
+                return self._rhs_may_be_null(stmt.rhs[0], bits)
+        # Anything else (e.g. a read through a pointer) could be NULL:
+        return True
+
+    def transfer(self, node, bits):
+        var = get_defined_variable(node)
+        if var is None or var not in self.vars:
+            return bits
+        bit = self.vars.get_bit(var)
+        if self.value_may_be_null(node, bits):
+            return bits | bit
+        return bits & ~bit
+
+    def transfer_edge(self, edge, bits):
+        # Refine by the outcome of "if (p == 0)" or "if (p != 0)":
+        stmt = edge.srcnode.stmt
+        if not isinstance(stmt, gcc.GimpleCond):
+            return bits
+        if stmt.exprcode not in (gcc.EqExpr, gcc.NeExpr):
+            return bits
+        if stmt.lhs in self.vars and is_null_constant(stmt.rhs):
+            var = stmt.lhs
+        elif stmt.rhs in self.vars and is_null_constant(stmt.lhs):
+            var = stmt.rhs
+        else:
+            return bits
+        if edge.true_value:
+            is_null = (stmt.exprcode == gcc.EqExpr)
+        elif edge.false_value:
+            is_null = (stmt.exprcode == gcc.NeExpr)
+        else:
+            return bits
+        if not is_null:
+            return bits & ~self.vars.get_bit(var)
+        return bits
+
+    def get_maybe_null(self, result, node):
+        """
+        Get the list of tracked pointers that may be NULL before the given
+        node
+        """
+        return self.vars.get_items(result.get_before(node))
+
+    def is_nonnull(self, result, node, var):
+        """
+        Is the given pointer known to be non-NULL before the given node?
+        """
+        if var not in self.vars:
+            return False
+        return not (result.get_before(node) & self.vars.get_bit(var))
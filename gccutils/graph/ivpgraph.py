@@ -30,11 +30,15 @@ from gccutils.graph.supergraph import Supergraph, CallToStart, \
 class Callstring:
     """
     A callstring-suffix
+
+    These are interned by the IvpGraph (see IvpGraph.get_callstring), so
+    that there is a single instance per distinct suffix within a graph.
     """
-    __slots__ = ('callnodes', )
+    __slots__ = ('callnodes', '_hash', )
 
     def __init__(self, callnodes):
         self.callnodes = callnodes
+        self._hash = hash(callnodes)
 
     def __str__(self):
         def callnode_to_str(callnode):
@@ -47,19 +51,31 @@ class Callstring:
         return 'Callstring(%r)' % str(self)
 
     def __eq__(self, other):
-        return self.callnodes == other.callnodes
+        return self is other or self.callnodes == other.callnodes
 
     def __hash__(self):
-        return hash(self.callnodes)
+        return self._hash
 
     def to_dot_id(self):
         return '_'.join([str(id(callnode))
                          for callnode in self.callnodes])
 
 class IvpGraph(Graph):
-    __slots__ = ('sg', 'maxlength', 'ivpnodes', '_entrynodes')
+    __slots__ = ('sg', 'maxlength', 'ivpnodes', '_entrynodes',
+                 '_callstrings', '_pushes', '_callstrings_by_suffix')
+
+    def __init__(self, sg, maxlength, functions=None):
+        """
+        sg : the Supergraph
+
+        maxlength : the maximum length of the callstrings (the "k" in
+        k-limited callstrings)
 
-    def __init__(self, sg, maxlength):
+        functions : if not None, an iterable of gcc.Function, giving the
+        entrypoints: only the part of the interprocedural graph that is
+        reachable from these functions is built, rather than that reachable
+        from sg.get_entry_nodes()
+        """
         Graph.__init__(self)
         self.sg = sg
         self.maxlength = maxlength
@@ -69,6 +85,18 @@ class IvpGraph(Graph):
 
         self._entrynodes = set()
 
+        # Interning of Callstring instances:
+        # dict from tuple of callnodes to Callstring:
+        self._callstrings = {}
+        # dict from (Callstring, callnode) to the Callstring for the push
+        # of the callnode onto it:
+        self._pushes = {}
+        # dict from the tuple callnodes[1:] of each maximal-length
+        # Callstring to the set of such Callstrings, so that we can find
+        # the candidates for popping a truncated stack without scanning
+        # every callstring:
+        self._callstrings_by_suffix = {}
+
         # 1st pass: walk from the entrypoints, calling functions,
         # building nodes, and calling edges.
         # We will fill in the return edges later:
@@ -82,112 +110,121 @@ class IvpGraph(Graph):
             self.ivpnodes[key] = newnode
             return newnode
 
-        # The "worklist" is a set of IvpNodes that we need to add
+        if functions is None:
+            entrynodes = sg.get_entry_nodes()
+        else:
+            entrynodes = []
+            for fun in functions:
+                entrynodes.append(sg.get_function_entry(fun))
+
+        # The "worklist" is a list of IvpNodes that we need to add
         # edges for.  Doing so may lead to more IvpNodes being
         # created.
-        worklist = set()
-        for supernode in sg.get_entry_nodes():
-            key = (Callstring(tuple()), supernode)
+        worklist = []
+        emptycallstring = self.get_callstring(tuple())
+        for supernode in entrynodes:
+            key = (emptycallstring, supernode)
+            if key in self.ivpnodes:
+                continue
             node = _add_node_for_key(key)
-            worklist.add(node)
+            worklist.append(node)
             self._entrynodes.add(node)
 
         while worklist:
             ivpnode = worklist.pop()
-            if 0:
-                print('ivpnode: %s' % ivpnode)
-                print('ivpnode: %r' % ivpnode)
+            callstring = ivpnode.callstring
 
             for inneredge in ivpnode.innernode.succs:
-                if 0:
-                    print('  inneredge: %s' % inneredge)
-                    print('  inneredge: %r' % inneredge)
-                callstring = ivpnode.callstring
-
-                def get_callstring():
-                    if isinstance(inneredge, CallToStart):
-                        # interprocedural call: push onto stack:
-                        callnode = inneredge.srcnode
-                        assert len(callstring.callnodes) <= maxlength
-                        if len(callstring.callnodes) == maxlength:
-                            # Truncate, losing the bottom of the stack:
-                            oldstack = list(callstring.callnodes[1:])
-                        else:
-                            oldstack = list(callstring.callnodes)
-                        return Callstring(tuple(oldstack + [callnode]))
-
-                    elif isinstance(inneredge, ExitToReturnSite):
-                        # interprocedural return: pop from stack
-                        if not callstring.callnodes:
-                            return None
+                if isinstance(inneredge, CallToStart):
+                    # interprocedural call: push onto stack:
+                    newcallstring = self._push(callstring, inneredge.srcnode)
 
+                elif isinstance(inneredge, ExitToReturnSite):
+                    # interprocedural return: pop from stack
+                    if callstring.callnodes:
                         # Ensure that we're returning to the correct place
                         # according to the top of the stack:
                         callnode = callstring.callnodes[-1]
                         if inneredge.dstnode == callnode.returnnode:
                             # add to the pending list
                             _pending_return_edges.add( (ivpnode, inneredge) )
+                    continue
+                else:
+                    # same stack depth:
+                    newcallstring = callstring
 
-                        return None
-                    else:
-                        # same stack depth:
-                        return ivpnode.callstring
-
-                newcallstring = get_callstring()
-                if newcallstring:
-                    key = (newcallstring, inneredge.dstnode)
-                    if key not in self.ivpnodes:
-                        dstnode = _add_node_for_key(key)
-                        worklist.add( dstnode )
-                    else:
-                        dstnode = self.ivpnodes[key]
-                    self.add_edge(ivpnode, dstnode, inneredge)
-
-            # FIXME: in case we don't terminate, this is useful for debugging why:
-            #if len(self.nodes) > 100:
-            #    return
-
-        # 2nd pass: now gather all valid callstrings:
-        self.all_callstrings = set()
-        for node in self.nodes:
-            self.all_callstrings.add(node.callstring)
-
-        if 0:
-            print('self.all_callstrings: %s' % self.all_callstrings)
-
-        # 3rd pass: go back and add the return edges (using the set of valid
+                key = (newcallstring, inneredge.dstnode)
+                dstnode = self.ivpnodes.get(key)
+                if dstnode is None:
+                    dstnode = _add_node_for_key(key)
+                    worklist.append(dstnode)
+                self.add_edge(ivpnode, dstnode, inneredge)
+
+        # 2nd pass: go back and add the return edges (using the set of valid
         # callstrings to expand possible-truncated stacks):
         for srcivpnode, inneredge in _pending_return_edges:
-            callstring = srcivpnode.callstring
-
-            # We have a return edge, valid in the sense
-            # that the dstnode is the call at the top of the stack
-            #
-            # What state should the stack end up in?
-            def iter_valid_pops(callstring):
-                # We could be at the top of an untruncated stack, in which
-                # case we simply lose the top element:
-                candidate = Callstring(callstring.callnodes[:-1])
-                if candidate in self.all_callstrings:
-                    yield candidate
-
-                # Alternatively, the stack could be truncated, in which
-                # case we need to generate all possible new elements for the
-                # prefix part of the truncated stack
-                if len(callstring.callnodes) == maxlength:
-                    suffix = callstring.callnodes[0:-1]
-                    for candidate in self.all_callstrings:
-                        if candidate.callnodes[1:] == suffix:
-                            yield candidate
-
-            valid_pops = set(iter_valid_pops(callstring))
-            for newcallstring in valid_pops:
+            for newcallstring in self._iter_valid_pops(srcivpnode.callstring):
                 key = (newcallstring, inneredge.dstnode)
-                dstivpnode = self.ivpnodes[key]
-                self.add_edge(srcivpnode, dstivpnode, inneredge)
+                dstivpnode = self.ivpnodes.get(key)
+                if dstivpnode is not None:
+                    self.add_edge(srcivpnode, dstivpnode, inneredge)
 
         # (done)
 
+    def get_callstring(self, callnodes):
+        """
+        Get the interned Callstring for the given tuple of callnodes
+        """
+        callstring = self._callstrings.get(callnodes)
+        if callstring is None:
+            callstring = Callstring(callnodes)
+            self._callstrings[callnodes] = callstring
+            if len(callnodes) == self.maxlength:
+                suffix = callnodes[1:]
+                if suffix in self._callstrings_by_suffix:
+                    self._callstrings_by_suffix[suffix].add(callstring)
+                else:
+                    self._callstrings_by_suffix[suffix] = set([callstring])
+        return callstring
+
+    @property
+    def all_callstrings(self):
+        return set(self._callstrings.values())
+
+    def _push(self, callstring, callnode):
+        key = (callstring, callnode)
+        result = self._pushes.get(key)
+        if result is None:
+            callnodes = callstring.callnodes
+            assert len(callnodes) <= self.maxlength
+            if len(callnodes) == self.maxlength:
+                # Truncate, losing the bottom of the stack:
+                callnodes = callnodes[1:]
+            result = self.get_callstring(callnodes + (callnode, ))
+            self._pushes[key] = result
+        return result
+
+    def _iter_valid_pops(self, callstring):
+        """
+        We have a return edge, valid in the sense that the dstnode is the
+        call at the top of the stack.
+
+        What state should the stack end up in?
+        """
+        # We could be at the top of an untruncated stack, in which
+        # case we simply lose the top element:
+        candidate = self._callstrings.get(callstring.callnodes[:-1])
+        if candidate is not None:
+            yield candidate
+
+        # Alternatively, the stack could be truncated, in which
+        # case we need to generate all possible new elements for the
+        # prefix part of the truncated stack
+        if len(callstring.callnodes) == self.maxlength:
+            suffix = callstring.callnodes[0:-1]
+            for candidate in self._callstrings_by_suffix.get(suffix, ()):
+                yield candidate
+
     def _make_edge(self, srcnode, dstnode, edge):
         return IvpEdge(srcnode, dstnode, edge)
 
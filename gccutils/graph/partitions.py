@@ -0,0 +1,515 @@
+#   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2012 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+import json
+import os
+
+from gccutils.graph import Node, Edge, Subgraph
+from gccutils.graph.compact import CompactGraph
+
+############################################################################
+# Supergraphs of partitioned programs
+#
+# Supergraph needs every function body to be within one process, which for
+# link-time optimization means passing -flto-partition=none, serializing
+# the whole of lto1.  Instead, each LTRANS partition can write out a
+# PartitionSummary of the functions that it has the bodies of: the shape of
+# each function's StmtGraph, reduced to numbered nodes and edges, plus the
+# call sites within it, and the functions they call.
+#
+# A MergedSupergraph can then be built from the summaries of all of the
+# partitions, reconnecting the call sites with the functions they call,
+# wherever those are.  It has the Graph API (and is a CompactGraph), but its
+# nodes refer to functions by key (see get_function_key) and line number,
+# rather than wrapping GCC's objects, since those don't exist outside of the
+# partition they came from.
+#
+# Within LTRANS, the bodies of the functions are only read in as each one is
+# compiled, after the IPA passes, so a PartitionSummarizer builds the
+# summary one function at a time, as each reaches GCC's per-function
+# passes, writing it out at the end of the process.
+############################################################################
+
+FORMAT_VERSION = 1
+
+SUFFIX = '.supergraph.json'
+
+def get_function_key(decl):
+    """
+    Get a str identifying the given gcc.FunctionDecl across partitions
+    """
+    # The assembler name of a public function is unique within the link.
+    # This includes the static functions that WPA makes public when moving
+    # them between partitions, since it renames them as it does so (e.g. to
+    # "helper.lto_priv.0"), whereas their "name" is unchanged.
+    name = decl.assembler_name
+    if decl.is_public:
+        return name
+    # Static functions in different source files can share an assembler
+    # name (even within the same link, if they're in different partitions):
+    if decl.location:
+        return '%s:%s' % (decl.location.file, name)
+    return ':%s' % name
+
+class FunctionSummary(object):
+    """
+    The shape of the StmtGraph of one function, with the nodes numbered
+    from 0.  Each call site with a known callee has two consecutive nodes:
+    for the call, and for the return to the caller.
+    """
+    __slots__ = ('key', 'name', 'file', 'is_public',
+                 'lines', 'entry', 'exit', 'edges', 'calls')
+
+    def __init__(self, key, name, file_, is_public,
+                 lines, entry, exit, edges, calls):
+        self.key = key
+        self.name = name
+        self.file = file_
+        self.is_public = is_public
+
+        # list of the line number for each node (or 0, if unknown):
+        self.lines = lines
+
+        # The indices of the entry and exit nodes:
+        self.entry = entry
+        self.exit = exit
+
+        # Flat list of the (src, dst) indices of the intraprocedural
+        # edges, other than those from a call to its return:
+        self.edges = edges
+
+        # list of (call index, return index, callee key) triples:
+        self.calls = calls
+
+    def __repr__(self):
+        return ('FunctionSummary(key=%r, %i nodes, %i edges, %i calls)'
+                % (self.key, len(self.lines), len(self.edges) // 2,
+                   len(self.calls)))
+
+    @classmethod
+    def from_stmtgraph(cls, stmtg):
+        """
+        Build a FunctionSummary from the StmtGraph of a function.  Each
+        direct call (a gcc.GimpleCall with a fndecl) becomes a call site.
+        """
+        import gcc
+        fun = stmtg.fun
+        lines = []
+        index_of = {}
+        calls = []
+        for stmtnode in stmtg.nodes:
+            loc = stmtnode.get_gcc_loc()
+            line = loc.line if loc else 0
+            index_of[stmtnode] = len(lines)
+            lines.append(line)
+            stmt = stmtnode.stmt
+            if isinstance(stmt, gcc.GimpleCall) and stmt.fndecl:
+                # Add the return node after the call node:
+                lines.append(line)
+                calls.append((len(lines) - 2, len(lines) - 1,
+                              get_function_key(stmt.fndecl)))
+        callidxs = set([callidx for callidx, returnidx, calleekey in calls])
+        edges = []
+        for edge in stmtg.edges:
+            src = index_of[edge.srcnode]
+            if src in callidxs:
+                # Begin the edge from the return node:
+                src += 1
+            edges.append(src)
+            edges.append(index_of[edge.dstnode])
+        return cls(get_function_key(fun.decl),
+                   fun.decl.name,
+                   fun.start.file if fun.start else None,
+                   fun.decl.is_public,
+                   lines,
+                   index_of[stmtg.entry],
+                   index_of[stmtg.exit],
+                   edges,
+                   calls)
+
+    def to_json(self):
+        return dict(key=self.key,
+                    name=self.name,
+                    file=self.file,
+                    public=self.is_public,
+                    lines=self.lines,
+                    entry=self.entry,
+                    exit=self.exit,
+                    edges=self.edges,
+                    calls=self.calls)
+
+    @classmethod
+    def from_json(cls, js):
+        return cls(js['key'], js['name'], js['file'], js['public'],
+                   js['lines'], js['entry'], js['exit'], js['edges'],
+                   [tuple(call) for call in js['calls']])
+
+class PartitionSummary(object):
+    """
+    The FunctionSummary instances for the functions within one partition
+    """
+    __slots__ = ('functions', )
+
+    def __init__(self, functions):
+        # list of FunctionSummary:
+        self.functions = functions
+
+    @classmethod
+    def from_callgraph(cls, split_phi_nodes=False):
+        """
+        Summarize the functions within the callgraph of the current
+        process that have bodies.
+
+        This needs the bodies to have been read in, so it isn't suitable
+        for LTRANS (see PartitionSummarizer)
+        """
+        from gcc import get_callgraph_nodes
+        from gccutils.graph.stmtgraph import StmtGraph
+        functions = []
+        seen = set()
+        for node in get_callgraph_nodes():
+            fun = node.decl.function
+            if not fun or not fun.cfg:
+                continue
+            # (inline clones share the function of the node they're a clone
+            # of)
+            key = get_function_key(fun.decl)
+            if key in seen:
+                continue
+            seen.add(key)
+            stmtg = StmtGraph(fun, split_phi_nodes)
+            functions.append(FunctionSummary.from_stmtgraph(stmtg))
+        return cls(functions)
+
+    def write(self, path):
+        js = dict(version=FORMAT_VERSION,
+                  functions=[f.to_json() for f in self.functions])
+        # Write to a temporary file and rename it into place, so that the
+        # merge never sees a partially-written summary:
+        tmppath = '%s.%i.tmp' % (path, os.getpid())
+        with open(tmppath, 'w') as f:
+            json.dump(js, f, separators=(',', ':'))
+        os.rename(tmppath, path)
+
+    @classmethod
+    def read(cls, path):
+        with open(path) as f:
+            js = json.load(f)
+        if js.get('version') != FORMAT_VERSION:
+            raise ValueError('%s: unknown format version: %r'
+                             % (path, js.get('version')))
+        return cls([FunctionSummary.from_json(f) for f in js['functions']])
+
+def get_partition_summary_path(dirname):
+    """
+    Get the path for the summary of the current process within the given
+    directory, named after its dump file (which is unique among the
+    partitions of one link)
+    """
+    import gcc
+    return os.path.join(dirname,
+                        os.path.basename(gcc.get_dump_base_name()) + SUFFIX)
+
+def write_partition_summary(dirname, split_phi_nodes=False):
+    """
+    Summarize the functions within the callgraph of the current process
+    that have bodies, writing the summary into the given directory (see
+    get_partition_summary_path).
+
+    Returns the path written to, or None if there were no function bodies.
+    """
+    summary = PartitionSummary.from_callgraph(split_phi_nodes)
+    if not summary.functions:
+        return None
+    path = get_partition_summary_path(dirname)
+    summary.write(path)
+    return path
+
+class PartitionSummarizer(object):
+    """
+    Build the PartitionSummary of the current process one function at a
+    time: each function is summarized the first time that one of GCC's
+    per-function gimple passes is about to run on it, and the summary is
+    written out when the process finishes.
+
+    This is what's needed within LTRANS, where the function bodies are
+    only read in as each function is compiled.  Call register() from the
+    plugin's script.
+
+    If lto_only is set, the functions compiled by cc1 are ignored, so that
+    the same script can be used for every stage of a build.  (This has to
+    be decided as each pass runs: gcc.is_lto() is always False whilst the
+    script itself is being run.)
+    """
+    def __init__(self, dirname, split_phi_nodes=False, lto_only=False):
+        self.dirname = dirname
+        self.split_phi_nodes = split_phi_nodes
+        self.lto_only = lto_only
+
+        # list of FunctionSummary, in the order they were compiled:
+        self.functions = []
+
+        # The keys of the functions summarized so far:
+        self.seen = set()
+
+        # The path written to by on_finish (if any):
+        self.path = None
+
+    def register(self):
+        import gcc
+        gcc.register_callback(gcc.PLUGIN_PASS_EXECUTION,
+                              self.on_pass_execution)
+        gcc.register_callback(gcc.PLUGIN_FINISH,
+                              self.on_finish)
+
+    def on_pass_execution(self, p, fun):
+        import gcc
+        from gccutils.graph.stmtgraph import StmtGraph
+        if not fun or not fun.cfg or not isinstance(p, gcc.GimplePass):
+            return
+        if self.lto_only and not gcc.is_lto():
+            return
+        key = get_function_key(fun.decl)
+        if key in self.seen:
+            return
+        self.seen.add(key)
+        stmtg = StmtGraph(fun, self.split_phi_nodes)
+        self.functions.append(FunctionSummary.from_stmtgraph(stmtg))
+
+    def on_finish(self):
+        if not self.functions:
+            return
+        self.path = get_partition_summary_path(self.dirname)
+        PartitionSummary(self.functions).write(self.path)
+
+def find_partition_summaries(dirname):
+    """
+    Get the paths of all of the summaries within the given directory
+    """
+    return [os.path.join(dirname, filename)
+            for filename in sorted(os.listdir(dirname))
+            if filename.endswith(SUFFIX)]
+
+class MergedSupergraph(CompactGraph):
+    """
+    A supergraph of the whole program, built from the PartitionSummary of
+    each partition
+    """
+    __slots__ = ('functions',
+                 '_first_node',
+                 'fake_entry_node')
+
+    node_fields = ('function', 'line')
+    edge_fields = ()
+
+    def __init__(self, summaries, add_fake_entry_node=True):
+        CompactGraph.__init__(self)
+
+        # dict from key to FunctionSummary:
+        self.functions = {}
+
+        # dict from key to the index of the function's first node:
+        self._first_node = {}
+
+        # 1st pass: add the nodes and intraprocedural edges of each
+        # function:
+        for summary in summaries:
+            for fs in summary.functions:
+                if fs.key in self.functions:
+                    # The body of an inline function can be within more
+                    # than one partition, but the keys of any other
+                    # functions should be unique within the link:
+                    if fs.to_json() != self.functions[fs.key].to_json():
+                        raise ValueError('conflicting summaries for %r'
+                                         % fs.key)
+                    continue
+                self._add_function(fs)
+
+        # 2nd pass: link each call site to the function it calls, if that
+        # is anywhere within the program:
+        for key, fs in self.functions.items():
+            base = self._first_node[key]
+            for callidx, returnidx, calleekey in fs.calls:
+                callee = self.functions.get(calleekey)
+                if callee is None:
+                    continue
+                calleebase = self._first_node[calleekey]
+                self.add_edge(self._make_node_view(base + callidx),
+                              self._make_node_view(calleebase + callee.entry),
+                              MergedCallToStart)
+                self.add_edge(self._make_node_view(calleebase + callee.exit),
+                              self._make_node_view(base + returnidx),
+                              MergedExitToReturnSite)
+
+        # 3rd pass: create fake entry node, linking to all of the
+        # non-static functions:
+        if not add_fake_entry_node:
+            self.fake_entry_node = None
+            return
+        self.fake_entry_node = self.add_node(MergedFakeEntryNode(None, 0))
+        for key, fs in sorted(self.functions.items()):
+            if fs.is_public:
+                self.add_edge(self.fake_entry_node,
+                              self.get_function_entry(key),
+                              MergedFakeEntryEdge)
+
+    @classmethod
+    def from_files(cls, paths, add_fake_entry_node=True):
+        return cls([PartitionSummary.read(path) for path in paths],
+                   add_fake_entry_node)
+
+    def _add_function(self, fs):
+        key = fs.key
+        base = len(self._node_kind)
+        self.functions[key] = fs
+        self._first_node[key] = base
+        kinds = {}
+        for callidx, returnidx, calleekey in fs.calls:
+            kinds[callidx] = MergedCallNode
+            kinds[returnidx] = MergedReturnNode
+        for i, line in enumerate(fs.lines):
+            self.add_node(kinds.get(i, MergedNode)(key, line))
+        edges = fs.edges
+        for i in range(0, len(edges), 2):
+            self.add_edge(self._make_node_view(base + edges[i]),
+                          self._make_node_view(base + edges[i + 1]),
+                          MergedEdge)
+        for callidx, returnidx, calleekey in fs.calls:
+            self.add_edge(self._make_node_view(base + callidx),
+                          self._make_node_view(base + returnidx),
+                          MergedCallToReturnSiteEdge)
+
+    def _make_edge(self, srcnode, dstnode, cls):
+        return cls(srcnode, dstnode)
+
+    def get_entry_nodes(self):
+        if self.fake_entry_node:
+            yield self.fake_entry_node
+
+    def get_functions(self):
+        """
+        Get the keys of all of the functions within the supergraph
+        """
+        return sorted(self.functions.keys())
+
+    def get_function_entry(self, key):
+        fs = self.functions[key]
+        return self._make_node_view(self._first_node[key] + fs.entry)
+
+    def get_function_exit(self, key):
+        fs = self.functions[key]
+        return self._make_node_view(self._first_node[key] + fs.exit)
+
+class MergedNode(Node):
+    """
+    A node in a MergedSupergraph, for a node in the StmtGraph of the given
+    function (by key)
+    """
+    __slots__ = ('function', 'line')
+
+    def __init__(self, function, line):
+        Node.__init__(self)
+        self.function = function
+        self.line = line
+
+    def __str__(self):
+        return '%s:%i' % (self.function, self.line)
+
+    def __repr__(self):
+        return '%s(%r, %r)' % (self.__class__.__name__,
+                               self.function, self.line)
+
+    def get_subgraph_path(self, ctxt):
+        if self.function:
+            return (Subgraph(self.function, self.function), )
+        return ()
+
+class MergedCallNode(MergedNode):
+    """
+    The node for the invocation of a function from a call site
+    """
+    __slots__ = ()
+
+class MergedReturnNode(MergedNode):
+    """
+    The node for the return to a call site from the function it called
+    """
+    __slots__ = ()
+
+class MergedFakeEntryNode(MergedNode):
+    """
+    Fake entry node which links to all externally-visible entry nodes, as
+    per FakeEntryNode within gccutils.graph.supergraph
+    """
+    __slots__ = ()
+
+    def __str__(self):
+        return 'ALL ENTRYPOINTS'
+
+class MergedEdge(Edge):
+    """
+    An intraprocedural edge within a MergedSupergraph
+    """
+    __slots__ = ()
+
+class MergedCallToReturnSiteEdge(MergedEdge):
+    """
+    The intraprocedural edge for a function call, from the call to the
+    return site
+    """
+    __slots__ = ()
+
+    def to_dot_label(self, ctxt):
+        return 'within function'
+
+    def to_dot_attrs(self, ctxt):
+        return ' penwidth=2'
+
+class MergedCallToStart(MergedEdge):
+    """
+    The interprocedural edge for the start of a function call: from the
+    call site to the entry node of the callee
+    """
+    __slots__ = ()
+
+    def to_dot_label(self, ctxt):
+        return 'call of %s' % self.dstnode.function
+
+    def to_dot_attrs(self, ctxt):
+        return ' style=dotted'
+
+class MergedExitToReturnSite(MergedEdge):
+    """
+    The interprocedural edge for the end of a function call: from the
+    exit node of the callee to the return site within the caller
+    """
+    __slots__ = ()
+
+    def to_dot_label(self, ctxt):
+        return 'return to %s' % self.dstnode.function
+
+    def to_dot_attrs(self, ctxt):
+        return ' style=dotted'
+
+class MergedFakeEntryEdge(MergedEdge):
+    """
+    Fake edge from the MergedFakeEntryNode to one of the entrypoints
+    """
+    __slots__ = ()
+
+    def to_dot_label(self, ctxt):
+        return 'external call'
@@ -215,7 +215,11 @@ class StmtNode(Node):
             return Text(str(self))
 
     def __eq__(self, other):
-        return self.stmt == other.stmt
+        if self.stmt is None:
+            # Nodes for empty BBs (such as the entry and exit) have no
+            # statement to compare:
+            return self is other
+        return isinstance(other, StmtNode) and self.stmt == other.stmt
 
 class EntryNode(StmtNode):
     __slots__ = ()
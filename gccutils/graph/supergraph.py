@@ -15,21 +15,25 @@
 #   along with this program.  If not, see
 #   <http://www.gnu.org/licenses/>.
 
+from array import array
+from collections import OrderedDict
+
 from gccutils.graph import Graph, Node, Edge, Subgraph
+from gccutils.graph.compact import CompactGraph, NodeView, EdgeView
 from gccutils.graph.stmtgraph import StmtGraph
 
 ############################################################################
 # Supergraph of all CFGs, built from each functions' StmtGraph.
 # A graph in which the nodes wrap StmtNode
 ############################################################################
-class Supergraph(Graph):
-    __slots__ = ('supernode_for_stmtnode',
-                 'stmtg_for_fun',
-                 'fake_entry_node')
+class SupergraphMixin(object):
+    """
+    The construction and behaviors of a supergraph, shared by Supergraph
+    and CompactSupergraph
+    """
+    __slots__ = ()
 
-    def __init__(self, split_phi_nodes, add_fake_entry_node):
-        Graph.__init__(self)
-        self.supernode_for_stmtnode = {}
+    def _build(self, split_phi_nodes, add_fake_entry_node):
         # 1st pass: locate interprocedural instances of gcc.GimpleCall
         # i.e. where both caller and callee are within the supergraph
         # (perhaps the same function)
@@ -44,73 +48,31 @@ class Supergraph(Graph):
 
         # 2nd pass: construct a StmtGraph for each function in the callgraph
         # and add nodes and edges to "self" wrapping the nodes and edges
-        # within each StmtGraph:
-        self.stmtg_for_fun = {}
+        # within each StmtGraph.
+        # dict from gcc.GimpleCall to the (CallNode, ReturnNode) pair for it:
+        callsites = {}
         for node in get_callgraph_nodes():
             fun = node.decl.function
             if fun:
-                stmtg = StmtGraph(fun, split_phi_nodes)
-                self.stmtg_for_fun[fun] = stmtg
-                # Clone the stmtg nodes and edges into the Supergraph:
-                stmtg.supernode_for_stmtnode = {}
-                for node in stmtg.nodes:
-                    if node.stmt in ipcalls:
-                        # These nodes will have two supernodes, a CallNode
-                        # and a ReturnNode:
-                        callnode = self.add_node(CallNode(node, stmtg))
-                        returnnode = self.add_node(ReturnNode(node, stmtg))
-                        callnode.returnnode = returnnode
-                        returnnode.callnode = callnode
-                        stmtg.supernode_for_stmtnode[node] = (callnode, returnnode)
-                        self.add_edge(
-                            callnode, returnnode,
-                            CallToReturnSiteEdge, None)
-                    else:
-                        stmtg.supernode_for_stmtnode[node] = \
-                            self.add_node(SupergraphNode(node, stmtg))
-                for edge in stmtg.edges:
-                    if edge.srcnode.stmt in ipcalls:
-                        # Begin the superedge from the ReturnNode:
-                        srcsupernode = stmtg.supernode_for_stmtnode[edge.srcnode][1]
-                    else:
-                        srcsupernode = stmtg.supernode_for_stmtnode[edge.srcnode]
-                    if edge.dstnode.stmt in ipcalls:
-                        # End the superedge at the CallNode:
-                        dstsupernode = stmtg.supernode_for_stmtnode[edge.dstnode][0]
-                    else:
-                        dstsupernode = stmtg.supernode_for_stmtnode[edge.dstnode]
-                    superedge = self.add_edge(srcsupernode, dstsupernode,
-                                              SupergraphEdge, edge)
+                stmtg = self._make_stmtgraph(fun, split_phi_nodes)
+                self._add_function(stmtg, ipcalls, callsites)
 
         # 3rd pass: add the interprocedural edges (call and return):
         for node in get_callgraph_nodes():
             fun = node.decl.function
             if fun:
                 for edge in node.callees:
-                    if edge.callee.decl.function:
-                        calling_stmtg = self.stmtg_for_fun[fun]
-                        called_stmtg = self.stmtg_for_fun[edge.callee.decl.function]
-
-                        calling_stmtnode = calling_stmtg.node_for_stmt[edge.call_stmt]
-                        assert calling_stmtnode
-
-                        entry_stmtnode = called_stmtg.entry
-                        assert entry_stmtnode
-
-                        exit_stmtnode = called_stmtg.exit
-                        assert exit_stmtnode
-
-                        superedge_call = self.add_edge(
-                            calling_stmtg.supernode_for_stmtnode[calling_stmtnode][0],
-                            called_stmtg.supernode_for_stmtnode[entry_stmtnode],
-                            CallToStart,
-                            None)
-                        superedge_return = self.add_edge(
-                            called_stmtg.supernode_for_stmtnode[exit_stmtnode],
-                            calling_stmtg.supernode_for_stmtnode[calling_stmtnode][1],
-                            ExitToReturnSite,
-                            None)
-                        superedge_return.calling_stmtnode = calling_stmtnode
+                    called_fun = edge.callee.decl.function
+                    if called_fun:
+                        callnode, returnnode = callsites[edge.call_stmt]
+                        self.add_edge(callnode,
+                                      self.get_function_entry(called_fun),
+                                      CallToStart,
+                                      None)
+                        self.add_edge(self.get_function_exit(called_fun),
+                                      returnnode,
+                                      ExitToReturnSite,
+                                      None)
 
         # 4th pass: create fake entry node:
         if not add_fake_entry_node:
@@ -130,20 +92,54 @@ class Supergraph(Graph):
 	  }
           """
         # For now, assume all non-static functions are possible entrypoints:
-        for fun in self.stmtg_for_fun:
+        for fun in self.get_functions():
             # Only for non-static functions:
             if fun.decl.is_public:
-                stmtg = self.stmtg_for_fun[fun]
                 self.add_edge(self.fake_entry_node,
-                              stmtg.supernode_for_stmtnode[stmtg.entry],
+                              self.get_function_entry(fun),
                               FakeEntryEdge,
                               None)
 
-    def add_node(self, supernode):
-        Graph.add_node(self, supernode)
-        # Keep track of mapping from stmtnode -> supernode
-        self.supernode_for_stmtnode[supernode.innernode] = supernode
-        return supernode
+    def _add_function(self, stmtg, ipcalls, callsites):
+        # Clone the stmtg nodes and edges into the Supergraph:
+        supernode_for_stmtnode = {}
+        for node in self._get_stmtnodes(stmtg):
+            if node.stmt in ipcalls:
+                # These nodes will have two supernodes, a CallNode
+                # and a ReturnNode (added consecutively, which
+                # CompactSupergraph relies on):
+                callnode = self.add_node(CallNode(node, stmtg))
+                returnnode = self.add_node(ReturnNode(node, stmtg))
+                callnode.returnnode = returnnode
+                returnnode.callnode = callnode
+                supernode_for_stmtnode[node] = (callnode, returnnode)
+                callsites[node.stmt] = (callnode, returnnode)
+                self.add_edge(
+                    callnode, returnnode,
+                    CallToReturnSiteEdge, None)
+            else:
+                supernode_for_stmtnode[node] = \
+                    self.add_node(SupergraphNode(node, stmtg))
+        for edge in stmtg.edges:
+            if edge.srcnode.stmt in ipcalls:
+                # Begin the superedge from the ReturnNode:
+                srcsupernode = supernode_for_stmtnode[edge.srcnode][1]
+            else:
+                srcsupernode = supernode_for_stmtnode[edge.srcnode]
+            if edge.dstnode.stmt in ipcalls:
+                # End the superedge at the CallNode:
+                dstsupernode = supernode_for_stmtnode[edge.dstnode][0]
+            else:
+                dstsupernode = supernode_for_stmtnode[edge.dstnode]
+            self.add_edge(srcsupernode, dstsupernode,
+                          SupergraphEdge, edge)
+        self._add_function_entry_exit(stmtg,
+                                      supernode_for_stmtnode[stmtg.entry],
+                                      supernode_for_stmtnode[stmtg.exit])
+        return supernode_for_stmtnode
+
+    def _get_stmtnodes(self, stmtg):
+        return stmtg.nodes
 
     def _make_edge(self, srcnode, dstnode, cls, edge):
         return cls(srcnode, dstnode, edge)
@@ -152,10 +148,258 @@ class Supergraph(Graph):
         if self.fake_entry_node:
             yield self.fake_entry_node
 
+class Supergraph(SupergraphMixin, Graph):
+    __slots__ = ('supernode_for_stmtnode',
+                 'stmtg_for_fun',
+                 'fake_entry_node')
+
+    def __init__(self, split_phi_nodes, add_fake_entry_node):
+        Graph.__init__(self)
+        self.supernode_for_stmtnode = {}
+        self.stmtg_for_fun = {}
+        self._build(split_phi_nodes, add_fake_entry_node)
+
+    def _make_stmtgraph(self, fun, split_phi_nodes):
+        stmtg = StmtGraph(fun, split_phi_nodes)
+        self.stmtg_for_fun[fun] = stmtg
+        return stmtg
+
+    def _add_function(self, stmtg, ipcalls, callsites):
+        stmtg.supernode_for_stmtnode = \
+            SupergraphMixin._add_function(self, stmtg, ipcalls, callsites)
+
+    def _add_function_entry_exit(self, stmtg, entry, exit):
+        pass
+
+    def add_node(self, supernode):
+        supernode = Graph.add_node(self, supernode)
+        # Keep track of mapping from stmtnode -> supernode
+        self.supernode_for_stmtnode[supernode.innernode] = supernode
+        return supernode
+
     def get_functions(self):
         for fun in self.stmtg_for_fun:
             yield fun
 
+    def get_function_entry(self, fun):
+        """
+        Get the supernode for the entry of the given gcc.Function
+        """
+        stmtg = self.stmtg_for_fun[fun]
+        return stmtg.supernode_for_stmtnode[stmtg.entry]
+
+    def get_function_exit(self, fun):
+        """
+        Get the supernode for the exit of the given gcc.Function
+        """
+        stmtg = self.stmtg_for_fun[fun]
+        return stmtg.supernode_for_stmtnode[stmtg.exit]
+
+class SupernodeView(NodeView):
+    """
+    Mixin for the views of the nodes within a CompactSupergraph, looking up
+    the StmtGraph and StmtNode from their ids
+    """
+    __slots__ = ()
+
+    @property
+    def stmtg(self):
+        funid = self._graph._node_fun[self._index]
+        if funid != -1:
+            return self._graph._get_stmtgraph(funid)
+
+    @property
+    def innernode(self):
+        stmtg = self.stmtg
+        if stmtg is not None:
+            return stmtg.nodelist[self._graph._node_inner[self._index]]
+
+class SuperedgeView(EdgeView):
+    """
+    Mixin for the views of the edges within a CompactSupergraph, looking up
+    the StmtEdge from its id
+    """
+    __slots__ = ()
+
+    @property
+    def inneredge(self):
+        graph = self._graph
+        inner = graph._edge_inner[self._index]
+        if inner != -1:
+            funid = graph._node_fun[graph._edge_src[self._index]]
+            return graph._get_stmtgraph(funid).edgelist[inner]
+
+class IndexedStmtGraph(StmtGraph):
+    """
+    A StmtGraph which also records the order in which its nodes and edges
+    were created, so that they can be referred to by position (building
+    the StmtGraph again for the same gcc.Function gives the same positions)
+    """
+    __slots__ = ('nodelist', 'edgelist', 'index_of_node')
+
+    def __init__(self, fun, split_phi_nodes):
+        self.nodelist = []
+        self.edgelist = []
+        self.index_of_node = {}
+        StmtGraph.__init__(self, fun, split_phi_nodes)
+
+    def add_node(self, node):
+        node = StmtGraph.add_node(self, node)
+        self.index_of_node[node] = len(self.nodelist)
+        self.nodelist.append(node)
+        return node
+
+    def _make_edge(self, srcnode, dstnode, edge):
+        e = StmtGraph._make_edge(self, srcnode, dstnode, edge)
+        self.edgelist.append(e)
+        return e
+
+class CompactSupergraph(SupergraphMixin, CompactGraph):
+    """
+    A Supergraph with the same API, but stored in packed arrays (see
+    gccutils.graph.compact), with the nodes and edges created on demand.
+
+    Rather than holding on to the StmtGraph for every function, each
+    supernode records just the index of its function, and the position of
+    its StmtNode within the function's StmtGraph (and each superedge the
+    position of its StmtEdge).  The StmtGraphs are rebuilt on demand from
+    the gcc.Function, keeping the most recently used ones in a cache.
+    Hence the supergraph should only be used whilst GCC's representation
+    of the functions is unchanged (e.g. within the pass that built it).
+
+    This uses much less memory than Supergraph for the whole of a large
+    program.
+    """
+    __slots__ = ('split_phi_nodes',
+                 'fake_entry_node',
+                 '_funs', '_fun_index',
+                 '_fun_entry', '_fun_exit', '_fun_numnodes',
+                 '_node_fun', '_node_inner',
+                 '_edge_inner',
+                 '_stmtg_cache')
+
+    node_view_mixin = SupernodeView
+    edge_view_mixin = SuperedgeView
+
+    # The number of StmtGraphs to keep in the cache:
+    max_cached_stmtgraphs = 32
+
+    def __init__(self, split_phi_nodes, add_fake_entry_node):
+        CompactGraph.__init__(self)
+        self.split_phi_nodes = split_phi_nodes
+
+        # The gcc.Function instances, indexed by function id, and the
+        # reverse mapping:
+        self._funs = []
+        self._fun_index = {}
+        # Per function id: the indices of the entry and exit supernodes, and
+        # the number of nodes within the StmtGraph:
+        self._fun_entry = array('l')
+        self._fun_exit = array('l')
+        self._fun_numnodes = array('l')
+
+        # Per supernode: the function id, and the position of the StmtNode
+        # within that function's StmtGraph (-1 for the FakeEntryNode):
+        self._node_fun = array('l')
+        self._node_inner = array('l')
+
+        # Per superedge: the position of the StmtEdge within the StmtGraph
+        # of the function of its srcnode (-1 if it doesn't wrap one):
+        self._edge_inner = array('l')
+
+        # From function id to IndexedStmtGraph, most recently used last:
+        self._stmtg_cache = OrderedDict()
+
+        self._build(split_phi_nodes, add_fake_entry_node)
+
+    #######################################################################
+    # Construction
+    #######################################################################
+    def _make_stmtgraph(self, fun, split_phi_nodes):
+        funid = len(self._funs)
+        self._funs.append(fun)
+        self._fun_index[fun] = funid
+        stmtg = IndexedStmtGraph(fun, split_phi_nodes)
+        self._fun_numnodes.append(len(stmtg.nodelist))
+        self._cache_stmtgraph(funid, stmtg)
+        return stmtg
+
+    def _get_stmtnodes(self, stmtg):
+        # Add the nodes in the order in which the StmtGraph created them,
+        # so that each function's supernodes are contiguous and in a
+        # reproducible order:
+        return stmtg.nodelist
+
+    def _add_function_entry_exit(self, stmtg, entry, exit):
+        self._fun_entry.append(entry._index)
+        self._fun_exit.append(exit._index)
+
+    def _add_node_fields(self, node):
+        if node.stmtg is None:
+            self._node_fun.append(-1)
+            self._node_inner.append(-1)
+        else:
+            self._node_fun.append(self._fun_index[node.stmtg.fun])
+            self._node_inner.append(node.stmtg.index_of_node[node.innernode])
+
+    def _add_edge_fields(self, edge):
+        if edge.inneredge is None:
+            self._edge_inner.append(-1)
+        else:
+            # StmtEdge.sortidx is the position of the edge within the
+            # StmtGraph:
+            self._edge_inner.append(edge.inneredge.sortidx)
+
+    #######################################################################
+    # Lookup
+    #######################################################################
+    def _cache_stmtgraph(self, funid, stmtg):
+        self._stmtg_cache[funid] = stmtg
+        while len(self._stmtg_cache) > self.max_cached_stmtgraphs:
+            self._stmtg_cache.popitem(last=False)
+
+    def _get_stmtgraph(self, funid):
+        stmtg = self._stmtg_cache.get(funid)
+        if stmtg is not None:
+            # Mark as most recently used:
+            del self._stmtg_cache[funid]
+            self._stmtg_cache[funid] = stmtg
+            return stmtg
+        stmtg = IndexedStmtGraph(self._funs[funid], self.split_phi_nodes)
+        if len(stmtg.nodelist) != self._fun_numnodes[funid]:
+            raise ValueError('%s has changed since the supergraph was built'
+                             % self._funs[funid].decl.name)
+        self._cache_stmtgraph(funid, stmtg)
+        return stmtg
+
+    def get_functions(self):
+        return iter(self._funs)
+
+    def get_function_entry(self, fun):
+        """
+        Get the supernode for the entry of the given gcc.Function
+        """
+        return self._make_node_view(self._fun_entry[self._fun_index[fun]])
+
+    def get_function_exit(self, fun):
+        """
+        Get the supernode for the exit of the given gcc.Function
+        """
+        return self._make_node_view(self._fun_exit[self._fun_index[fun]])
+
+    def _make_node_view(self, idx):
+        node = CompactGraph._make_node_view(self, idx)
+        # Reconstruct the links between CallNode and ReturnNode pairs:
+        if isinstance(node, CallNode):
+            # (the ReturnNode won't exist yet whilst adding the CallNode)
+            if idx + 1 < len(self._node_kind):
+                node.returnnode = CompactGraph._make_node_view(self, idx + 1)
+                node.returnnode.callnode = node
+        elif isinstance(node, ReturnNode):
+            node.callnode = CompactGraph._make_node_view(self, idx - 1)
+            node.callnode.returnnode = node
+        return node
+
 class SupergraphNode(Node):
     """
     A node in the supergraph, wrapping a StmtNode
@@ -314,7 +558,14 @@ class ExitToReturnSite(SupergraphEdge):
     the exit node of the callee to the successor node of the
     gcc.GimpleCall within the caller
     """
-    __slots__ = ('calling_stmtnode', )
+    __slots__ = ()
+
+    @property
+    def calling_stmtnode(self):
+        """
+        The StmtNode for the gcc.GimpleCall being returned to
+        """
+        return self.dstnode.innernode
 
     def to_dot_label(self, ctxt):
         return 'return to %s' % self.dstnode.function.decl.name
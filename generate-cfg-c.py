@@ -110,6 +110,22 @@ def generate_basic_block():
                                                 'PyGccBasicBlock_get_rtl',
                                                 None,
                                                 'The list of gcc.Rtl instructions, if appropriate for this pass, or None'),
+                                    PyGetSetDef('idom',
+                                                'PyGccBasicBlock_get_idom',
+                                                None,
+                                                'The immediate dominator of this gcc.BasicBlock, or None for the entry block'),
+                                    PyGetSetDef('ipostdom',
+                                                'PyGccBasicBlock_get_ipostdom',
+                                                None,
+                                                'The immediate postdominator of this gcc.BasicBlock, or None for the exit block'),
+                                    PyGetSetDef('dom_children',
+                                                'PyGccBasicBlock_get_dom_children',
+                                                None,
+                                                'The list of gcc.BasicBlock instances immediately dominated by this block'),
+                                    PyGetSetDef('postdom_children',
+                                                'PyGccBasicBlock_get_postdom_children',
+                                                None,
+                                                'The list of gcc.BasicBlock instances immediately postdominated by this block'),
                                     ],
                                    identifier_prefix='PyGccBasicBlock',
                                    typename='PyGccBasicBlock')
@@ -119,6 +135,27 @@ def generate_basic_block():
                                   None)
     cu.add_defn(getsettable.c_defn())
 
+    methods = PyMethodTable('PyGccBasicBlock_methods', [])
+    for name, doc in [('dominated_by',
+                       'Does the given gcc.BasicBlock dominate this one?'),
+                      ('postdominated_by',
+                       'Does the given gcc.BasicBlock postdominate this one?')]:
+        parser = PyArgParser('PyGccBasicBlock_%s' % name,
+                             name,
+                             'PyGccBasicBlock_%s_impl' % name,
+                             [PyArg('other', 'O!',
+                                    typeobj='PyGccBasicBlock_TypeObj',
+                                    c_type='struct PyGccBasicBlock *')],
+                             selftype='struct PyGccBasicBlock',
+                             keywords=False)
+        cu.add_arg_parser(parser)
+        methods.add_parsed_method(parser, doc)
+    methods.add_method('iter_dominated',
+                       '(PyCFunction)PyGccBasicBlock_iter_dominated',
+                       'METH_NOARGS',
+                       'Iterate over the gcc.BasicBlock instances dominated by this one (including itself), in preorder over the dominator tree')
+    cu.add_defn(methods.c_defn())
+
     pytype = PyGccWrapperTypeObject(identifier = 'PyGccBasicBlock_TypeObj',
                           localname = 'BasicBlock',
                           tp_name = 'gcc.BasicBlock',
@@ -128,6 +165,7 @@ def generate_basic_block():
                           tp_repr = '(reprfunc)PyGccBasicBlock_repr',
                           #tp_str = '(reprfunc)PyGccBasicBlock_repr',
                           tp_getset = getsettable.identifier,
+                          tp_methods = methods.identifier,
                           )
     cu.add_defn(pytype.c_defn())
     modinit_preinit += pytype.c_invoke_type_ready()
@@ -171,11 +209,19 @@ def generate_cfg():
                           #tp_str = '(reprfunc)PyGccCfg_repr',
                           tp_getset = getsettable.identifier,
                           )
+    cu.add_decl('extern PyGccWrapperTypeObject PyGccLabelDecl_TypeObj;\n')
+    get_block_for_label = PyArgParser('PyGccCfg_get_block_for_label',
+                                      'get_block_for_label',
+                                      'PyGccCfg_get_block_for_label_impl',
+                                      [PyArg('label', 'O!',
+                                             typeobj='PyGccLabelDecl_TypeObj',
+                                             c_type='struct PyGccTree *')],
+                                      selftype='struct PyGccCfg',
+                                      keywords=False)
+    cu.add_arg_parser(get_block_for_label)
     methods = PyMethodTable('PyGccCfg_methods', [])
-    methods.add_method('get_block_for_label',
-                       'PyGccCfg_get_block_for_label',
-                       'METH_VARARGS',
-                       "Given a gcc.LabelDecl, get the corresponding gcc.BasicBlock")
+    methods.add_parsed_method(get_block_for_label,
+                              "Given a gcc.LabelDecl, get the corresponding gcc.BasicBlock")
     cu.add_defn(methods.c_defn())
     pytype.tp_methods = methods.identifier
 
@@ -185,6 +231,66 @@ def generate_cfg():
 
 generate_cfg()
 
+def generate_loop():
+    #
+    # Generate the gcc.Loop class:
+    #
+    global modinit_preinit
+    global modinit_postinit
+
+    getsettable = PyGetSetDefTable('PyGccLoop_getset_table',
+                                   [PyGetSetDef('outer',
+                                                'PyGccLoop_get_outer',
+                                                None,
+                                                'The gcc.Loop immediately containing this one, or None for an outermost loop'),
+                                    PyGetSetDef('inner',
+                                                'PyGccLoop_get_inner',
+                                                None,
+                                                'The list of gcc.Loop instances immediately nested within this one'),
+                                    PyGetSetDef('blocks',
+                                                'PyGccLoop_get_blocks',
+                                                None,
+                                                'The list of gcc.BasicBlock instances within this loop, header first'),
+                                    PyGetSetDef('exits',
+                                                'PyGccLoop_get_exits',
+                                                None,
+                                                'The list of gcc.Edge instances leading out of this loop'),
+                                    ],
+                                   identifier_prefix='PyGccLoop',
+                                   typename='PyGccLoop')
+    getsettable.add_simple_getter(cu,
+                                  'num',
+                                  'PyGccInt_FromLong(gcc_loop_get_num(self->loop))',
+                                  'The index of this loop within its function')
+    getsettable.add_simple_getter(cu,
+                                  'header',
+                                  'PyGccBasicBlock_New(gcc_loop_get_header(self->loop))',
+                                  'The gcc.BasicBlock at the head of this loop')
+    getsettable.add_simple_getter(cu,
+                                  'latch',
+                                  'PyGccBasicBlock_New(gcc_loop_get_latch(self->loop))',
+                                  'The gcc.BasicBlock with the back edge to the header, or None if there is more than one')
+    getsettable.add_simple_getter(cu,
+                                  'depth',
+                                  'PyGccInt_FromLong(gcc_loop_get_depth(self->loop))',
+                                  'How deeply nested this loop is (1 for an outermost loop)')
+    cu.add_defn(getsettable.c_defn())
+
+    pytype = PyGccWrapperTypeObject(identifier = 'PyGccLoop_TypeObj',
+                          localname = 'Loop',
+                          tp_name = 'gcc.Loop',
+                          tp_dealloc = 'PyGccWrapper_Dealloc',
+                          struct_name = 'PyGccLoop',
+                          tp_new = 'PyType_GenericNew',
+                          tp_repr = '(reprfunc)PyGccLoop_repr',
+                          tp_getset = getsettable.identifier,
+                          )
+    cu.add_defn(pytype.c_defn())
+    modinit_preinit += pytype.c_invoke_type_ready()
+    modinit_postinit += pytype.c_invoke_add_to_module()
+
+generate_loop()
+
 cu.add_defn("""
 int autogenerated_cfg_init_types(void)
 {
@@ -0,0 +1,73 @@
+#   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2012 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+# Generate the entry points for gcc.permerror(), gcc.error(), gcc.warning()
+# and gcc.inform(), which parse their arguments and then call the "_impl"
+# functions within gcc-python-diagnostics.c
+#
+# These are called a lot by checkers, so they use the precomputed argument
+# parsers from cpybuilder.  The module's method table is in gcc-python.c
+
+from cpybuilder import *
+from testcpychecker import get_gcc_version
+
+cu = CompilationUnit()
+cu.add_include('gcc-python.h')
+cu.add_include('gcc-python-wrappers.h')
+cu.add_include('gcc-plugin.h')
+
+def make_location_arg():
+    return PyArg('location', 'O!',
+                 typeobj='PyGccLocation_TypeObj',
+                 c_type='struct PyGccLocation *')
+
+def generate_diagnostics():
+    cu.add_arg_parser(PyArgParser('PyGcc_permerror', 'permerror',
+                                  'PyGcc_permerror_impl',
+                                  [make_location_arg(),
+                                   PyArg('message', 's')],
+                                  keywords=False,
+                                  is_static=False))
+
+    cu.add_arg_parser(PyArgParser('PyGcc_error', 'error',
+                                  'PyGcc_error_impl',
+                                  [make_location_arg(),
+                                   PyArg('message', 's')],
+                                  is_static=False))
+
+    cu.add_arg_parser(PyArgParser('PyGcc_warning', 'warning',
+                                  'PyGcc_warning_impl',
+                                  [make_location_arg(),
+                                   PyArg('message', 's'),
+                                   PyArg('option', 'O', default='Py_None')],
+                                  is_static=False))
+
+    # From gcc 6 onwards, gcc.inform() also accepts a gcc.RichLocation;
+    # the impl checks the type of the location:
+    if get_gcc_version() >= 6000:
+        location_arg = PyArg('location', 'O')
+    else:
+        location_arg = make_location_arg()
+    cu.add_arg_parser(PyArgParser('PyGcc_inform', 'inform',
+                                  'PyGcc_inform_impl',
+                                  [location_arg,
+                                   PyArg('message', 's')],
+                                  is_static=False))
+
+generate_diagnostics()
+
+print(cu.as_str())
@@ -46,6 +46,8 @@ def generate_function():
     getsettable = PyGetSetDefTable('PyGccFunction_getset_table',
                                    [PyGetSetDef('cfg', 'PyGccFunction_get_cfg', None,
                                                 'Instance of gcc.Cfg for this function (or None for early passes)'),
+                                    PyGetSetDef('loops', 'PyGccFunction_get_loops', None,
+                                                'List of gcc.Loop for the outermost natural loops within this function (or None if GCC has not discovered them)'),
                                     ],
                                    identifier_prefix='PyGccFunction',
                                    typename='PyGccFunction')
@@ -263,6 +263,11 @@ def generate_gimple_subclasses():
                              None,
                              'The operands on the right-hand-side of the expression, as a list of gcc.Tree instances')
 
+    decoded_getter = PyGetSetDef('decoded',
+                                 'PyGccGimple_get_decoded',
+                                 None,
+                                 'All of the operands of this statement, as a memoized gcc.DecodedGimple record')
+
     def make_getset_Asm():
         getsettable = PyGetSetDefTable('gcc_%s_getset_table' % cc,
                                        [exprcode_getter],
@@ -284,6 +289,7 @@ def generate_gimple_subclasses():
                                              'Left-hand-side of the assignment, as a gcc.Tree'),
                                  exprcode_getter,
                                  rhs_getter,
+                                 decoded_getter,
                                  ])
     def make_getset_Call():
         return PyGetSetDefTable('gcc_%s_getset_table' % cc,
@@ -318,6 +324,7 @@ def generate_gimple_subclasses():
 
                                              None,
                                              'Has this call been marked as not returning, as a boolean'),
+                                 decoded_getter,
                                  ],
                                 )
     def make_getset_Return():
@@ -462,6 +469,14 @@ PyGcc_autogenerated_gimple_type_for_stmt(gcc_gimple stmt)
 
 generate_gimple_code_map()
 
+# gcc.DecodedGimple is a PyStructSequence, defined in gcc-python-gimple.c:
+modinit_preinit += ('    if (!PyGccDecodedGimple_InitType())\n'
+                    '        goto error;\n'
+                    '\n')
+modinit_postinit += ('    Py_INCREF(&PyGccDecodedGimple_TypeObj);\n'
+                     '    PyModule_AddObject(m, "DecodedGimple", (PyObject *)&PyGccDecodedGimple_TypeObj);\n'
+                     '\n')
+
 
 cu.add_defn("""
 int autogenerated_gimple_init_types(void)
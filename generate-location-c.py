@@ -104,10 +104,14 @@ PyGccLocation_get_finish(struct PyGccLocation *self, void *closure)
 
     methods = PyMethodTable('PyGccLocation_methods', [])
     if get_gcc_version() >= 5000:
-        methods.add_method('offset_column',
-                           '(PyCFunction)PyGccLocation_offset_column',
-                           'METH_VARARGS',
-                           "")
+        offset_column = PyArgParser('PyGccLocation_offset_column',
+                                    'offset_column',
+                                    'PyGccLocation_offset_column_impl',
+                                    [PyArg('offset', 'i')],
+                                    selftype='PyGccLocation',
+                                    keywords=False)
+        cu.add_arg_parser(offset_column)
+        methods.add_parsed_method(offset_column, "")
     cu.add_defn(methods.c_defn())
 
     pytype = PyGccWrapperTypeObject(identifier = 'PyGccLocation_TypeObj',
@@ -62,6 +62,10 @@ def generate_pass():
                           'PyGccPass_get_dump_enabled',
                           'PyGccPass_set_dump_enabled',
                           '(boolean) Is dumping enabled for this pass?')
+    getsettable.add_gsdef('enabled',
+                          'PyGccPass_get_enabled',
+                          'PyGccPass_set_enabled',
+                          '(boolean) Should this pass be run?  If False, its gate returns False without calling into Python')
     cu.add_defn(getsettable.c_defn())
 
     methods = PyMethodTable('PyGccPass_methods', [])
@@ -0,0 +1,83 @@
+#   Copyright 2011 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2011 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+
+from cpybuilder import *
+
+cu = CompilationUnit()
+cu.add_include('gcc-python.h')
+cu.add_include('gcc-python-wrappers.h')
+cu.add_include('gcc-plugin.h')
+
+modinit_preinit = ''
+modinit_postinit = ''
+
+def generate_wrapper_sequence():
+    #
+    # Generate the gcc.WrapperSequence class:
+    #
+    global modinit_preinit
+    global modinit_postinit
+
+    seqmethods = PySequenceMethods('PyGccWrapperSequence_as_sequence',
+                                   sq_length='PyGccWrapperSequence_len',
+                                   sq_item='PyGccWrapperSequence_item')
+    cu.add_defn(seqmethods.c_defn())
+
+    mapmethods = PyMappingMethods('PyGccWrapperSequence_as_mapping',
+                                  mp_length='PyGccWrapperSequence_len',
+                                  mp_subscript='PyGccWrapperSequence_subscript')
+    cu.add_defn(mapmethods.c_defn())
+
+    pytype = PyTypeObject(identifier = 'PyGccWrapperSequence_TypeObj',
+                          localname = 'WrapperSequence',
+                          tp_name = 'gcc.WrapperSequence',
+                          struct_name = 'struct PyGccWrapperSequence',
+                          tp_new = None,
+                          tp_dealloc = 'PyGccWrapperSequence_dealloc',
+                          tp_repr = '(reprfunc)PyGccWrapperSequence_repr',
+                          tp_as_sequence = '&PyGccWrapperSequence_as_sequence',
+                          tp_as_mapping = '&PyGccWrapperSequence_as_mapping',
+                          tp_richcompare = 'PyGccWrapperSequence_richcompare',
+                          )
+    cu.add_defn(pytype.c_defn())
+    modinit_preinit += pytype.c_invoke_type_ready()
+    modinit_postinit += pytype.c_invoke_add_to_module()
+
+generate_wrapper_sequence()
+
+cu.add_defn("""
+int autogenerated_sequence_init_types(void)
+{
+""" + modinit_preinit + """
+    return 1;
+
+error:
+    return 0;
+}
+""")
+
+cu.add_defn("""
+void autogenerated_sequence_add_types(PyObject *m)
+{
+""" + modinit_postinit + """
+}
+""")
+
+
+
+print(cu.as_str())
@@ -202,6 +202,9 @@ PyGccDeclaration_get_location(struct PyGccTree *self, void *closure)
             add_simple_getter('is_builtin',
                               'PyBool_FromLong(gcc_decl_is_builtin(PyGccTree_as_gcc_decl(self)))',
                               "Is this declaration built in by the compiler?")
+            add_simple_getter('is_used',
+                              'PyBool_FromLong(gcc_decl_is_used(PyGccTree_as_gcc_decl(self)))',
+                              "Has this declaration been referenced?")
             pytype.tp_repr = '(reprfunc)PyGccDeclaration_repr'
 
         if localname == 'Type':
@@ -582,6 +585,10 @@ def generate_tree_code_classes():
             add_simple_getter('result',
                               'PyGccTree_New(gcc_private_make_tree(DECL_RESULT_FLD(self->t.inner)))',
                               'The gcc.ResultDecl for the return value')
+            getsettable.add_gsdef('assembler_name',
+                                  'PyGccFunctionDecl_get_assembler_name',
+                                  None,
+                                  'The name of the symbol for this function, as seen by the assembler and linker (string)')
             getsettable.add_gsdef('callgraph_node',
                                   'PyGccFunctionDecl_get_callgraph_node',
                                   None,
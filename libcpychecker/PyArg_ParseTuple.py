@@ -43,27 +43,28 @@ from libcpychecker.formatstrings import *
 from libcpychecker.types import *
 from libcpychecker.utils import log
 
+# Convert 1-character argument code to a gcc.Type, covering the easy cases
+#
+# Analogous to Python/getargs.c:convertsimple, this is the same order as
+# that function's "switch" statement:
+_simple_arg_types = {'b': gcc.Type.unsigned_char,
+                     'B': gcc.Type.unsigned_char,
+                     'h': gcc.Type.short,
+                     'H': gcc.Type.unsigned_short,
+                     'i': gcc.Type.int,
+                     'I': gcc.Type.unsigned_int,
+                     'l': gcc.Type.long,
+                     'k': gcc.Type.unsigned_long,
+                     'f': gcc.Type.float,
+                     'd': gcc.Type.double,
+                     'c': gcc.Type.char,
+                     }
+
 def _type_of_simple_arg(arg):
-    # Convert 1-character argument code to a gcc.Type, covering the easy cases
-    #
-    # Analogous to Python/getargs.c:convertsimple, this is the same order as
-    # that function's "switch" statement:
-    simple = {'b': gcc.Type.unsigned_char,
-              'B': gcc.Type.unsigned_char,
-              'h': gcc.Type.short,
-              'H': gcc.Type.unsigned_short,
-              'i': gcc.Type.int,
-              'I': gcc.Type.unsigned_int,
-              'l': gcc.Type.long,
-              'k': gcc.Type.unsigned_long,
-              'f': gcc.Type.float,
-              'd': gcc.Type.double,
-              'c': gcc.Type.char,
-              }
-    if arg in simple:
+    if arg in _simple_arg_types:
         # FIXME: ideally this shouldn't need calling; it should just be an
         # attribute:
-        return simple[arg]()
+        return _simple_arg_types[arg]()
 
     if arg == 'n':
         return get_Py_ssize_t()
@@ -94,6 +95,9 @@ class TypeCheck(FormatUnit):
         # together the two arguments
         return [self.checker, self.result]
 
+    def reset(self):
+        self.typeobject = None
+
     def get_other_type(self):
         if not self.typeobject:
             return None
@@ -188,6 +192,10 @@ class Conversion(FormatUnit):
         # together the two arguments
         return [self.callback, self.result]
 
+    def reset(self):
+        self.callback.actual_type = None
+        self.result.type = None
+
 class ConverterCallbackType(AwkwardType):
     def __init__(self, conv):
         self.conv = conv
@@ -45,51 +45,52 @@ from libcpychecker.formatstrings import *
 from libcpychecker.types import *
 from libcpychecker.utils import log
 
+# Convert 1-character argument code to a gcc.Type, covering the easy cases
+#
+# Analogous to Python/modsupport.c:do_mkvalue, this is the same order as
+# that function's "switch" statement:
+_simple_arg_types = {
+    # all of these actually just use "int":
+    'b': gcc.Type.char,
+    'B': gcc.Type.unsigned_char,
+    'h': gcc.Type.short,
+    'i': gcc.Type.int,
+    'H': gcc.Type.unsigned_short,
+    'I': gcc.Type.unsigned_int,
+    # 'n' covered below
+    'l': gcc.Type.long,
+    'k': gcc.Type.unsigned_long,
+    # 'L' covered below
+    # 'K' covered below
+    # 'u': covered in from_string() below
+
+    'f': gcc.Type.double,
+    # (although documented as "[float]", 'f' accepts a "va_double" in
+    # modsupport.c)
+
+    'd': gcc.Type.double,
+    # 'D' covered below
+
+    'c': gcc.Type.int,
+    # (although documented as "[char]", 'c' accepts an "int" in
+    # modsupport.c)
+
+    # 's': covered in from_string() below
+    # 'z': covered in from_string() below
+    # 'N': covered in from_string() below
+    # 'S': covered in from_string() below
+    # 'O': covered in from_string() below
+    # ':': covered in from_string() below
+    # ',': covered in from_string() below
+    # ' ': covered in from_string() below
+    # '\t': covered in from_string() below
+    }
+
 def _type_of_simple_arg(arg):
-    # Convert 1-character argument code to a gcc.Type, covering the easy cases
-    #
-    # Analogous to Python/modsupport.c:do_mkvalue, this is the same order as
-    # that function's "switch" statement:
-    simple = {
-        # all of these actually just use "int":
-        'b': gcc.Type.char,
-        'B': gcc.Type.unsigned_char,
-        'h': gcc.Type.short,
-        'i': gcc.Type.int,
-        'H': gcc.Type.unsigned_short,
-        'I': gcc.Type.unsigned_int,
-        # 'n' covered below
-        'l': gcc.Type.long,
-        'k': gcc.Type.unsigned_long,
-        # 'L' covered below
-        # 'K' covered below
-        # 'u': covered in from_string() below
-
-        'f': gcc.Type.double,
-        # (although documented as "[float]", 'f' accepts a "va_double" in
-        # modsupport.c)
-
-        'd': gcc.Type.double,
-        # 'D' covered below
-
-        'c': gcc.Type.int,
-        # (although documented as "[char]", 'c' accepts an "int" in
-        # modsupport.c)
-
-        # 's': covered in from_string() below
-        # 'z': covered in from_string() below
-        # 'N': covered in from_string() below
-        # 'S': covered in from_string() below
-        # 'O': covered in from_string() below
-        # ':': covered in from_string() below
-        # ',': covered in from_string() below
-        # ' ': covered in from_string() below
-        # '\t': covered in from_string() below
-        }
-    if arg in simple:
+    if arg in _simple_arg_types:
         # FIXME: ideally this shouldn't need calling; it should just be an
         # attribute:
-        return simple[arg]()
+        return _simple_arg_types[arg]()
 
     if arg == 'n':
         return get_Py_ssize_t()
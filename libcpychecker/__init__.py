@@ -17,15 +17,80 @@
 
 from __future__ import print_function
 import sys
+import time
 import gcc
-from libcpychecker.formatstrings import check_pyargs
+from libcpychecker.formatstrings import check_pyargs, \
+    fnnames_with_format_strings
 from libcpychecker.utils import log
 from libcpychecker.refcounts import check_refcounts, get_traces
+from libcpychecker.profiling import get_profile_path
+from gccutils import sorted_callgraph, check_isinstance
 from libcpychecker.attributes import register_our_attributes
 from libcpychecker.initializers import check_initializers
 from libcpychecker.types import get_PyObject
+from libcpychecker.compat import get_api_fndecl_by_name
+from libcpychecker.ltocache import LtoCache
+from libcpychecker.summaries import get_summary, set_summary
 if hasattr(gcc, 'PLUGIN_FINISH_DECL'):
-    from libcpychecker.compat import on_finish_decl
+    from libcpychecker.compat import on_finish_decl, gather_lto_decls
+
+def _skip_check_isinstance(obj, types):
+    pass
+
+def set_fast_mode(fast=True):
+    """
+    Turn the refcount checker's internal consistency checks off (or back
+    on): the check_isinstance calls throughout absinterp.py and refcounts.py,
+    and the call to State.verify for every new State.
+
+    These catch bugs in the checker itself, rather than in the code being
+    checked, and are on the hot paths of the analysis.  The test suite runs
+    with them enabled.
+    """
+    from libcpychecker import absinterp, refcounts
+    if fast:
+        checker = _skip_check_isinstance
+    else:
+        checker = check_isinstance
+    # (each module looks up the name in its own globals when called)
+    for module in (absinterp, refcounts):
+        module.check_isinstance = checker
+    absinterp.verify_states = not fast
+
+# Running the embedded interpreter with -O (e.g. with PYTHONOPTIMIZE=1 in
+# the environment) selects fast mode.  This has to look at sys.flags rather
+# than __debug__: we're usually loaded from python-modules.zip, whose
+# bytecode was compiled without -O, and so has __debug__ folded to True:
+if sys.flags.optimize:
+    set_fast_mode()
+
+class UnitGate(object):
+    """
+    What we need to know about the translation unit to decide which of our
+    checks are worth running on its functions.
+
+    This is computed once, when the first function reaches our pass (by
+    which point the whole unit has been parsed), rather than rediscovered
+    for each function.
+    """
+    __slots__ = ('includes_Python_h', 'uses_format_string_apis')
+
+    def __init__(self):
+        # Does the unit include <Python.h>?
+        self.includes_Python_h = get_PyObject() is not None
+
+        # Does the unit call any of the functions that check_pyargs knows
+        # about?
+        self.uses_format_string_apis = False
+        for fnname in fnnames_with_format_strings:
+            decl = get_api_fndecl_by_name(fnname)
+            if decl and decl.is_used:
+                self.uses_format_string_apis = True
+                break
+
+    def __repr__(self):
+        return ('UnitGate(includes_Python_h=%r, uses_format_string_apis=%r)'
+                % (self.includes_Python_h, self.uses_format_string_apis))
 
 class CpyCheckerGimplePass(gcc.GimplePass):
     """
@@ -41,7 +106,16 @@ class CpyCheckerGimplePass(gcc.GimplePass):
                  only_on_python_code=True,
                  maxtrans=256,
                  dump_json=False,
-                 verbose=False):
+                 verbose=False,
+                 interprocedural=False,
+                 maxtime=None,
+                 maxtime_per_unit=None,
+                 maxmem=None,
+                 stats_file=None,
+                 profile=False,
+                 widen_loops=False,
+                 fast=False,
+                 lto_cache=None):
         gcc.GimplePass.__init__(self, 'cpychecker-gimple')
         self.dump_traces = dump_traces
         self.show_traces = show_traces
@@ -64,41 +138,126 @@ class CpyCheckerGimplePass(gcc.GimplePass):
         self.only_on_python_code = only_on_python_code
         self.maxtrans = maxtrans
         self.dump_json = dump_json
+        # If set, the refcount checker is run from the IPA pass instead,
+        # bottom-up over the callgraph, so that callers can make use of
+        # summaries of the functions they call:
+        self.interprocedural = interprocedural
+        # Budgets for the refcount checker, beyond maxtrans: seconds per
+        # function, seconds for the whole unit, and megabytes per function:
+        self.maxtime = maxtime
+        self.maxtime_per_unit = maxtime_per_unit
+        self.maxmem = maxmem
+        # The time.time() at which the per-unit budget runs out (set when
+        # the first function is checked):
+        self.deadline = None
+        self.reported_deadline = False
+        # Path of a file to which to append per-function statistics:
+        self.stats_file = stats_file
+        # If set, write a profile of the refcount checker's work on each
+        # function to a file for this unit (see profiling.py):
+        self.profile = profile
+        self.profile_file = None
+        # If set, the refcount checker follows loops to a fixpoint, rather
+        # than abandoning paths that go around them:
+        self.widen_loops = widen_loops
+        # If set, skip the checker's internal consistency checks:
+        if fast:
+            set_fast_mode()
+        # Path of a file in which to keep the results of the
+        # interprocedural analysis from one link-time run to the next, so
+        # that only the functions affected by a change need re-analyzing
+        # (see ltocache.py):
+        self.lto_cache = lto_cache
+        self.unit_gate = None
+
+    def on_finish_unit(self):
+        # gcc.Pass.enabled persists for the rest of the process, so undo any
+        # decision made in execute() for this unit:
+        self.enabled = True
+        self.unit_gate = None
+
+    def get_unit_gate(self):
+        if self.unit_gate is None:
+            self.unit_gate = UnitGate()
+            log('%s', self.unit_gate)
+        return self.unit_gate
+
+    def should_check_pyargs(self):
+        return (self.verify_pyargs
+                and self.get_unit_gate().uses_format_string_apis)
+
+    def should_check_refcounts(self):
+        if not self.verify_refcounting:
+            return False
+        if self.only_on_python_code:
+            # Only run the refcount checker on code that
+            # includes <Python.h>:
+            return self.get_unit_gate().includes_Python_h
+        return True
 
     def execute(self, fun):
         if fun:
+            if self.unit_gate is None:
+                # First function in this unit: if there's nothing for us to
+                # do here, turn off the pass, so that it isn't called back
+                # for any of the unit's other functions:
+                if not (self.should_check_pyargs()
+                        or (self.should_check_refcounts()
+                            and not self.interprocedural)):
+                    self.enabled = False
+                    return
+
             log('%s', fun)
-            if self.verify_pyargs:
+            if self.should_check_pyargs():
                 check_pyargs(fun)
 
-            if self.only_on_python_code:
-                # Only run the refcount checker on code that
-                # includes <Python.h>:
-                if not get_PyObject():
-                    return
+            if not self.should_check_refcounts():
+                return
 
             # The refcount code is too buggy for now to be on by default:
-            if self.verify_refcounting:
-                if 0:
-                    # Profiled version:
-                    import cProfile
-                    prof_filename = '%s.%s.refcount-profile' % (gcc.get_dump_base_name(),
-                                                                fun.decl.name)
-                    cProfile.runctx('self._check_refcounts(fun)',
-                                    globals(), locals(),
-                                    filename=prof_filename)
-                    import pstats
-                    prof = pstats.Stats(prof_filename)
-                    prof.sort_stats('cumulative').print_stats(20)
-                else:
-                    # Normal mode (without profiler):
-                    self._check_refcounts(fun)
-
-    def _check_refcounts(self, fun):
-        check_refcounts(fun, self.dump_traces, self.show_traces,
-                        self.show_possible_null_derefs,
-                        maxtrans=self.maxtrans,
-                        dump_json=self.dump_json)
+            if self.verify_refcounting and not self.interprocedural:
+                self._check_refcounts(fun)
+
+    def _check_refcounts(self, fun, record_summary=False):
+        if self.maxtime_per_unit is not None:
+            if self.deadline is None:
+                self.deadline = time.time() + self.maxtime_per_unit
+            elif time.time() > self.deadline:
+                # The budget was used up by earlier functions:
+                if not self.reported_deadline:
+                    gcc.inform(fun.start,
+                               ('the time budget of the reference-count'
+                                ' checker for this translation unit has run'
+                                ' out: not analyzing %r, or any later'
+                                ' functions' % fun.decl.name))
+                    self.reported_deadline = True
+                log('skipping %s: out of time for this unit', fun)
+                return None
+        if self.profile and self.profile_file is None:
+            # First function in this unit: truncate any file left behind by
+            # an earlier build:
+            self.profile_file = get_profile_path()
+            open(self.profile_file, 'w').close()
+        return check_refcounts(fun, self.dump_traces, self.show_traces,
+                               self.show_possible_null_derefs,
+                               maxtrans=self.maxtrans,
+                               dump_json=self.dump_json,
+                               record_summary=record_summary,
+                               maxtime=self.maxtime,
+                               maxmem=self.maxmem,
+                               deadline=self.deadline,
+                               stats_file=self.stats_file,
+                               profile_file=self.profile_file,
+                               widen_loops=self.widen_loops)
+
+    def get_lto_cache_config(self):
+        # The options that affect the results of the analysis of a function,
+        # beyond its body (see ltocache.py):
+        return dict(gcc_version=gcc.GCC_VERSION,
+                    maxtrans=self.maxtrans,
+                    show_possible_null_derefs=self.show_possible_null_derefs,
+                    widen_loops=self.widen_loops,
+                    includes_Python_h=self.get_unit_gate().includes_Python_h)
 
 
 class CpyCheckerIpaPass(gcc.SimpleIpaPass):
@@ -106,12 +265,70 @@ class CpyCheckerIpaPass(gcc.SimpleIpaPass):
     The custom pass that implements the whole-program part of
     our extra compile-time checks
     """
-    def __init__(self):
+    def __init__(self, gimple_ps):
         gcc.SimpleIpaPass.__init__(self, 'cpychecker-ipa')
+        self.gimple_ps = gimple_ps
 
     def execute(self):
         check_initializers()
 
+        gimple_ps = self.gimple_ps
+        # With an LTO cache, the interprocedural analysis is done at link
+        # time, by CpyCheckerLtoPass, rather than for each unit:
+        if (gimple_ps.interprocedural and not gimple_ps.lto_cache
+            and gimple_ps.should_check_refcounts()):
+            check_callgraph(gimple_ps)
+
+class CpyCheckerLtoPass(gcc.IpaPass):
+    """
+    The custom pass that implements the interprocedural mode of the
+    refcount checker at link time, over the whole program, when there's an
+    LTO cache (small IPA passes such as CpyCheckerIpaPass aren't run within
+    lto1)
+    """
+    def __init__(self, gimple_ps):
+        gcc.IpaPass.__init__(self, 'cpychecker-lto')
+        self.gimple_ps = gimple_ps
+
+    def execute(self):
+        # This pass is also run within cc1 when not using -flto:
+        if not gcc.is_lto():
+            return
+
+        gather_lto_decls()
+
+        gimple_ps = self.gimple_ps
+        if gimple_ps.should_check_refcounts():
+            cache = LtoCache(gimple_ps.lto_cache,
+                             gimple_ps.get_lto_cache_config())
+            check_callgraph(gimple_ps, cache)
+            cache.save()
+
+def check_callgraph(gimple_ps, cache=None):
+    """
+    Run the refcount checker over every function with a body, bottom-up
+    over the callgraph, recording the summary of each function for use by
+    its callers, and reusing the results of the previous link for those
+    functions that the LtoCache (if any) says are unaffected by any changes
+    """
+    # sorted_callgraph() gives callers before callees; walk it
+    # backwards so that each function's callees have already been
+    # summarized by the time we analyze it:
+    for node in reversed(sorted_callgraph()):
+        fun = node.decl.function
+        if fun and fun.cfg:
+            log('%s', fun)
+            if cache is None:
+                gimple_ps._check_refcounts(fun, record_summary=True)
+                continue
+            entry = cache.reuse(fun, node)
+            if entry:
+                if entry.summary:
+                    set_summary(fun.decl, entry.summary)
+                continue
+            rep = gimple_ps._check_refcounts(fun, record_summary=True)
+            cache.update(fun, get_summary(fun.decl), rep)
+
 def main(**kwargs):
     # Register our custom attributes:
     gcc.register_callback(gcc.PLUGIN_ATTRIBUTES,
@@ -131,5 +348,15 @@ def main(**kwargs):
         # SSA version:
         gimple_ps.register_after('ssa')
 
-    ipa_ps = CpyCheckerIpaPass()
+    gcc.register_callback(gcc.PLUGIN_FINISH_UNIT,
+                          gimple_ps.on_finish_unit)
+
+    ipa_ps = CpyCheckerIpaPass(gimple_ps)
     ipa_ps.register_before('*free_lang_data')
+
+    if (gimple_ps.interprocedural and gimple_ps.lto_cache
+        and hasattr(gcc, 'PLUGIN_FINISH_DECL')):
+        # Within lto1, the function bodies are available to the regular IPA
+        # passes when using -flto-partition=none:
+        lto_ps = CpyCheckerLtoPass(gimple_ps)
+        lto_ps.register_before('whole-program')
@@ -17,8 +17,11 @@
 
 import gcc
 import gccutils
+import itertools
+import os
 import re
 import sys
+import time
 from six import StringIO, integer_types
 
 from gccutils import get_src_for_loc, get_nonnull_arguments, check_isinstance
@@ -26,6 +29,7 @@ from gccutils.graph.stmtgraph import StmtGraph, StmtNode
 
 from collections import OrderedDict
 from libcpychecker.utils import log, logging_enabled
+from libcpychecker import profiling
 from libcpychecker.types import *
 from libcpychecker.diagnostics import location_as_json, type_as_json
 
@@ -187,6 +191,67 @@ class AbstractValue(object):
         self.gcctype = gcctype
         self.loc = loc
 
+    def _key(self):
+        """
+        For subclasses that merely describe a set of possible values, return
+        a tuple of the fields that identify that description, so that equal
+        descriptions compare (and hash) equal, and can be shared.
+
+        The default of None means that each instance is distinct, as for
+        UnknownValue, where two instances are two different unknowns.
+        """
+        return None
+
+    def _common_key(self):
+        return (self.gcctype, self.loc, hasattr(self, 'fromsplit'))
+
+    def __eq__(self, other):
+        if self is other:
+            return True
+        if other.__class__ is not self.__class__:
+            return False
+        key = self._key()
+        if key is None:
+            return False
+        return key == other._key()
+
+    def __ne__(self, other):
+        return not self.__eq__(other)
+
+    def __hash__(self):
+        key = self._key()
+        if key is None:
+            return id(self)
+        return hash(key)
+
+    def widen(self, prevvalue):
+        """
+        Called when going around a loop: get a value covering both this
+        value and prevvalue (the value at the previous iteration), growing
+        any bounds that changed out to the limits of the type, so that
+        repeated iterations of the loop reach a fixpoint.
+
+        Returns prevvalue itself if it already covers this value.
+
+        The default implementation can only do this for equal values.
+        """
+        if self == prevvalue:
+            return prevvalue
+        return self
+
+    def copy(self):
+        """
+        Make a shallow copy of this value (which might be interned, and
+        thus must not be modified in-place)
+        """
+        cls = self.__class__
+        result = cls.__new__(cls)
+        for klass in cls.__mro__:
+            for name in getattr(klass, '__slots__', ()):
+                if hasattr(self, name):
+                    setattr(result, name, getattr(self, name))
+        return result
+
     def __str__(self):
         if self.gcctype:
             result = '%s' % self.gcctype
@@ -297,6 +362,8 @@ class EmptySet(AbstractValue):
     """
     The empty set: there are no possible values for this variable (yet).
     """
+    __slots__ = ()
+
     def union(self, v_other):
         check_isinstance(v_other, AbstractValue)
         return v_other
@@ -305,6 +372,8 @@ class UnknownValue(AbstractValue):
     """
     A value that we know nothing about: it could be any of the possible values
     """
+    __slots__ = ()
+
     @classmethod
     def make(cls, gcctype, loc):
         """
@@ -355,6 +424,13 @@ class UnknownValue(AbstractValue):
         check_isinstance(v_other, AbstractValue)
         return self
 
+    def widen(self, prevvalue):
+        # Any unknown value of the type is as good as any other:
+        if (isinstance(prevvalue, UnknownValue)
+            and prevvalue.gcctype == self.gcctype):
+            return prevvalue
+        return self
+
 def eval_binop(exprcode, a, b, rhsvalue):
     """
     Evaluate a gcc exprcode on a pair of Python values (as opposed to
@@ -411,6 +487,37 @@ def eval_binop(exprcode, a, b, rhsvalue):
     return result
 
 
+def widen_range(value, prevvalue, minvalue, maxvalue):
+    """
+    Implementation of widen() for ConcreteValue and WithinRange, for a value
+    known to be within minvalue..maxvalue
+    """
+    if isinstance(prevvalue, ConcreteValue):
+        prevmin = prevmax = prevvalue.value
+    elif isinstance(prevvalue, WithinRange):
+        prevmin, prevmax = prevvalue.minvalue, prevvalue.maxvalue
+    else:
+        return value
+    if value.gcctype != prevvalue.gcctype:
+        return value
+
+    if prevmin <= minvalue and maxvalue <= prevmax:
+        # Already covered by the previous value:
+        return prevvalue
+
+    # Only integers have limits to widen out to:
+    if not isinstance(value.gcctype, gcc.IntegerType):
+        return value
+    if minvalue < prevmin:
+        minvalue = value.gcctype.min_value.constant
+    else:
+        minvalue = prevmin
+    if maxvalue > prevmax:
+        maxvalue = value.gcctype.max_value.constant
+    else:
+        maxvalue = prevmax
+    return WithinRange.make(value.gcctype, prevvalue.loc, minvalue, maxvalue)
+
 class ConcreteValue(AbstractValue):
     """
     A known, specific value (e.g. 0)
@@ -428,12 +535,13 @@ class ConcreteValue(AbstractValue):
 
     @classmethod
     def from_int(self, value):
-        return ConcreteValue(gcc.Type.int(), None, value)
+        return intern_value(ConcreteValue(gcc.Type.int(), None, value))
 
-    def __ne__(self, other):
-        if isinstance(other, ConcreteValue):
-            return self.value != other.value
-        return NotImplemented
+    def _key(self):
+        return (self._common_key(), self.value)
+
+    def widen(self, prevvalue):
+        return widen_range(self, prevvalue, self.value, self.value)
 
     def __str__(self):
         if self.loc:
@@ -711,6 +819,12 @@ class WithinRange(AbstractValue):
         if self.maxvalue > gcctype.max_value.constant:
             self.maxvalue = gcctype.max_value.constant
 
+    def _key(self):
+        return (self._common_key(), self.minvalue, self.maxvalue)
+
+    def widen(self, prevvalue):
+        return widen_range(self, prevvalue, self.minvalue, self.maxvalue)
+
     @classmethod
     def make(cls, gcctype, loc, *values):
         """
@@ -904,6 +1018,17 @@ class PointerToRegion(AbstractValue):
         check_isinstance(region, Region)
         self.region = region
 
+    def _key(self):
+        return (self._common_key(), self.region)
+
+    def widen(self, prevvalue):
+        # (ignoring where the pointer came from)
+        if (isinstance(prevvalue, PointerToRegion)
+            and prevvalue.region == self.region
+            and prevvalue.gcctype == self.gcctype):
+            return prevvalue
+        return self
+
     def __str__(self):
         if self.loc:
             return '(%s)&%r from %s' % (self.gcctype, self.region, self.loc)
@@ -944,6 +1069,8 @@ class DeallocatedMemory(AbstractValue):
     A 'poisoned' r-value: this memory has been deallocated, so the r-value
     is meaningless.
     """
+    __slots__ = ()
+
     def __str__(self):
         if self.loc:
             return 'memory deallocated at %s' % self.loc
@@ -953,11 +1080,18 @@ class DeallocatedMemory(AbstractValue):
     def extract_from_parent(self, region, gcctype, loc):
         return DeallocatedMemory(gcctype, self.loc)
 
+    def widen(self, prevvalue):
+        if isinstance(prevvalue, DeallocatedMemory):
+            return prevvalue
+        return self
+
 class UninitializedData(AbstractValue):
     """
     A 'poisoned' r-value: this memory has not yet been written to, so the
     r-value is meaningless.
     """
+    __slots__ = ()
+
     def __str__(self):
         if self.loc:
             return 'uninitialized data at %s' % self.loc
@@ -984,8 +1118,31 @@ class UninitializedData(AbstractValue):
     def extract_from_parent(self, region, gcctype, loc):
         return UninitializedData(gcctype, self.loc)
 
+    def widen(self, prevvalue):
+        if isinstance(prevvalue, UninitializedData):
+            return prevvalue
+        return self
+
 def make_null_ptr(gcctype, loc):
-    return ConcreteValue(gcctype, loc, 0)
+    return intern_value(ConcreteValue(gcctype, loc, 0))
+
+# Table of canonical instances of commonly-occurring values (NULL pointers,
+# small integers, the ob_refcnt of a borrowed reference), so that the many
+# states of a function share them rather than each holding a copy.
+#
+# Values can refer to the Regions of the function being analyzed, so this
+# is emptied after each function (see clear_interned_values).
+_interned_values = {}
+
+def intern_value(value):
+    """
+    Get the canonical instance of an AbstractValue that's equal to the
+    given one (which must not be modified afterwards)
+    """
+    return _interned_values.setdefault(value, value)
+
+def clear_interned_values():
+    _interned_values.clear()
 
 ############################################################################
 # Various kinds of predicted error:
@@ -1262,6 +1419,8 @@ class SplitValue(Exception):
         result = []
         for altvalue, desc in zip(self.altvalues, self.descriptions):
             log(' creating state for split where %s is %s', self.value, altvalue)
+            # (the value could be interned, so don't modify it in-place)
+            altvalue = altvalue.copy()
             altvalue.fromsplit = True
 
             newstate = state.copy()
@@ -1270,7 +1429,7 @@ class SplitValue(Exception):
                 # Replace instances of the value itself:
                 if newstate.value_for_region[r] is self.value:
                     log('  replacing value for region %s with %s', r, altvalue)
-                    newstate.value_for_region[r] = altvalue
+                    newstate.set_value_of_region(r, altvalue)
             result.append(Transition(state,
                                      newstate,
                                      desc))
@@ -1299,6 +1458,21 @@ class Facet(object):
         # Concrete subclasses should implement this.
         raise NotImplementedError
 
+    def is_equivalent(self, other):
+        """
+        Does this facet hold the same information as the other one (from
+        another State)?  Used when looking for the fixpoint of a loop.
+
+        The default implementation compares all of the slots.
+        """
+        for cls in self.__class__.__mro__:
+            for name in getattr(cls, '__slots__', ()):
+                if name == 'state':
+                    continue
+                if getattr(self, name, None) != getattr(other, name, None):
+                    return False
+        return True
+
 class State(object):
     """
     A Location with memory state, and zero or more additional "facets" of
@@ -1329,7 +1503,8 @@ class State(object):
 
     def __init__(self, stmtgraph, stmtnode, lastgccloc,
                  facets, region_for_var=None, value_for_region=None,
-                 return_rvalue=None, has_returned=False, not_returning=False):
+                 return_rvalue=None, has_returned=False, not_returning=False,
+                 refs_to_region=None, region_seq=None):
         check_isinstance(stmtgraph, StmtGraph)
         check_isinstance(stmtnode, StmtNode)
         check_isinstance(facets, dict)
@@ -1353,6 +1528,21 @@ class State(object):
         else:
             self.value_for_region = OrderedDict()
 
+        # Reverse index of the pointers within value_for_region: mapping
+        # from Region to a tuple of the Regions that point at it, in the
+        # order of value_for_region (see get_all_refs_for_region).
+        #
+        # Both this and region_seq are kept up-to-date by
+        # set_value_of_region and remove_region, so all changes to
+        # value_for_region must go through those methods:
+        if refs_to_region is not None:
+            check_isinstance(refs_to_region, dict)
+            check_isinstance(region_seq, dict)
+            self.refs_to_region = refs_to_region
+            self.region_seq = region_seq
+        else:
+            self.rebuild_refs_to_region()
+
         self.return_rvalue = return_rvalue
         self.has_returned = has_returned
         self.not_returning = not_returning
@@ -1417,7 +1607,10 @@ class State(object):
                       self.value_for_region.copy(),
                       self.return_rvalue,
                       self.has_returned,
-                      self.not_returning)
+                      self.not_returning,
+                      # (the tuples within are immutable, so can be shared):
+                      self.refs_to_region.copy(),
+                      self.region_seq.copy())
         # Make a copy of each facet into the new state:
         for key in self.facets:
             facetcls = self.facets[key]
@@ -1426,15 +1619,117 @@ class State(object):
             setattr(s_new, key, f_new)
         return s_new
 
+    def widen(self, prevstate):
+        """
+        Called when going around a loop, with the State at the same point at
+        the previous iteration.
+
+        Returns None if this State holds nothing that prevstate didn't (the
+        loop has reached a fixpoint).  Otherwise returns a new State, in
+        which each value has been widened against its previous value (see
+        AbstractValue.widen).
+        """
+        check_isinstance(prevstate, State)
+        fixpoint = (dict(self.region_for_var) == dict(prevstate.region_for_var)
+                    and (len(self.value_for_region)
+                         == len(prevstate.value_for_region))
+                    and self.return_rvalue == prevstate.return_rvalue)
+        for key in self.facets:
+            if not getattr(self, key).is_equivalent(getattr(prevstate, key)):
+                fixpoint = False
+
+        widened_values = []
+        for region, value in self.value_for_region.items():
+            prevvalue = prevstate.value_for_region.get(region, None)
+            if prevvalue is None:
+                fixpoint = False
+                continue
+            widened = value.widen(prevvalue)
+            if widened is not prevvalue:
+                fixpoint = False
+            if widened is not value:
+                widened_values.append((region, widened))
+
+        if fixpoint:
+            return None
+        s_new = self.copy()
+        for region, widened in widened_values:
+            s_new.set_value_of_region(region, widened)
+        return s_new
+
     def verify(self):
         """
         Perform self-tests to ensure sanity of this State
         """
+        num_refs = 0
         for k in self.value_for_region:
             check_isinstance(k, Region)
-            if not isinstance(self.value_for_region[k], AbstractValue):
+            v = self.value_for_region[k]
+            if not isinstance(v, AbstractValue):
                 raise TypeError('value for region %r is not an AbstractValue: %r'
-                                % (k, self.value_for_region[k]))
+                                % (k, v))
+            if isinstance(v, PointerToRegion):
+                if k not in self.refs_to_region.get(v.region, ()):
+                    raise ValueError('pointer from region %r to region %r'
+                                     ' missing from refs_to_region'
+                                     % (k, v.region))
+                num_refs += 1
+        if num_refs != sum([len(srcs)
+                            for srcs in self.refs_to_region.values()]):
+            raise ValueError('refs_to_region is out of date')
+
+    def set_value_of_region(self, region, value):
+        """
+        Set the value of the given Region, keeping the reverse index of
+        pointers up-to-date
+        """
+        oldvalue = self.value_for_region.get(region, None)
+        if oldvalue is None:
+            self.region_seq[region] = next(_region_seqs)
+        elif isinstance(oldvalue, PointerToRegion):
+            if (isinstance(value, PointerToRegion)
+                and value.region is oldvalue.region):
+                self.value_for_region[region] = value
+                return
+            self._remove_ref(oldvalue.region, region)
+        self.value_for_region[region] = value
+        if isinstance(value, PointerToRegion):
+            self._add_ref(value.region, region)
+
+    def remove_region(self, region):
+        """
+        Forget the value of the given Region
+        """
+        oldvalue = self.value_for_region.pop(region)
+        del self.region_seq[region]
+        if isinstance(oldvalue, PointerToRegion):
+            self._remove_ref(oldvalue.region, region)
+
+    def rebuild_refs_to_region(self):
+        """
+        Regenerate refs_to_region and region_seq from value_for_region
+        """
+        self.refs_to_region = {}
+        self.region_seq = {}
+        for region, value in self.value_for_region.items():
+            self.region_seq[region] = next(_region_seqs)
+            if isinstance(value, PointerToRegion):
+                self._add_ref(value.region, region)
+
+    def _add_ref(self, dst_region, src_region):
+        srcs = self.refs_to_region.get(dst_region, ()) + (src_region, )
+        if len(srcs) > 1:
+            # (src_region could have been in value_for_region for a while)
+            srcs = tuple(sorted(srcs, key=self.region_seq.__getitem__))
+        self.refs_to_region[dst_region] = srcs
+
+    def _remove_ref(self, dst_region, src_region):
+        srcs = tuple([r for r in self.refs_to_region[dst_region]
+                      if r is not src_region])
+        if srcs:
+            self.refs_to_region[dst_region] = srcs
+        else:
+            del self.refs_to_region[dst_region]
 
     def eval_lvalue(self, expr, loc):
         """
@@ -1570,7 +1865,7 @@ class State(object):
         log('value: %s %r', value, value)
         check_isinstance(value, AbstractValue)
         check_isinstance(dest_region, Region)
-        self.value_for_region[dest_region] = value
+        self.set_value_of_region(dest_region, value)
 
     def var_region(self, var):
         check_isinstance(var, (gcc.VarDecl, gcc.ParmDecl, gcc.ResultDecl, gcc.FunctionDecl))
@@ -1586,7 +1881,7 @@ class State(object):
             if str(var.type) == 'struct PyObject':
                 from libcpychecker.refcounts import RefcountValue
                 ob_refcnt = self.make_field_region(region, 'ob_refcnt') # FIXME: this should be a memref and fieldref
-                self.value_for_region[ob_refcnt] = RefcountValue.borrowed_ref(None, region)
+                self.set_value_of_region(ob_refcnt, RefcountValue.borrowed_ref(None, region))
         return self.region_for_var[var]
 
     def element_region(self, ar, loc):
@@ -1611,10 +1906,11 @@ class State(object):
         # Cope with treating pointers as arrays.
         # The constant appears to be in bytes, rather than as units of the type
         log('pointer_add_region')
-        assert stmt.exprcode == gcc.PointerPlusExpr
-        rhs = stmt.rhs
-        a = self.eval_rvalue(rhs[0], stmt.loc)
-        b = self.eval_rvalue(rhs[1], stmt.loc)
+        d = stmt.decoded
+        assert d.exprcode == gcc.PointerPlusExpr
+        rhs = d.rhs
+        a = self.eval_rvalue(rhs[0], d.loc)
+        b = self.eval_rvalue(rhs[1], d.loc)
         log('a: %r', a)
         log('b: %r', b)
         if isinstance(a, PointerToRegion) and isinstance(b, ConcreteValue):
@@ -1637,7 +1933,7 @@ class State(object):
             return self._array_region(parent, index)
         else:
             raise NotImplementedError("Don't know how to cope with pointer addition of\n  %r\nand\n  %rat %s"
-                                      % (a, b, stmt.loc))
+                                      % (a, b, d.loc))
 
     def _array_region(self, parent, index):
         # Used by element_region, and pointer_add_region
@@ -1701,7 +1997,7 @@ class State(object):
             if isinstance(region, RegionForGlobal):
                 newval = UnknownValue.make(region.vardecl.type, region.vardecl.location)
                 log('setting up %s for %s', newval, region.vardecl)
-                self.value_for_region[region] = newval
+                self.set_value_of_region(region, newval)
                 return newval
 
             # OK: no value known:
@@ -1844,13 +2140,13 @@ class State(object):
             v_field = UnknownValue.make(gcctype, stmt.loc)
             r_field = self.make_field_region(region,
                                              fieldname)
-            self.value_for_region[r_field] = v_field
+            self.set_value_of_region(r_field, v_field)
 
         return v_field
 
     def set_field_by_name(self, r_struct, fieldname, v_field):
         r_field = self.make_field_region(r_struct, fieldname)
-        self.value_for_region[r_field] = v_field
+        self.set_value_of_region(r_field, v_field)
 
     def dereference(self, expr, v_ptr, loc):
         check_isinstance(v_ptr, AbstractValue)
@@ -1866,7 +2162,7 @@ class State(object):
                 gcctype = v_ptr.gcctype.dereference
             else:
                 gcctype = None
-            self.value_for_region[v_ptr.region] = UnknownValue.make(gcctype, loc)
+            self.set_value_of_region(v_ptr.region, UnknownValue.make(gcctype, loc))
         return self.value_for_region[v_ptr.region]
 
     def init_for_function(self, fun):
@@ -1887,9 +2183,9 @@ class State(object):
                 # Make a non-NULL ptr:
                 other = Region('region-for-arg-%r' % parm, None)
                 self.region_for_var[other] = other
-                self.value_for_region[region] = PointerToRegion(parm.type, parm.location, other)
+                self.set_value_of_region(region, PointerToRegion(parm.type, parm.location, other))
             else:
-                self.value_for_region[region] = UnknownValue.make(parm.type, parm.location)
+                self.set_value_of_region(region, UnknownValue.make(parm.type, parm.location))
         for local in fun.local_decls:
             if local.static:
                 # Statically-allocated locals are zero-initialized before the
@@ -1904,14 +2200,14 @@ class State(object):
                 region = RegionForLocal(local, stack)
                 v_local = UninitializedData(local.type, fun.start)
             self.region_for_var[local] = region
-            self.value_for_region[region] = v_local
+            self.set_value_of_region(region, v_local)
 
         # Region for the gcc.ResultDecl, if any:
         if fun.decl.result:
             result = fun.decl.result
             region = RegionForLocal(result, stack)
             self.region_for_var[result] = region
-            self.value_for_region[region] = UninitializedData(result.type, fun.start)
+            self.set_value_of_region(region, UninitializedData(result.type, fun.start))
         self.verify()
 
     def mktrans_assignment(self, lhs, rhs, desc):
@@ -2037,10 +2333,10 @@ class State(object):
         # Clear the value for any fields within the region:
         for k, v in region.fields.items():
             if v in self.value_for_region:
-                del self.value_for_region[v]
+                self.remove_region(v)
         # Set the default value for the whole region to be "DeallocatedMemory"
         self.region_for_var[region] = region
-        self.value_for_region[region] = DeallocatedMemory(None, stmt.loc)
+        self.set_value_of_region(region, DeallocatedMemory(None, stmt.loc))
 
     def get_transitions(self):
         # Return a list of Transition instances, based on input State
@@ -2097,10 +2393,11 @@ class State(object):
         """
         check_isinstance(v_return, AbstractValue)
         newstate = self.use_next_stmt_node()
-        if stmt.lhs:
-            newstate.assign(stmt.lhs,
+        d = stmt.decoded
+        if d.lhs:
+            newstate.assign(d.lhs,
                             v_return,
-                            stmt.loc)
+                            d.loc)
         return newstate
 
     def mkstate_concrete_return_of(self, stmt, value):
@@ -2110,10 +2407,11 @@ class State(object):
         """
         check_isinstance(value, numeric_types)
         newstate = self.use_next_stmt_node()
-        if stmt.lhs:
-            newstate.assign(stmt.lhs,
-                            ConcreteValue(stmt.lhs.type, stmt.loc, value),
-                            stmt.loc)
+        d = stmt.decoded
+        if d.lhs:
+            newstate.assign(d.lhs,
+                            ConcreteValue(d.lhs.type, d.loc, value),
+                            d.loc)
         return newstate
 
     def mktrans_nop(self, stmt, fnname):
@@ -2141,7 +2439,7 @@ class State(object):
         check_isinstance(stmt, gcc.GimpleCall)
         check_isinstance(state, State)
         check_isinstance(partialdesc, str)
-        fnname = stmt.fn.operand.name
+        fnname = stmt.decoded.fn.operand.name
         if has_siblings:
             desc = 'when %s() %s' % (fnname, partialdesc)
         else:
@@ -2170,27 +2468,34 @@ class State(object):
 
     def eval_stmt_args(self, stmt):
         check_isinstance(stmt, gcc.GimpleCall)
-        return [self.eval_rvalue(arg, stmt.loc)
-                for arg in stmt.args]
+        d = stmt.decoded
+        return [self.eval_rvalue(arg, d.loc)
+                for arg in d.args]
 
     def _get_transitions_for_GimpleCall(self, stmt):
-        log('stmt.lhs: %s %r', stmt.lhs, stmt.lhs)
-        log('stmt.fn: %s %r', stmt.fn, stmt.fn)
-        log('dir(stmt.fn): %s', dir(stmt.fn))
-        if hasattr(stmt.fn, 'operand'):
-            log('stmt.fn.operand: %s', stmt.fn.operand)
-        returntype = stmt.fn.type.dereference.type
+        # This is called for every call statement along every trace, so
+        # fetch all of the operands at once, and avoid building the
+        # (expensive) debug strings unless they're going to be used:
+        d = stmt.decoded
+        fn = d.fn
+        if logging_enabled:
+            log('stmt.lhs: %s %r', d.lhs, d.lhs)
+            log('stmt.fn: %s %r', fn, fn)
+            log('dir(stmt.fn): %s', dir(fn))
+            if hasattr(fn, 'operand'):
+                log('stmt.fn.operand: %s', fn.operand)
+        returntype = fn.type.dereference.type
         log('returntype: %s', returntype)
 
-        if stmt.noreturn:
+        if d.noreturn:
             # The function being called does not return e.g. "exit(0);"
             # Transition to a special noreturn state:
             return [self.mktrans_not_returning('not returning from %s'
-                                               % stmt.fn)]
+                                               % fn)]
 
-        if isinstance(stmt.fn, (gcc.VarDecl, gcc.ParmDecl, gcc.SsaName)):
+        if isinstance(fn, (gcc.VarDecl, gcc.ParmDecl, gcc.SsaName)):
             # Calling through a function pointer:
-            val = self.eval_rvalue(stmt.fn, stmt.loc)
+            val = self.eval_rvalue(fn, d.loc)
             log('val: %s',  val)
             check_isinstance(val, AbstractValue)
             return val.get_transitions_for_function_call(self, stmt)
@@ -2201,18 +2506,20 @@ class State(object):
         # Check for uninitialized and deallocated data:
         for i, arg in enumerate(args):
             if isinstance(arg, UninitializedData):
-                raise UsageOfUninitializedData(self, stmt.args[i],
+                raise UsageOfUninitializedData(self, d.args[i],
                                                arg,
-                                               'passing uninitialized data (%s) as argument %i to function' % (stmt.args[i], i + 1))
+                                               'passing uninitialized data (%s) as argument %i to function' % (d.args[i], i + 1))
             if isinstance(arg, PointerToRegion):
                 rvalue = self.value_for_region.get(arg.region, None)
                 if isinstance(rvalue, DeallocatedMemory):
                     raise PassingPointerToDeallocatedMemory(i, 'function', stmt, rvalue)
 
-        if isinstance(stmt.fn.operand, gcc.FunctionDecl):
-            log('dir(stmt.fn.operand): %s', dir(stmt.fn.operand))
-            log('stmt.fn.operand.name: %r', stmt.fn.operand.name)
-            fnname = stmt.fn.operand.name
+        fndecl = fn.operand
+        if isinstance(fndecl, gcc.FunctionDecl):
+            if logging_enabled:
+                log('dir(stmt.fn.operand): %s', dir(fndecl))
+                log('stmt.fn.operand.name: %r', fndecl.name)
+            fnname = fndecl.name
 
             # Hand off to impl_* methods of facets, where these methods exist
             # In each case, the method should have the form:
@@ -2229,6 +2536,9 @@ class State(object):
                     meth = getattr(facet, 'impl_%s' % fnname)
 
                     # Call the facet's method:
+                    if profiling.active_profile:
+                        return profiling.active_profile.call_handler(
+                            methname, meth, stmt, args)
                     return meth(stmt, *args)
 
             #from libcpychecker.c_stdio import c_stdio_functions, handle_c_stdio_function
@@ -2245,7 +2555,7 @@ class State(object):
 
             # Unknown function returning (PyObject*):
             from libcpychecker.refcounts import type_is_pyobjptr_subclass
-            if type_is_pyobjptr_subclass(stmt.fn.operand.type.type):
+            if type_is_pyobjptr_subclass(fndecl.type.type):
                 log('Invocation of unknown function returning PyObject * (or subclass): %r' % fnname)
 
                 fnmeta = FnMeta(name=fnname)
@@ -2261,6 +2571,16 @@ class State(object):
                         self.cpython.make_transitions_for_borrowed_ref_or_fail(stmt,
                                                                                fnmeta),
                         stmt)
+
+                # If we've already analyzed the function (from the IPA pass),
+                # use what we learned about it:
+                from libcpychecker.summaries import get_summary
+                summary = get_summary(fndecl)
+                if summary:
+                    return self.apply_fncall_side_effects(
+                        self.cpython.make_transitions_for_summarized_fncall(
+                            stmt, fnmeta, summary),
+                        stmt)
                 return self.apply_fncall_side_effects(
                     self.cpython.make_transitions_for_new_ref_or_fail(stmt,
                                                                       fnmeta,
@@ -2273,39 +2593,49 @@ class State(object):
                 # The return value of:
                 #    __builtin_expect(long exp, long c)
                 # is "exp" (the 0-th argument):
-                return [self.mktrans_assignment(stmt.lhs, stmt.args[0], None)]
+                return [self.mktrans_assignment(d.lhs, d.args[0], None)]
 
             # Unknown function of other type:
             log('Invocation of unknown function: %r', fnname)
             return self.apply_fncall_side_effects(
-                [self.mktrans_assignment(stmt.lhs,
-                                         UnknownValue.make(returntype, stmt.loc),
+                [self.mktrans_assignment(d.lhs,
+                                         UnknownValue.make(returntype, d.loc),
                                          None)],
                 stmt)
 
-        log('stmt.args: %s %r', stmt.args, stmt.args)
-        for i, arg in enumerate(stmt.args):
+        log('stmt.args: %s %r', d.args, d.args)
+        for i, arg in enumerate(d.args):
             log('args[%i]: %s %r', i, arg, arg)
 
-    def get_function_name(self, stmt):
+    def get_function_decl(self, stmt):
         """
-        Try to get the function name for a gcc.GimpleCall statement as a
-        string, or None if we're unable to determine it.
+        Try to get the gcc.FunctionDecl being called by a gcc.GimpleCall
+        statement, or None if we're unable to determine it.
 
         For a simple function invocation this is easy, but if we're
         calling through a function pointer we may or may not know.
         """
         check_isinstance(stmt, gcc.GimpleCall)
 
-        v_fn = self.eval_rvalue(stmt.fn, stmt.loc)
+        d = stmt.decoded
+        v_fn = self.eval_rvalue(d.fn, d.loc)
         if isinstance(v_fn, PointerToRegion):
             if isinstance(v_fn.region, RegionForGlobal):
                 if isinstance(v_fn.region.vardecl, gcc.FunctionDecl):
-                    return v_fn.region.vardecl.name
+                    return v_fn.region.vardecl
 
         # Unable to determine it:
         return None
 
+    def get_function_name(self, stmt):
+        """
+        Try to get the function name for a gcc.GimpleCall statement as a
+        string, or None if we're unable to determine it.
+        """
+        fndecl = self.get_function_decl(stmt)
+        if fndecl:
+            return fndecl.name
+
     def apply_fncall_side_effects(self, transitions, stmt):
         """
         Given a list of Transition instances for a call to a function with
@@ -2318,9 +2648,11 @@ class State(object):
         check_isinstance(transitions, list)
         check_isinstance(stmt, gcc.GimpleCall)
 
+        d = stmt.decoded
         args = self.eval_stmt_args(stmt)
 
-        fnname = self.get_function_name(stmt)
+        fndecl = self.get_function_decl(stmt)
+        fnname = fndecl.name if fndecl else None
 
         # cpython: handle functions marked as stealing references to their
         # arguments:
@@ -2328,10 +2660,24 @@ class State(object):
         if fnname in stolen_refs_by_fnname:
             for t_iter in transitions:
                 check_isinstance(t_iter, Transition)
-                for argindex in stolen_refs_by_fnname[stmt.fn.operand.name]:
+                for argindex in stolen_refs_by_fnname[fnname]:
                     v_arg = args[argindex-1]
                     if isinstance(v_arg, PointerToRegion):
-                        t_iter.dest.cpython.steal_reference(v_arg, stmt.loc)
+                        t_iter.dest.cpython.steal_reference(v_arg, d.loc)
+
+        elif fnname is not None:
+            # cpython: handle functions that we've summarized as stealing
+            # references to their arguments:
+            from libcpychecker.summaries import get_summary
+            summary = get_summary(fndecl)
+            if summary:
+                for t_iter in transitions:
+                    check_isinstance(t_iter, Transition)
+                    for argindex in summary.stolen_args:
+                        v_arg = args[argindex-1]
+                        if isinstance(v_arg, PointerToRegion):
+                            t_iter.dest.cpython.steal_reference(v_arg,
+                                                                d.loc)
 
         # cpython: handle functions that have been marked as setting the
         # exception state:
@@ -2341,7 +2687,7 @@ class State(object):
                 # Mark the global exception state (with an arbitrary
                 # error):
                 t_iter.dest.cpython.set_exception('PyExc_MemoryError',
-                                                  stmt.loc)
+                                                  d.loc)
 
         # cpython: handle functions that have been marked as setting the
         # exception state when they return a negative value:
@@ -2352,8 +2698,8 @@ class State(object):
                 check_isinstance(t_iter, Transition)
                 check_isinstance(t_iter.src, State)
                 check_isinstance(stmt, gcc.GimpleCall)
-                if stmt.lhs:
-                    v_returnval = t_iter.dest.eval_rvalue(stmt.lhs, stmt.loc)
+                if d.lhs:
+                    v_returnval = t_iter.dest.eval_rvalue(d.lhs, d.loc)
                     # This could raise a SplitValue exception:
                     # the split value affects State instances that are already
                     # within the trace, whereas we're splitting on a new value
@@ -2369,7 +2715,7 @@ class State(object):
                         # Mark the global exception state (with an arbitrary
                         # error):
                         t_iter.dest.cpython.set_exception('PyExc_MemoryError',
-                                                          stmt.loc)
+                                                          d.loc)
 
             transitions = process_splittable_transitions(transitions,
                                                          handle_negative_return)
@@ -2378,8 +2724,8 @@ class State(object):
             check_isinstance(t_iter, Transition)
             for v_arg in args:
                 if isinstance(v_arg, PointerToRegion):
-                    v_newval = UnknownValue.make(v_arg.gcctype, stmt.loc)
-                    t_iter.dest.value_for_region[v_arg.region] = v_newval
+                    v_newval = UnknownValue.make(v_arg.gcctype, d.loc)
+                    t_iter.dest.set_value_of_region(v_arg.region, v_newval)
         return transitions
 
     def _get_transitions_for_GimpleCond(self, stmt):
@@ -2487,18 +2833,20 @@ class State(object):
         return UnknownValue(stmt.lhs.type, stmt.loc)
 
     def eval_binop_args(self, stmt):
-        rhs = stmt.rhs
-        a = self.eval_rvalue(rhs[0], stmt.loc)
-        b = self.eval_rvalue(rhs[1], stmt.loc)
+        d = stmt.decoded
+        rhs = d.rhs
+        a = self.eval_rvalue(rhs[0], d.loc)
+        b = self.eval_rvalue(rhs[1], d.loc)
         log('a: %r', a)
         log('b: %r', b)
         return a, b
 
     def eval_rhs(self, stmt):
-        log('eval_rhs(%s): %s', stmt, stmt.rhs)
-        rhs = stmt.rhs
+        d = stmt.decoded
+        log('eval_rhs(%s): %s', stmt, d.rhs)
+        rhs = d.rhs
         # Handle arithmetic and boolean expressions:
-        if stmt.exprcode in (gcc.PlusExpr, gcc.MinusExpr,  gcc.MultExpr, gcc.TruncDivExpr,
+        if d.exprcode in (gcc.PlusExpr, gcc.MinusExpr,  gcc.MultExpr, gcc.TruncDivExpr,
                              gcc.TruncModExpr,
                              gcc.RdivExpr, gcc.ExactDivExpr,
                              gcc.MaxExpr, gcc.MinExpr,
@@ -2509,74 +2857,75 @@ class State(object):
                              ):
             a, b = self.eval_binop_args(stmt)
             if isinstance(a, UninitializedData):
-                raise UsageOfUninitializedData(self, stmt.rhs[0], a,
+                raise UsageOfUninitializedData(self, d.rhs[0], a,
                                                'usage of uninitialized data (%s) on left-hand side of %s'
-                                               % (stmt.rhs[0], stmt.exprcode.get_symbol()))
+                                               % (d.rhs[0], d.exprcode.get_symbol()))
             if isinstance(b, UninitializedData):
-                raise UsageOfUninitializedData(self, stmt.rhs[1], b,
+                raise UsageOfUninitializedData(self, d.rhs[1], b,
                                                'usage of uninitialized data (%s) on right-hand side of %s'
-                                               % (stmt.rhs[0], stmt.exprcode.get_symbol()))
+                                               % (d.rhs[0], d.exprcode.get_symbol()))
             try:
-                c = a.eval_binop(stmt.exprcode, b, rhs[1], stmt.lhs.type, stmt.loc)
+                c = a.eval_binop(d.exprcode, b, rhs[1], d.lhs.type, d.loc)
                 check_isinstance(c, AbstractValue)
                 return c
             except NotImplementedError:
-                return UnknownValue.make(stmt.lhs.type, stmt.loc)
-        elif stmt.exprcode == gcc.ComponentRef:
-            return self.eval_rvalue(rhs[0], stmt.loc)
-        elif stmt.exprcode == gcc.VarDecl:
-            return self.eval_rvalue(rhs[0], stmt.loc)
-        elif stmt.exprcode == gcc.ParmDecl:
-            return self.eval_rvalue(rhs[0], stmt.loc)
-        elif stmt.exprcode == gcc.IntegerCst:
-            return self.eval_rvalue(rhs[0], stmt.loc)
-        elif stmt.exprcode == gcc.RealCst:
-            return self.eval_rvalue(rhs[0], stmt.loc)
-        elif stmt.exprcode == gcc.StringCst:
-            return self.eval_rvalue(rhs[0], stmt.loc)
-        elif stmt.exprcode == gcc.AddrExpr:
-            return self.eval_rvalue(rhs[0], stmt.loc)
-        elif stmt.exprcode == gcc.NopExpr:
-            return self.eval_rvalue(rhs[0], stmt.loc)
-        elif stmt.exprcode == gcc.ArrayRef:
-            return self.eval_rvalue(rhs[0], stmt.loc)
-        elif stmt.exprcode == gcc.MemRef:
-            return self.eval_rvalue(rhs[0], stmt.loc)
-        elif stmt.exprcode == gcc.PointerPlusExpr:
+                return UnknownValue.make(d.lhs.type, d.loc)
+        elif d.exprcode == gcc.ComponentRef:
+            return self.eval_rvalue(rhs[0], d.loc)
+        elif d.exprcode == gcc.VarDecl:
+            return self.eval_rvalue(rhs[0], d.loc)
+        elif d.exprcode == gcc.ParmDecl:
+            return self.eval_rvalue(rhs[0], d.loc)
+        elif d.exprcode == gcc.IntegerCst:
+            return self.eval_rvalue(rhs[0], d.loc)
+        elif d.exprcode == gcc.RealCst:
+            return self.eval_rvalue(rhs[0], d.loc)
+        elif d.exprcode == gcc.StringCst:
+            return self.eval_rvalue(rhs[0], d.loc)
+        elif d.exprcode == gcc.AddrExpr:
+            return self.eval_rvalue(rhs[0], d.loc)
+        elif d.exprcode == gcc.NopExpr:
+            return self.eval_rvalue(rhs[0], d.loc)
+        elif d.exprcode == gcc.ArrayRef:
+            return self.eval_rvalue(rhs[0], d.loc)
+        elif d.exprcode == gcc.MemRef:
+            return self.eval_rvalue(rhs[0], d.loc)
+        elif d.exprcode == gcc.PointerPlusExpr:
             try:
                 region = self.pointer_plus_region(stmt)
-                return PointerToRegion(stmt.lhs.type, stmt.loc, region)
+                return PointerToRegion(d.lhs.type, d.loc, region)
             except NotImplementedError:
-                return UnknownValue.make(stmt.lhs.type, stmt.loc)
-        elif stmt.exprcode in (gcc.EqExpr, gcc.NeExpr, gcc.LtExpr,
+                return UnknownValue.make(d.lhs.type, d.loc)
+        elif d.exprcode in (gcc.EqExpr, gcc.NeExpr, gcc.LtExpr,
                                gcc.LeExpr, gcc.GeExpr, gcc.GtExpr):
             # Comparisons
-            result = self.eval_condition(stmt, rhs[0], stmt.exprcode, rhs[1])
+            result = self.eval_condition(stmt, rhs[0], d.exprcode, rhs[1])
             if result is not None:
-                return ConcreteValue(stmt.lhs.type, stmt.loc,
+                return ConcreteValue(d.lhs.type, d.loc,
                                      1 if result else 0)
             else:
-                return UnknownValue.make(stmt.lhs.type, stmt.loc)
+                return UnknownValue.make(d.lhs.type, d.loc)
         # Unary expressions:
-        elif stmt.exprcode in (gcc.AbsExpr, gcc.BitNotExpr, gcc.ConvertExpr,
+        elif d.exprcode in (gcc.AbsExpr, gcc.BitNotExpr, gcc.ConvertExpr,
                                gcc.NegateExpr, gcc.FixTruncExpr, gcc.FloatExpr):
-            v_rhs = self.eval_rvalue(stmt.rhs[0], stmt.loc)
-            return v_rhs.eval_unary_op(stmt.exprcode, stmt.lhs.type, stmt.loc)
-        elif stmt.exprcode == gcc.BitFieldRef:
-            return self.eval_rvalue(rhs[0], stmt.loc)
-        elif stmt.exprcode == gcc.Constructor:
+            v_rhs = self.eval_rvalue(d.rhs[0], d.loc)
+            return v_rhs.eval_unary_op(d.exprcode, d.lhs.type, d.loc)
+        elif d.exprcode == gcc.BitFieldRef:
+            return self.eval_rvalue(rhs[0], d.loc)
+        elif d.exprcode == gcc.Constructor:
             # Default value for whole array becomes 0:
-            return ConcreteValue(stmt.lhs.type,
-                                 stmt.loc, 0)
+            return ConcreteValue(d.lhs.type,
+                                 d.loc, 0)
         else:
             raise NotImplementedError("Don't know how to cope with exprcode: %r (%s) at %s"
-                                      % (stmt.exprcode, stmt.exprcode, stmt.loc))
+                                      % (d.exprcode, d.exprcode, d.loc))
 
     def _get_transitions_for_GimpleAssign(self, stmt):
-        log('stmt.lhs: %r %s', stmt.lhs, stmt.lhs)
-        log('stmt.rhs: %r %s', stmt.rhs, stmt.rhs)
+        d = stmt.decoded
+        log('stmt.lhs: %r %s', d.lhs, d.lhs)
+        log('stmt.rhs: %r %s', d.rhs, d.rhs)
         log('stmt: %r %s', stmt, stmt)
-        log('stmt.exprcode: %r', stmt.exprcode)
+        log('stmt.exprcode: %r', d.exprcode)
 
         value = self.eval_rhs(stmt)
         log('value from eval_rhs: %r', value)
@@ -2586,7 +2935,7 @@ class State(object):
             raise ReadFromDeallocatedMemory(stmt, value)
 
         nextstate = self.use_next_stmt_node()
-        return [self.mktrans_assignment(stmt.lhs,
+        return [self.mktrans_assignment(d.lhs,
                                         value,
                                         None)]
 
@@ -2662,17 +3011,20 @@ class State(object):
 
     def get_all_refs_for_region(self, dst_region):
         # Locate all regions containing pointers that point at the given region
+        # (using the reverse index, rather than scanning every value)
         check_isinstance(dst_region, Region)
-        result = []
-        for src_region in self.value_for_region:
-            v = self.value_for_region[src_region]
-            if isinstance(v, PointerToRegion):
-                if v.region == dst_region:
-                    result.append(src_region)
-        return result
+        return list(self.refs_to_region.get(dst_region, ()))
 
 region_id = 0
 
+# Whether to call State.verify on each new State during the traversal;
+# cleared in "fast" mode (see libcpychecker.set_fast_mode):
+verify_states = True
+
+# Source of State.region_seq values, giving the order in which regions were
+# added to value_for_region:
+_region_seqs = itertools.count()
+
 class Transition(object):
     __slots__ = ('src', # State
                  'dest', # State
@@ -2697,7 +3049,12 @@ class Transition(object):
         self.dest.log(logger)
 
 class Trace(object):
-    __slots__ = ('states', 'transitions', 'err', 'paths_taken')
+    __slots__ = ('states', 'transitions', 'err', 'paths_taken',
+                 'looped_from', 'num_widenings')
+
+    # When widening loops, the number of times to try to find a fixpoint
+    # for each loop before giving up on the path:
+    MAX_WIDENINGS = 3
 
     """A sequence of States and Transitions"""
     def __init__(self):
@@ -2705,16 +3062,31 @@ class Trace(object):
         self.transitions = []
         self.err = None
 
-        # A list of (src gcc.StmtNode, dest gcc.StmtNode) pairs
-        self.paths_taken = []
+        # A dict from (src gcc.BasicBlock, dest gcc.BasicBlock) pairs, for
+        # the edges between blocks that have been followed, to the index
+        # within self.states of the state after the most recent traversal
+        self.paths_taken = {}
+
+        # If the tail transition follows an edge that had been followed
+        # before, the index of the state after the previous traversal
+        # (otherwise None):
+        self.looped_from = None
+
+        # A dict from edge to the number of times that the state following
+        # it has been widened:
+        self.num_widenings = {}
 
     def add(self, transition):
         check_isinstance(transition, Transition)
         self.states.append(transition.dest)
         self.transitions.append(transition)
-        if transition.src.stmtnode.bb != transition.dest.stmtnode.bb:
-            self.paths_taken.append( (transition.src.stmtnode.bb,
-                                      transition.dest.stmtnode.bb) )
+        self.looped_from = None
+        src_bb = transition.src.stmtnode.bb
+        dest_bb = transition.dest.stmtnode.bb
+        if src_bb != dest_bb:
+            edge = (src_bb, dest_bb)
+            self.looped_from = self.paths_taken.get(edge, None)
+            self.paths_taken[edge] = len(self.states) - 1
         return self
 
     def add_error(self, err):
@@ -2725,7 +3097,9 @@ class Trace(object):
         t.states = self.states[:]
         t.transitions = self.transitions[:]
         t.err = self.err # FIXME: should this be a copy?
-        t.paths_taken = self.paths_taken[:]
+        t.paths_taken = self.paths_taken.copy()
+        t.looped_from = self.looped_from
+        t.num_widenings = self.num_widenings.copy()
         return t
 
     def log(self, logger, name):
@@ -2766,11 +3140,34 @@ class Trace(object):
                        'src, loc: %s' % ((endtransition.src.loc, endtransition.dest.loc),))
 
         # Is this a path we've followed before?
-        src_bb = endtransition.src.stmtnode.bb
-        dest_bb = endtransition.dest.stmtnode.bb
-        if src_bb != dest_bb:
-            if (src_bb, dest_bb) in self.paths_taken[0:-1]:
-                return True
+        return self.looped_from is not None
+
+    def widen_loop(self):
+        """
+        Called when has_looped() is true, to summarize the iteration of the
+        loop that has just completed, rather than discarding the trace.
+
+        Widens the tail state against the state at the previous traversal of
+        the same edge, replacing it within this trace, and returns True if
+        the trace should continue from it.
+
+        Returns False if the loop has reached a fixpoint (the iteration
+        added nothing new), or if we've given up trying to find one.
+        """
+        endtransition = self.transitions[-1]
+        edge = (endtransition.src.stmtnode.bb, endtransition.dest.stmtnode.bb)
+        count = self.num_widenings.get(edge, 0)
+        if count >= self.MAX_WIDENINGS:
+            return False
+        prevstate = self.states[self.looped_from]
+        newstate = self.states[-1].widen(prevstate)
+        if newstate is None:
+            return False
+        self.num_widenings[edge] = count + 1
+        self.states[-1] = newstate
+        self.transitions[-1] = Transition(endtransition.src, newstate,
+                                          endtransition.desc)
+        return True
 
     def get_all_var_region_pairs(self):
         """
@@ -2914,14 +3311,60 @@ class TooComplicated(Exception):
     def __init__(self, complete_traces):
         check_isinstance(complete_traces, list)
         self.complete_traces = complete_traces
+        # The position (see generate_traces) of the transition at which the
+        # limits were exceeded, if known:
+        self.position = None
+
+def get_rss_kb():
+    """
+    Get the current resident set size of this process, in kilobytes
+    """
+    try:
+        with open('/proc/self/statm') as f:
+            pages = int(f.read().split()[1])
+        return pages * (os.sysconf('SC_PAGE_SIZE') // 1024)
+    except (IOError, OSError, ValueError, IndexError):
+        # Not Linux; use the peak RSS instead (in kilobytes on Linux and
+        # the BSDs, but bytes on OS X):
+        import resource
+        usage = resource.getrusage(resource.RUSAGE_SELF)
+        if sys.platform == 'darwin':
+            return usage.ru_maxrss // 1024
+        return usage.ru_maxrss
 
 class Limits:
     """
     Resource limits, to avoid an analysis going out of control
+
+    maxtrans: the maximum number of transitions to consider
+
+    maxtime: if not None, the maximum wall time (in seconds) to spend on the
+    function
+
+    maxmem: if not None, the maximum amount (in kilobytes) by which the
+    process may grow whilst analyzing the function
+
+    deadline: if not None, a time.time() value after which to stop, for
+    budgets that span more than one function
+
+    When a limit is exceeded, "exceeded" is set to one of 'transitions',
+    'time', 'memory' or 'deadline', and TooComplicated is raised.
     """
-    def __init__(self, maxtrans):
+    # The time and memory are only checked every this many transitions, to
+    # keep the overhead low:
+    CHECK_INTERVAL = 16
+
+    def __init__(self, maxtrans, maxtime=None, maxmem=None, deadline=None):
         self.maxtrans = maxtrans
+        self.maxtime = maxtime
+        self.maxmem = maxmem
+        self.deadline = deadline
         self.trans_seen = 0
+        self.exceeded = None
+
+        self.start_time = time.time()
+        self.start_rss = get_rss_kb()
+        self.peak_rss_growth = 0
 
     def on_transition(self, transition, result):
         """
@@ -2932,23 +3375,63 @@ class Limits:
                   % (transition.src.stmtnode, transition.dest.stmtnode))
         self.trans_seen += 1
         if self.trans_seen > self.maxtrans:
+            self.exceeded = 'transitions'
             raise TooComplicated(result)
 
-def iter_traces(stmtgraph, facets, prefix=None, limits=None, depth=0):
+        if self.trans_seen % self.CHECK_INTERVAL == 0:
+            now = time.time()
+            if self.maxtime is not None:
+                if now - self.start_time > self.maxtime:
+                    self.exceeded = 'time'
+                    raise TooComplicated(result)
+            if self.deadline is not None:
+                if now > self.deadline:
+                    self.exceeded = 'deadline'
+                    raise TooComplicated(result)
+            if self.maxmem is not None:
+                growth = get_rss_kb() - self.start_rss
+                self.peak_rss_growth = max(self.peak_rss_growth, growth)
+                if growth > self.maxmem:
+                    self.exceeded = 'memory'
+                    raise TooComplicated(result)
+
+    def get_elapsed_time(self):
+        return time.time() - self.start_time
+
+    def get_stats(self):
+        """
+        Get a dict describing the resources that were used, for recording
+        """
+        self.peak_rss_growth = max(self.peak_rss_growth,
+                                   get_rss_kb() - self.start_rss)
+        return OrderedDict([('transitions', self.trans_seen),
+                            ('seconds', round(self.get_elapsed_time(), 3)),
+                            ('rss_growth_kb', self.peak_rss_growth),
+                            ('exceeded', self.exceeded)])
+
+def generate_traces(stmtgraph, facets, prefix=None, limits=None, depth=0,
+                    widening=False, position=()):
     """
-    Traverse the tree of traces of program state, returning a list
-    of Trace instances.
+    Traverse the tree of traces of program state, yielding a
+    (position, Trace) pair as each trace is completed, so that the caller
+    can check each trace and then discard it, rather than having every
+    trace through the function alive at once.
 
-    For now, don't include any traces that contain loops, as a primitive
-    way of ensuring termination of the analysis
+    "position" is a tuple giving the index of the transition taken at each
+    level of the tree: the traces are yielded in order of position.
+
+    By default, don't include any traces that contain loops, as a primitive
+    way of ensuring termination of the analysis.  If "widening" is set,
+    loops are instead followed until the states reach a fixpoint (see
+    Trace.widen_loop).
 
     This is recursive, setting up a depth-first traversal of the state tree.
-    If it's interrupted by a TooComplicated exception, we should at least
-    capture an incomplete list of paths down to some of the bottoms of the
-    tree.
+    If it's interrupted by a TooComplicated exception, the traces yielded
+    so far are all complete; the exception's "position" attribute gives the
+    position of the transition at which the limits were exceeded.
     """
     fun = stmtgraph.fun
-    log('iter_traces(%r, %r, %r)', fun, facets, prefix)
+    log('generate_traces(%r, %r, %r)', fun, facets, prefix)
     if prefix is None:
         prefix = Trace()
         curstate = State(stmtgraph,
@@ -2969,21 +3452,27 @@ def iter_traces(stmtgraph, facets, prefix=None, limits=None, depth=0):
 
         if curstate.has_returned:
             # This state has returned a value (and hence terminated):
-            return [prefix]
+            yield (position, prefix)
+            return
 
         if curstate.not_returning:
             # This state has called "exit" or similar, and thus this
             # trace should terminate:
-            return [prefix]
+            yield (position, prefix)
+            return
 
         # Stop interpreting when you see a loop, to ensure termination:
         if prefix.has_looped():
-            log('loop detected; stopping iteration')
-            if 0:
-                gcc.inform(curstate.get_gcc_loc(fun),
-                           'loop detected; stopping iteration')
-            # Don't return the prefix so far: it is not a complete trace
-            return []
+            if widening and prefix.widen_loop():
+                log('loop detected; continuing with widened state')
+                curstate = prefix.states[-1]
+            else:
+                log('loop detected; stopping iteration')
+                if 0:
+                    gcc.inform(curstate.get_gcc_loc(fun),
+                               'loop detected; stopping iteration')
+                # Don't yield the prefix so far: it is not a complete trace
+                return
 
     # We need the prevstate in order to handle Phi nodes
     if len(prefix.states) > 1:
@@ -3003,7 +3492,8 @@ def iter_traces(stmtgraph, facets, prefix=None, limits=None, depth=0):
         trace_with_err = prefix.copy()
         trace_with_err.add_error(err)
         trace_with_err.log(log, 'FINISHED TRACE WITH ERROR: %s' % err)
-        return [trace_with_err]
+        yield (position, trace_with_err)
+        return
     except SplitValue:
         # Split the state up, splitting into parallel worlds with different
         # values for the given value
@@ -3015,33 +3505,72 @@ def iter_traces(stmtgraph, facets, prefix=None, limits=None, depth=0):
     log('transitions: %s', transitions)
 
     if len(transitions) > 0:
-        result = []
-        for transition in transitions:
+        for index, transition in enumerate(transitions):
             check_isinstance(transition, Transition)
-            transition.dest.verify()
+            if verify_states:
+                transition.dest.verify()
 
             # Potentially raise a TooComplicated exception:
             if limits:
-                limits.on_transition(transition, result)
+                try:
+                    limits.on_transition(transition, [])
+                except TooComplicated:
+                    err = sys.exc_info()[1]
+                    err.position = position + (index, )
+                    raise
 
             newprefix = prefix.copy().add(transition)
 
             # Recurse
             # This gives us a depth-first traversal of the state tree
-            try:
-                for trace in iter_traces(stmtgraph, facets, newprefix, limits,
-                                         depth + 1):
-                    result.append(trace)
-            except TooComplicated:
-                err = sys.exc_info()[1]
-                traces = err.complete_traces
-                traces += result
-                raise TooComplicated(traces)
-        return result
+            for item in generate_traces(stmtgraph, facets, newprefix, limits,
+                                        depth + 1, widening,
+                                        position + (index, )):
+                yield item
     else:
         # We're at a terminating state:
         prefix.log(log, 'FINISHED TRACE')
-        return [prefix]
+        yield (position, prefix)
+
+def get_partial_order_key(position, exceeded_at):
+    """
+    Sort key for the position of a trace completed before a TooComplicated
+    exception at position "exceeded_at", giving the order in which the
+    traces were listed when the whole tree was gathered into lists: those
+    below the deepest of the unfinished levels of the tree first, then those
+    of the level above, and so on; within each level, in depth-first order.
+
+    The order matters, as the first of a set of duplicate reports is the one
+    that gets emitted.
+    """
+    common = 0
+    for i, j in zip(position, exceeded_at):
+        if i != j:
+            break
+        common += 1
+    return (-common, position)
+
+def iter_traces(stmtgraph, facets, prefix=None, limits=None, depth=0,
+                widening=False):
+    """
+    Traverse the tree of traces of program state, returning a list
+    of Trace instances (see generate_traces).
+
+    If it's interrupted by a TooComplicated exception, we should at least
+    capture an incomplete list of paths down to some of the bottoms of the
+    tree, as the exception's "complete_traces".
+    """
+    result = []
+    try:
+        for item in generate_traces(stmtgraph, facets, prefix, limits, depth,
+                                    widening):
+            result.append(item)
+    except TooComplicated:
+        err = sys.exc_info()[1]
+        result.sort(key=lambda item: get_partial_order_key(item[0],
+                                                           err.position))
+        raise TooComplicated([trace for position, trace in result])
+    return [trace for position, trace in result]
 
 class StateGraph:
     """
@@ -47,6 +47,7 @@ if hasattr(gcc, 'PLUGIN_FINISH_DECL'):
     # GCC 4.7 and later
     global_exceptions = {}
     global_typeobjs = {}
+    global_api_fndecls = {}
 
     def on_finish_decl(*args):
         # GCC 4.7 and later: callback to the PLUGIN_FINISH_DECL event
@@ -54,6 +55,7 @@ if hasattr(gcc, 'PLUGIN_FINISH_DECL'):
 
         global global_exceptions
         global global_typeobjs
+        global global_api_fndecls
 
         decl = args[0]
         if isinstance(decl, gcc.VarDecl):
@@ -62,6 +64,20 @@ if hasattr(gcc, 'PLUGIN_FINISH_DECL'):
                     global_exceptions[decl.name] = decl
                 if decl.name.endswith('_Type'):
                     global_typeobjs[decl.name] = decl
+        elif isinstance(decl, gcc.FunctionDecl):
+            if decl.name:
+                if decl.name.startswith(('Py', '_Py')):
+                    global_api_fndecls[decl.name] = decl
+
+    def gather_lto_decls():
+        # Within lto1, the declarations are read back in rather than being
+        # parsed, so PLUGIN_FINISH_DECL isn't called for them.  Gather those
+        # that the program refers to from the varpool and the callgraph
+        # instead:
+        for var in gcc.get_variables():
+            on_finish_decl(var.decl)
+        for node in gcc.get_callgraph_nodes():
+            on_finish_decl(node.decl)
 
     def _get_exception_decl_by_name(exc_name):
         return global_exceptions[exc_name]
@@ -69,6 +85,9 @@ if hasattr(gcc, 'PLUGIN_FINISH_DECL'):
     def _get_typeobject_decl_by_name(typeobjname):
         return global_typeobjs[typeobjname]
 
+    def get_api_fndecl_by_name(fnname):
+        return global_api_fndecls.get(fnname)
+
 else:
     # GCC 4.6 doesn't have PLUGIN_FINISH_DECL, but
     # gccutils.get_global_vardecl_by_name() finds the declarations we need
@@ -79,6 +98,14 @@ else:
     def _get_typeobject_decl_by_name(typeobjname):
         return gccutils.get_global_vardecl_by_name(typeobjname)
 
+    def get_api_fndecl_by_name(fnname):
+        for u in gcc.get_translation_units():
+            if u.block:
+                for v in u.block.vars:
+                    if isinstance(v, gcc.FunctionDecl):
+                        if v.name == fnname:
+                            return v
+
 def get_exception_decl_by_name(exc_name):
     exc_decl = _get_exception_decl_by_name(exc_name)
     if not exc_decl:
@@ -102,6 +102,9 @@ class Reporter:
     def __init__(self):
         self.reports = []
         self._got_warnings = False
+        # Which of the budgets of the analysis, if any, cut it short (see
+        # absinterp.Limits):
+        self.exceeded = None
 
     def make_warning(self, fun, loc, msg):
         assert isinstance(fun, gcc.Function)
@@ -145,6 +148,36 @@ class Reporter:
         if 0:
             print(dumps(js, sort_keys=True, indent=4))
 
+    def to_records(self, fun, htmlpath):
+        """
+        Generate a list of flat dicts, one per report, suitable for indexing
+        the results of a large number of builds without needing to scrape
+        the HTML (see misc/fedora/resultsdb.py)
+        """
+        import os.path
+        result = []
+        # Match the ids of the <div> elements generated by HtmlRenderer:
+        trace_idx = 0
+        for report in self.reports:
+            result.append(dict(filename=fun.start.file,
+                               function=fun.decl.name,
+                               errmsg=report.msg,
+                               line=report.loc.line,
+                               column=report.loc.column,
+                               htmlpath=os.path.basename(htmlpath),
+                               htmlid='report-%i' % trace_idx,
+                               messages=report.get_messages()))
+            if report.trace:
+                trace_idx += 1
+        return result
+
+    def dump_records(self, fun, filename, htmlpath):
+        # Write the records as "JSON lines": one JSON object per line
+        from json import dumps
+        with open(filename, 'w') as f:
+            for record in self.to_records(fun, htmlpath):
+                f.write(dumps(record, sort_keys=True) + '\n')
+
     def to_html(self, fun):
         # (FIXME: eliminate self.fun from HtmlRenderer and the above arg)
         r = HtmlRenderer(fun)
@@ -185,6 +218,12 @@ class Reporter:
         for r in self.reports:
             r.flush()
 
+    def iter_saved_diagnostics(self):
+        # The SavedDiagnostic instances that flush() emits, in order:
+        for r in self.reports:
+            for d in r._saved_diagnostics:
+                yield d
+
 class SavedDiagnostic:
     """
     A saved GCC diagnostic, which we can choose to emit or suppress at a later
@@ -253,6 +292,22 @@ class Report:
     def get_annotator_for_trace(self, trace):
         return self._annotators.get(trace)
 
+    def get_messages(self):
+        """
+        Get a list of the text of all of the messages about this report
+        (the warning, descriptions of the trace, and any notes), as they
+        would appear within the HTML rendering
+        """
+        result = [d.msg for d in self._saved_diagnostics]
+        if self.trace:
+            annotator = self.get_annotator_for_trace(self.trace)
+            if annotator:
+                for trans in self.trace.transitions:
+                    for note in annotator.get_notes(trans):
+                        if note.msg not in result:
+                            result.append(note.msg)
+        return result
+
     def is_duplicate_of(self, other):
         check_isinstance(other, Report)
 
@@ -17,7 +17,7 @@
 
 import sys
 
-from gccutils import get_src_for_loc, get_global_typedef
+from gccutils import get_src_for_loc, get_global_typedef, check_isinstance
 
 from libcpychecker.types import *
 from libcpychecker.utils import log
@@ -100,6 +100,11 @@ class FormatUnit:
         # either as gcc.Type instances, or as instances of AwkwardType
         raise NotImplementedError
 
+    def reset(self):
+        # Discard any state recorded whilst checking the arguments at a
+        # callsite (see ParsedFormatString.parse)
+        pass
+
 class ConcreteUnit(FormatUnit):
     """
     The common case: a fragment of a format string that corresponds to a
@@ -138,6 +143,66 @@ class ParsedFormatString:
         return ('%s(fmt_string=%r, args=%r)'
                 % (self.__class__.__name__, self.fmt_string, self.args))
 
+    @classmethod
+    def parse(cls, fmt_string, with_size_t):
+        """
+        Memoized version of from_string: the same handful of format strings
+        are typically used at many callsites, so only parse each one once,
+        resolving the expected types once.
+
+        Parse failures are cached too, and an equivalent FormatStringWarning
+        is raised on each lookup.
+        """
+        key = (cls, fmt_string, with_size_t)
+        try:
+            result = _parsed_format_cache[key]
+        except KeyError:
+            try:
+                result = cls.from_string(fmt_string, with_size_t)
+            except FormatStringWarning:
+                result = CachedParseFailure(sys.exc_info()[1])
+            _parsed_format_cache[key] = result
+        if isinstance(result, CachedParseFailure):
+            raise result.make_exception()
+        # "O!" and "O&" units record what they learn from one argument for
+        # use when checking the next; don't let that leak between callsites:
+        result.reset()
+        return result
+
+    def reset(self):
+        for unit, exp_type in self.iter_exp_types():
+            unit.reset()
+
+class CachedParseFailure(object):
+    """
+    A format string that failed to parse, as recorded by
+    ParsedFormatString.parse.
+
+    This holds the class and attributes of the FormatStringWarning rather
+    than the exception itself: re-raising the same instance would grow its
+    traceback on each lookup, keeping alive the frames of every callsite.
+    """
+    __slots__ = ('exc_class', 'exc_attrs')
+
+    def __init__(self, exc):
+        check_isinstance(exc, FormatStringWarning)
+        self.exc_class = exc.__class__
+        self.exc_attrs = dict(exc.__dict__)
+
+    def make_exception(self):
+        # (bypassing __init__, since the subclasses' signatures vary)
+        exc = self.exc_class.__new__(self.exc_class)
+        exc.__dict__.update(self.exc_attrs)
+        return exc
+
+# Cache for ParsedFormatString.parse, from (class, fmt_string, with_size_t)
+# to either a ParsedFormatString or a CachedParseFailure.
+#
+# The expected types are gcc.Type instances, and whether we're compiling
+# against Python 3 is determined by the headers; both are fixed for the
+# lifetime of the compiler process, which handles a single translation unit:
+_parsed_format_cache = {}
+
 class WrongNumberOfVars(ParsedFormatStringWarning):
     def __init__(self, funcname, fmt, varargs):
         ParsedFormatStringWarning.__init__(self, funcname, fmt)
@@ -319,6 +384,19 @@ def compatible_type(exp_type, actual_type, actualarg=None):
 
     return False
 
+# The functions whose callsites are checked by check_pyargs.  If
+# PY_SSIZE_T_CLEAN is defined before #include <Python.h>, then the
+# preprocessor turns calls to the API entrypoints into calls to the
+# "_SizeT"-suffixed variants:
+fnnames_with_format_strings = frozenset(['PyArg_ParseTuple',
+                                         '_PyArg_ParseTuple_SizeT',
+                                         'PyArg_Parse',
+                                         '_PyArg_Parse_SizeT',
+                                         'PyArg_ParseTupleAndKeywords',
+                                         '_PyArg_ParseTupleAndKeywords_SizeT',
+                                         'Py_BuildValue',
+                                         '_Py_BuildValue_SizeT'])
+
 def check_pyargs(fun):
     from libcpychecker.PyArg_ParseTuple import PyArgParseFmt
     from libcpychecker.Py_BuildValue import PyBuildValueFmt
@@ -387,7 +465,7 @@ def check_pyargs(fun):
 
                 # Figure out expected types, based on the format string...
                 try:
-                    fmt = parser.from_string(fmt_string, with_size_t)
+                    fmt = parser.parse(fmt_string, with_size_t)
                 except FormatStringWarning:
                     err = sys.exc_info()[1]
                     err.emit_as_warning(stmt.loc)
@@ -465,7 +543,7 @@ def check_pyargs(fun):
                                PyBuildValueFmt,
                                'Py_BuildValue',
                                0, 1, False)
-            elif stmt.fndecl.name == 'Py_BuildValue_SizeT':
+            elif stmt.fndecl.name == '_Py_BuildValue_SizeT':
                 check_callsite(stmt,
                                PyBuildValueFmt,
                                'Py_BuildValue',
@@ -473,9 +551,8 @@ def check_pyargs(fun):
 
     if fun.cfg:
         for bb in fun.cfg.basic_blocks:
-            if isinstance(bb.gimple, list):
-                for stmt in bb.gimple:
-                    if stmt.loc:
-                        gcc.set_location(stmt.loc)
-                    if isinstance(stmt, gcc.GimpleCall):
-                        maybe_check_callsite(stmt)
+            for stmt in bb.gimple:
+                if stmt.loc:
+                    gcc.set_location(stmt.loc)
+                if isinstance(stmt, gcc.GimpleCall):
+                    maybe_check_callsite(stmt)
@@ -0,0 +1,311 @@
+#   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2012 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+############################################################################
+# Incremental re-analysis at link time
+#
+# When the interprocedural refcount checker runs within lto1 (from
+# CpyCheckerLtoPass, with -flto-partition=none), it sees the whole program,
+# and so relinking after editing one file would re-analyze every function.
+# An LtoCache persists what was learned about each function between links:
+#   - a hash of the function's streamed GIMPLE body (see hash_function)
+#   - its RefcountSummary (see summaries.py)
+#   - the GCC diagnostics that the checker emitted for it
+#
+# A function is re-analyzed if its body hash has changed, or if any function
+# that it calls had its summary change during this link; otherwise its
+# summary is reused, and its diagnostics are re-emitted.  Since the
+# functions are visited bottom-up over the callgraph, a change ripples up
+# through the callers for as long as it changes their summaries.
+############################################################################
+
+import hashlib
+import json
+import os
+import re
+
+import gcc
+
+from gccutils import check_isinstance
+from gccutils.graph.partitions import get_function_key
+from libcpychecker.diagnostics import SavedWarning, SavedInform
+from libcpychecker.summaries import RefcountSummary
+from libcpychecker.utils import log
+
+# Bump this when the format of the file, or the results of the analysis,
+# change incompatibly:
+FORMAT_VERSION = 2
+
+# Temporaries are numbered by a counter shared by the whole unit, so
+# editing one function renumbers the temporaries of those that follow it:
+_tmp_pattern = re.compile(r'\bD\.(\d+)\b')
+
+def _normalize_temporaries(text, renumbering):
+    def renumber(m):
+        uid = m.group(1)
+        if uid not in renumbering:
+            renumbering[uid] = len(renumbering)
+        return 'D.#%i' % renumbering[uid]
+    return _tmp_pattern.sub(renumber, text)
+
+def _describe_loc(loc):
+    if loc:
+        return '%s:%i:%i' % (loc.file, loc.line, loc.column)
+    return '-'
+
+def hash_function(fun):
+    """
+    Get a hex digest summarizing everything about a gcc.Function that the
+    refcount checker's results depend on, other than the summaries of the
+    functions that it calls: its signature, its CFG, and the statements and
+    source locations within it, along with any of our custom attributes of
+    the functions that it calls
+    """
+    from libcpychecker.attributes import fnnames_returning_borrowed_refs, \
+        fnnames_setting_exception, \
+        fnnames_setting_exception_on_negative_result, \
+        stolen_refs_by_fnname
+    check_isinstance(fun, gcc.Function)
+    renumbering = {}
+    h = hashlib.sha1()
+    def add(text):
+        text = _normalize_temporaries(text, renumbering)
+        h.update(text.encode('utf-8'))
+        h.update(b'\n')
+
+    add('%s %s %s %s' % (fun.decl.name, fun.decl.type,
+                         _describe_loc(fun.start), _describe_loc(fun.end)))
+    for bb in fun.cfg.basic_blocks:
+        add('bb %i -> %s'
+            % (bb.index,
+               ' '.join(['%i:%i%i%i%i' % (e.dest.index,
+                                          e.true_value, e.false_value,
+                                          e.complex, e.eh)
+                         for e in bb.succs])))
+        for stmt in (bb.phi_nodes or []):
+            add('%s %s' % (stmt.__class__.__name__, stmt))
+        for stmt in (bb.gimple or []):
+            add('%s %s %s' % (stmt.__class__.__name__, stmt,
+                              _describe_loc(stmt.loc)))
+            if isinstance(stmt, gcc.GimpleCall) and stmt.fndecl:
+                fnname = stmt.fndecl.name
+                add('attrs %r %r %r %r'
+                    % (fnname in fnnames_returning_borrowed_refs,
+                       fnname in fnnames_setting_exception,
+                       fnname in fnnames_setting_exception_on_negative_result,
+                       stolen_refs_by_fnname.get(fnname)))
+    return h.hexdigest()
+
+class CacheEntry(object):
+    """
+    What's known about one function from an earlier link
+    """
+    __slots__ = ('body_hash', 'summary', 'diagnostics')
+
+    def __init__(self, body_hash, summary, diagnostics):
+        # str: the result of hash_function
+        self.body_hash = body_hash
+
+        # RefcountSummary, or None:
+        self.summary = summary
+
+        # list of (kind, file, line, column, msg) tuples, where kind is
+        # 'warning' or 'inform', in the order they were emitted:
+        self.diagnostics = diagnostics
+
+    @classmethod
+    def from_reporter(cls, body_hash, summary, rep):
+        diagnostics = []
+        for d in rep.iter_saved_diagnostics():
+            if isinstance(d, SavedWarning):
+                kind = 'warning'
+            else:
+                check_isinstance(d, SavedInform)
+                kind = 'inform'
+            diagnostics.append((kind, d.loc.file, d.loc.line, d.loc.column,
+                                d.msg))
+        return cls(body_hash, summary, diagnostics)
+
+    def to_json(self):
+        return dict(body_hash=self.body_hash,
+                    summary=(self.summary.to_json()
+                             if self.summary else None),
+                    diagnostics=self.diagnostics)
+
+    @classmethod
+    def from_json(cls, js):
+        return cls(js['body_hash'],
+                   (RefcountSummary.from_json(js['summary'])
+                    if js['summary'] else None),
+                   [tuple(d) for d in js['diagnostics']])
+
+    def replay(self, fun):
+        """
+        Re-emit the saved diagnostics for the given gcc.Function, returning
+        False (having emitted nothing) if any of their locations can't be
+        found within it
+        """
+        if not self.diagnostics:
+            return True
+        # There's no way to make a gcc.Location from scratch, but the body
+        # hash covers the locations of the statements, so we can find them
+        # again within the function:
+        locs = {}
+        def add_loc(loc):
+            if loc:
+                locs[(loc.file, loc.line, loc.column)] = loc
+        add_loc(fun.start)
+        add_loc(fun.end)
+        add_loc(fun.decl.location)
+        for decl in list(fun.decl.arguments or []) + list(fun.local_decls or []):
+            add_loc(decl.location)
+        for bb in fun.cfg.basic_blocks:
+            for stmt in (bb.gimple or []):
+                add_loc(stmt.loc)
+        todo = []
+        for kind, file_, line, column, msg in self.diagnostics:
+            loc = locs.get((file_, line, column))
+            if loc is None:
+                log('unable to find location %s:%i:%i within %s',
+                    file_, line, column, fun)
+                return False
+            todo.append((kind, loc, msg))
+        for kind, loc, msg in todo:
+            if kind == 'warning':
+                gcc.warning(loc, msg)
+            else:
+                gcc.inform(loc, msg)
+        return True
+
+class LtoCache(object):
+    """
+    A file recording CacheEntry instances by function, from one link to
+    the next
+    """
+    def __init__(self, path, config):
+        self.path = path
+
+        # A dict describing the options and version of GCC that the results
+        # depend on: the cache is discarded if these differ:
+        self.config = config
+
+        # dict from the key of each function (as per get_function_key) to
+        # CacheEntry:
+        self.entries = {}
+
+        # The keys of the functions seen during this link:
+        self.seen = set()
+
+        # The keys of the functions whose summaries were recomputed during
+        # this link, and turned out different to last time:
+        self.changed_summaries = set()
+
+        # dict from key to (body_hash, old CacheEntry or None), for the
+        # functions that are being re-analyzed:
+        self.pending = {}
+
+        self.hits = 0
+        self.misses = 0
+
+        self._load()
+
+    def _load(self):
+        if not os.path.exists(self.path):
+            return
+        try:
+            with open(self.path) as f:
+                js = json.load(f)
+            if js.get('version') != FORMAT_VERSION:
+                return
+            if js.get('config') != self.config:
+                log('discarding %s: configuration has changed', self.path)
+                return
+            for key, entry_js in js['functions'].items():
+                self.entries[key] = CacheEntry.from_json(entry_js)
+        except (ValueError, KeyError, TypeError):
+            # A corrupt or truncated cache is the same as an empty one:
+            log('unable to read %s', self.path)
+            self.entries = {}
+
+    def reuse(self, fun, node):
+        """
+        Try to reuse the results of an earlier link for a function (with the
+        given gcc.CallgraphNode).  If they're still valid, re-emit its
+        diagnostics and return its CacheEntry; otherwise return None, and
+        the function needs to be re-analyzed.
+
+        Must be called bottom-up over the callgraph, with each miss being
+        followed by a call to update() once the function has been analyzed.
+        """
+        key = get_function_key(fun.decl)
+        self.seen.add(key)
+        body_hash = hash_function(fun)
+        entry = self.entries.get(key)
+        if entry and entry.body_hash != body_hash:
+            log('%s has changed', fun)
+        elif entry:
+            for edge in node.callees:
+                if get_function_key(edge.callee.decl) in self.changed_summaries:
+                    log('summary of %s has changed, affecting %s',
+                        edge.callee.decl.name, fun)
+                    break
+            else:
+                if entry.replay(fun):
+                    self.hits += 1
+                    return entry
+        self.misses += 1
+        # Stash the hash and the old entry for update():
+        self.pending[key] = (body_hash, entry)
+        return None
+
+    def update(self, fun, summary, rep):
+        """
+        Record the results of re-analyzing a function after a miss: its
+        RefcountSummary (or None) and the Reporter from check_refcounts (or
+        None if it wasn't analyzed)
+        """
+        key = get_function_key(fun.decl)
+        body_hash, old = self.pending.pop(key)
+        if old is None or not summaries_equal(old.summary, summary):
+            self.changed_summaries.add(key)
+        if rep is None or rep.exceeded not in (None, 'transitions'):
+            # Not analyzed, or cut short by a budget that depends on how
+            # busy the machine was, so don't keep the results:
+            self.entries.pop(key, None)
+            return
+        self.entries[key] = CacheEntry.from_reporter(body_hash, summary, rep)
+
+    def save(self):
+        # Forget about functions that have gone away:
+        functions = dict([(key, entry.to_json())
+                          for key, entry in self.entries.items()
+                          if key in self.seen])
+        js = dict(version=FORMAT_VERSION,
+                  config=self.config,
+                  functions=functions)
+        # Write to a temporary file and rename it into place, so that an
+        # interrupted link doesn't leave a truncated cache behind:
+        tmppath = '%s.%i.tmp' % (self.path, os.getpid())
+        with open(tmppath, 'w') as f:
+            json.dump(js, f, sort_keys=True)
+        os.rename(tmppath, self.path)
+        log('%s: %i hits, %i misses', self.path, self.hits, self.misses)
+
+def summaries_equal(a, b):
+    if a is None or b is None:
+        return a is b
+    return a.to_json() == b.to_json()
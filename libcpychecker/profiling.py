@@ -0,0 +1,153 @@
+#   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2012 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+############################################################################
+# Per-function profiling of the refcount checker
+#
+# With --cpychecker-profile, a FunctionProfile is gathered for each function
+# analyzed, and written as a line of JSON to a file per translation unit,
+# named "<dump-base-name>.cpychecker-profile.jsonl".
+#
+# misc/rank-cpychecker-profiles.py reads these files from across a build,
+# and ranks the functions that were most expensive to analyze.
+############################################################################
+
+import json
+import time
+from collections import OrderedDict
+
+import gcc
+
+from gccutils import check_isinstance
+
+if hasattr(time, 'process_time'):
+    get_cpu_time = time.process_time
+else:
+    # Python 2:
+    get_cpu_time = time.clock
+
+# The FunctionProfile for the function currently being analyzed, if any, so
+# that the dispatch to the "impl_" handlers can be timed without threading
+# it through every State:
+active_profile = None
+
+def get_profile_path():
+    return '%s.cpychecker-profile.jsonl' % gcc.get_dump_base_name()
+
+class FunctionProfile(object):
+    """
+    What it cost to run the refcount checker on one function
+    """
+    __slots__ = ('fun',
+                 'start_time',
+                 'total_secs',
+                 'stmtgraph_secs',
+                 'num_transitions',
+                 'num_traces',
+                 'max_depth',
+                 'num_reports',
+                 'num_unique_reports',
+                 'exceeded',
+                 'handler_secs',
+                 'handler_calls')
+
+    def __init__(self, fun):
+        check_isinstance(fun, gcc.Function)
+        self.fun = fun
+        self.start_time = time.time()
+        self.total_secs = None
+        self.stmtgraph_secs = None
+        self.num_transitions = 0
+        self.num_traces = 0
+        self.max_depth = 0
+        self.num_reports = 0
+        self.num_unique_reports = 0
+        self.exceeded = None
+        # Dicts from "impl_" method name to total seconds, and to the number
+        # of calls:
+        self.handler_secs = {}
+        self.handler_calls = {}
+
+    def call_handler(self, methname, meth, stmt, args):
+        """
+        Call one of the "impl_" methods of a facet, timing it
+        """
+        start = time.time()
+        try:
+            return meth(stmt, *args)
+        finally:
+            # (the handlers can raise exceptions e.g. SplitValue; count
+            # those calls too)
+            elapsed = time.time() - start
+            self.handler_secs[methname] = \
+                self.handler_secs.get(methname, 0.0) + elapsed
+            self.handler_calls[methname] = \
+                self.handler_calls.get(methname, 0) + 1
+
+    def on_trace(self, trace):
+        # (called as each trace is completed, as the traces aren't
+        # necessarily kept)
+        self.num_traces += 1
+        self.max_depth = max(self.max_depth, len(trace.transitions))
+
+    def on_limits(self, limits):
+        self.num_transitions = limits.trans_seen
+        self.exceeded = limits.exceeded
+
+    def on_reports(self, rep):
+        self.num_reports = len(rep.reports)
+        self.num_unique_reports = len([r for r in rep.reports
+                                       if not r.is_duplicate])
+
+    def finish(self):
+        self.total_secs = time.time() - self.start_time
+
+    def get_dedup_ratio(self):
+        """
+        The proportion of the reports that were discarded as duplicates
+        """
+        if self.num_reports == 0:
+            return 0.0
+        return 1.0 - float(self.num_unique_reports) / self.num_reports
+
+    def as_json(self):
+        handlers = OrderedDict()
+        for methname in sorted(self.handler_secs,
+                               key=lambda name: -self.handler_secs[name]):
+            handlers[methname] = OrderedDict(
+                [('calls', self.handler_calls[methname]),
+                 ('seconds', round(self.handler_secs[methname], 6))])
+        return OrderedDict(
+            [('file', self.fun.start.file),
+             ('function', self.fun.decl.name),
+             ('line', self.fun.start.line),
+             ('seconds', round(self.total_secs, 6)),
+             ('stmtgraph_seconds', round(self.stmtgraph_secs, 6)),
+             # Each transition leads to a new state within the tree of
+             # states, below the initial one:
+             ('states', self.num_transitions + 1),
+             ('transitions', self.num_transitions),
+             ('traces', self.num_traces),
+             ('max_depth', self.max_depth),
+             ('reports', self.num_reports),
+             ('dedup_ratio', round(self.get_dedup_ratio(), 3)),
+             ('exceeded', self.exceeded),
+             ('handlers', handlers)])
+
+    def write(self, path):
+        with open(path, 'a') as f:
+            f.write(json.dumps(self.as_json()) + '\n')
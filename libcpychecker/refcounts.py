@@ -21,6 +21,7 @@
 # for a description of how such code is meant to be written
 
 import sys
+import time
 import gcc
 
 from gccutils import cfg_to_dot, invoke_dot, get_src_for_loc, check_isinstance
@@ -39,6 +40,7 @@ from libcpychecker.types import is_py3k, is_debug_build, get_PyObjectPtr, \
     get_Py_ssize_t
 from libcpychecker.utils import log
 from libcpychecker import compat
+from libcpychecker import profiling
 
 def stmt_is_assignment_to_count(stmt):
     if hasattr(stmt, 'lhs'):
@@ -305,19 +307,38 @@ class RefcountValue(AbstractValue):
         self.relvalue = relvalue
         self.external = external
 
+    def _key(self):
+        return (self._common_key(), self.r_obj, self.relvalue, self.external)
+
+    def widen(self, prevvalue):
+        # The references owned by this function must stay exact for the
+        # leak checks, so only the range of external references is widened
+        # (a loop that changes the owned count never reaches a fixpoint, and
+        # is given up on after Trace.MAX_WIDENINGS iterations):
+        if not isinstance(prevvalue, RefcountValue):
+            return self
+        if (prevvalue.r_obj != self.r_obj
+            or prevvalue.relvalue != self.relvalue):
+            return self
+        external = self.external.widen(prevvalue.external)
+        if external is prevvalue.external:
+            return prevvalue
+        return RefcountValue(prevvalue.loc, self.r_obj, self.relvalue,
+                             external)
+
     @classmethod
     def new_ref(cls, loc, r_obj):
-        return RefcountValue(loc, r_obj,
-                             relvalue=1,
-                             external=WithinRange(get_Py_ssize_t().type, loc,
-                                                  0, 0))
+        external = intern_value(WithinRange(get_Py_ssize_t().type, loc, 0, 0))
+        return intern_value(RefcountValue(loc, r_obj,
+                                          relvalue=1,
+                                          external=external))
 
     @classmethod
     def borrowed_ref(cls, loc, r_obj):
-        return RefcountValue(loc, r_obj,
-                             relvalue=0,
-                             external=WithinRange(get_Py_ssize_t().type, loc,
-                                                  1, 1))
+        external = intern_value(WithinRange(get_Py_ssize_t().type, loc, 1, 1))
+        return intern_value(RefcountValue(loc, r_obj,
+                                          relvalue=0,
+                                          external=external))
 
     def get_min_value(self):
         return self.relvalue + self.external.minvalue
@@ -424,6 +445,8 @@ class GenericTpDealloc(AbstractValue):
     A function pointer that points to a "typical" tp_dealloc callback
     i.e. one that frees up the underlying memory
     """
+    __slots__ = ()
+
     def get_transitions_for_function_call(self, state, stmt):
         check_isinstance(state, State)
         check_isinstance(stmt, gcc.GimpleCall)
@@ -522,21 +545,24 @@ class CPython(Facet):
                 # Assume it's a non-NULL ptr:
                 objregion = RegionForLocal(parm, None)
                 self.state.region_for_var[objregion] = objregion
-                self.state.value_for_region[region] = PointerToRegion(parm.type,
-                                                                parm.location,
-                                                                objregion)
+                self.state.set_value_of_region(region,
+                                               PointerToRegion(parm.type,
+                                                               parm.location,
+                                                               objregion))
                 # Assume we have a borrowed reference:
                 ob_refcnt = self.state.make_field_region(objregion, 'ob_refcnt') # FIXME: this should be a memref and fieldref
-                self.state.value_for_region[ob_refcnt] = \
+                self.state.set_value_of_region(
+                    ob_refcnt,
                     RefcountValue.borrowed_ref(parm.location,
-                                               objregion)
+                                               objregion))
 
                 # Assume it has a non-NULL ob_type:
                 ob_type = self.state.make_field_region(objregion, 'ob_type')
                 typeobjregion = Region('region-for-type-of-arg-%r' % parm, None)
-                self.state.value_for_region[ob_type] = PointerToRegion(get_PyTypeObject().pointer,
-                                                                 parm.location,
-                                                                 typeobjregion)
+                self.state.set_value_of_region(ob_type,
+                                               PointerToRegion(get_PyTypeObject().pointer,
+                                                               parm.location,
+                                                               typeobjregion))
         self.state.verify()
 
     def get_refcount(self, v_pyobjectptr, stmt):
@@ -572,7 +598,7 @@ class CPython(Facet):
         check_isinstance(oldvalue, RefcountValue)
         newvalue = fn(oldvalue)
         log('newvalue: %r', newvalue)
-        self.state.value_for_region[ob_refcnt] = newvalue
+        self.state.set_value_of_region(ob_refcnt, newvalue)
         return newvalue
 
     def add_ref(self, pyobjectptr, loc):
@@ -785,15 +811,17 @@ class CPython(Facet):
         # Claim a Region for the object:
         r_nonnull = self.state.make_heap_region(name, stmt)
 
+        # If the RefcountValue doesn't have a Region yet, associate it
+        # with that of the new object (making a new value, since it could
+        # be interned):
+        if not v_refcount.r_obj:
+            v_refcount = RefcountValue(v_refcount.loc, r_nonnull,
+                                       v_refcount.relvalue, v_refcount.external)
+
         # Set up ob_refcnt to the given value:
         r_ob_refcnt = self.state.make_field_region(r_nonnull,
                                              'ob_refcnt') # FIXME: this should be a memref and fieldref
-        self.state.value_for_region[r_ob_refcnt] = v_refcount
-
-        # If the RefcountValue doesn't have a Region yet, associate it
-        # with that of the new object:
-        if not v_refcount.r_obj:
-            v_refcount.r_obj = r_nonnull
+        self.state.set_value_of_region(r_ob_refcnt, v_refcount)
 
         # Ensure that the new object has a sane ob_type:
         if r_typeobj is None:
@@ -804,15 +832,17 @@ class CPython(Facet):
 
         # Set up obj->ob_type:
         ob_type = self.state.make_field_region(r_nonnull, 'ob_type')
-        self.state.value_for_region[ob_type] = PointerToRegion(get_PyTypeObject().pointer,
-                                                         stmt.loc,
-                                                         r_typeobj)
+        self.state.set_value_of_region(ob_type,
+                                       PointerToRegion(get_PyTypeObject().pointer,
+                                                       stmt.loc,
+                                                       r_typeobj))
         # Set up obj->ob_type->tp_dealloc:
         tp_dealloc = self.state.make_field_region(r_typeobj, 'tp_dealloc')
         type_of_tp_dealloc = gccutils.get_field_by_name(get_PyTypeObject().type,
                                                         'tp_dealloc').type
-        self.state.value_for_region[tp_dealloc] = GenericTpDealloc(type_of_tp_dealloc,
-                                                             stmt.loc)
+        self.state.set_value_of_region(tp_dealloc,
+                                       GenericTpDealloc(type_of_tp_dealloc,
+                                                        stmt.loc))
         return r_nonnull
 
     def mkstate_new_ref(self, stmt, name, typeobjregion=None):
@@ -896,6 +926,25 @@ class CPython(Facet):
         return self.state.make_transitions_for_fncall(stmt, fnmeta,
                                                       s_success, s_failure)
 
+    def make_transitions_for_summarized_fncall(self, stmt, fnmeta, summary):
+        """
+        Generate the appropriate list of transitions for a call to a
+        function for which we have a RefcountSummary (see summaries.py)
+        """
+        check_isinstance(fnmeta, FnMeta)
+        if summary.returns_borrowed_ref:
+            s_success = self.mkstate_borrowed_ref(stmt, fnmeta)
+        else:
+            s_success, nonnull = self.mkstate_new_ref(stmt,
+                                                      'new ref from call to %s'
+                                                      % fnmeta.name)
+        if not summary.can_return_NULL_with_exception:
+            return [self.state.mktrans_from_fncall_state(stmt, s_success,
+                                                         'succeeds', False)]
+        s_failure = self.mkstate_exception(stmt)
+        return self.state.make_transitions_for_fncall(stmt, fnmeta,
+                                                      s_success, s_failure)
+
     def object_ptr_has_global_ob_type(self, v_object_ptr, vardecl_name):
         """
         Boolean: do we know that the given PyObject* has an ob_type matching
@@ -1040,7 +1089,14 @@ class CPython(Facet):
         # Give the transition a description that embeds the argument values
         # This will show up in selftests (and in error reports that embed
         # traces)
-        if args[0] != args[1]:
+        # Compare ConcreteValue instances by value, ignoring where they
+        # came from:
+        if (isinstance(args[0], ConcreteValue)
+            and isinstance(args[1], ConcreteValue)):
+            equal = (args[0].value == args[1].value)
+        else:
+            equal = (args[0] == args[1])
+        if not equal:
             raise AssertionError('%s != %s' % (args[0], args[1]))
         desc = '__cpychecker_assert_equal(%s)' % (','.join([str(arg) for arg in args]))
         return [self.state.mktrans_assignment(stmt.lhs,
@@ -1116,12 +1172,12 @@ class CPython(Facet):
                     v_new = _get_new_value_for_vararg(unit, exptype)
                     if v_new:
                         check_isinstance(v_new, AbstractValue)
-                        s_success.value_for_region[v_vararg.region] = v_new
+                        s_success.set_value_of_region(v_vararg.region, v_new)
 
         fmt_string = v_fmt.as_string_constant()
         if fmt_string:
             try:
-                fmt = PyArgParseFmt.from_string(fmt_string, with_size_t)
+                fmt = PyArgParseFmt.parse(fmt_string, with_size_t)
                 _handle_successful_parse(fmt)
             except FormatStringWarning:
                 pass
@@ -1257,7 +1313,7 @@ class CPython(Facet):
                                             s_success.cpython.make_sane_object(stmt,
                                                                                'argument %i' % (i + 1),
                                                                                RefcountValue.borrowed_ref(stmt.loc, None)))
-                    s_success.value_for_region[vararg.region] = v_obj
+                    s_success.set_value_of_region(vararg.region, v_obj)
 
         return result
 
@@ -1338,7 +1394,7 @@ class CPython(Facet):
         fmt_string = v_fmt.as_string_constant()
         if fmt_string:
             try:
-                fmt = PyBuildValueFmt.from_string(fmt_string, with_size_t)
+                fmt = PyBuildValueFmt.parse(fmt_string, with_size_t)
                 if not _handle_successful_parse(fmt):
                     return [t_failure]
             except FormatStringWarning:
@@ -2292,7 +2348,7 @@ class CPython(Facet):
             raise NotImplementedError()
         array_region = s_success._array_region(ob_item_region, index_value)
 
-        s_success.value_for_region[array_region] = v_newitem
+        s_success.set_value_of_region(array_region, v_newitem)
 
         # Can fail with memory error, overflow error:
         s_failure = self.state.mkstate_concrete_return_of(stmt, -1)
@@ -2336,14 +2392,15 @@ class CPython(Facet):
         ob_item_region = t_success.dest.make_heap_region(
             'ob_item array for PyListObject',
             stmt)
-        t_success.dest.value_for_region[ob_item_region] = \
-            ConcreteValue(get_PyObjectPtr(),
-                          stmt.loc, 0)
+        t_success.dest.set_value_of_region(ob_item_region,
+                                           ConcreteValue(get_PyObjectPtr(),
+                                                         stmt.loc, 0))
 
         ob_item = t_success.dest.make_field_region(r_newobj, 'ob_item')
-        t_success.dest.value_for_region[ob_item] = PointerToRegion(get_PyObjectPtr().pointer,
-                                                                 stmt.loc,
-                                                                 ob_item_region)
+        t_success.dest.set_value_of_region(ob_item,
+                                           PointerToRegion(get_PyObjectPtr().pointer,
+                                                           stmt.loc,
+                                                           ob_item_region))
 
         return [t_success, t_failure]
 
@@ -2504,10 +2561,10 @@ class CPython(Facet):
             # Clear the value for any fields within the region:
             for k, v in region.fields.items():
                 if v in s_new.value_for_region:
-                    del s_new.value_for_region[v]
+                    s_new.remove_region(v)
             # Set the default value for the whole region to be "DeallocatedMemory"
             s_new.region_for_var[region] = region
-            s_new.value_for_region[region] = DeallocatedMemory(None, stmt.loc)
+            s_new.set_value_of_region(region, DeallocatedMemory(None, stmt.loc))
 
         return [Transition(self.state, s_new, desc)]
 
@@ -2664,7 +2721,7 @@ class CPython(Facet):
         fmt_string = fncall.args[fmtargidx].as_string_constant()
         if fmt_string:
             try:
-                fmt = PyBuildValueFmt.from_string(fmt_string, with_size_t)
+                fmt = PyBuildValueFmt.parse(fmt_string, with_size_t)
                 if not _handle_successful_parse(fmt):
                     on_success.is_possible = False
             except FormatStringWarning:
@@ -2964,7 +3021,7 @@ class CPython(Facet):
         s_success, nonnull = self.mkstate_new_ref(stmt, '_PyObject_New')
         # ...and set up ob_type on the result object:
         ob_type = s_success.make_field_region(nonnull, 'ob_type')
-        s_success.value_for_region[ob_type] = v_typeptr
+        s_success.set_value_of_region(ob_type, v_typeptr)
         t_success = Transition(self.state,
                                s_success,
                                fnmeta.desc_when_call_succeeds())
@@ -3293,8 +3350,9 @@ class CPython(Facet):
 
             # *pv = NULL, and set desc:
             for t_new in result:
-                t_new.dest.value_for_region[v_pv.region] = \
-                    make_null_ptr(get_PyObjectPtr(), stmt.loc)
+                t_new.dest.set_value_of_region(
+                    v_pv.region,
+                    make_null_ptr(get_PyObjectPtr(), stmt.loc))
                 t_new.desc = fnmeta.desc_special(
                     'cleans up due to NULL right-hand side (%s on *LHS)'
                     % t_new.desc)
@@ -3318,13 +3376,15 @@ class CPython(Facet):
 
         # Handle *pv = v:
         for t_success in t_successes:
-            t_success.dest.value_for_region[v_pv.region] = \
-                    PointerToRegion(get_PyObjectPtr(), stmt.loc, r_nonnull)
+            t_success.dest.set_value_of_region(
+                    v_pv.region,
+                    PointerToRegion(get_PyObjectPtr(), stmt.loc, r_nonnull))
             t_success.desc = fnmeta.desc_when_call_succeeds() + ' (%s on *LHS)' % t_success.desc
 
         for t_failure in t_failures:
-            t_failure.dest.value_for_region[v_pv.region] = \
-                ConcreteValue(get_PyObjectPtr(), stmt.loc, 0)
+            t_failure.dest.set_value_of_region(
+                v_pv.region,
+                ConcreteValue(get_PyObjectPtr(), stmt.loc, 0))
             t_failure.desc = fnmeta.desc_when_call_fails() + ' (%s on *LHS)' % t_failure.desc
 
         return t_successes + t_failures
@@ -3474,7 +3534,7 @@ class CPython(Facet):
         s_success, nonnull = self.mkstate_new_ref(stmt, 'PyStructSequence_New')
         # ...and set up ob_type on the result object:
         ob_type = s_success.make_field_region(nonnull, 'ob_type')
-        s_success.value_for_region[ob_type] = v_typeptr
+        s_success.set_value_of_region(ob_type, v_typeptr)
         t_success = Transition(self.state,
                                s_success,
                                fnmeta.desc_when_call_succeeds())
@@ -3666,7 +3726,7 @@ class CPython(Facet):
             r_indexed = s_success._array_region(r_ob_item, v_i)
             # v_olditem = s_success.value_for_region[r_indexed]
             # FIXME: it does an XDECREF on the olditem
-            s_success.value_for_region[r_indexed] = v_newitem
+            s_success.set_value_of_region(r_indexed, v_newitem)
 
             result.append(Transition(self.state,
                                      s_success,
@@ -3900,6 +3960,19 @@ def dump_traces_to_stdout(traces):
         if i + 1 < len(traces):
             sys.stdout.write('\n')
 
+def value_has_changed(src_value, dest_value):
+    """
+    Should a note report a change from src_value to dest_value?
+
+    ConcreteValue instances are compared by value, ignoring where they came
+    from, so that e.g. clearing an exception state that is already NULL
+    isn't reported as a change
+    """
+    if (isinstance(src_value, ConcreteValue)
+        and isinstance(dest_value, ConcreteValue)):
+        return src_value.value != dest_value.value
+    return src_value != dest_value
+
 class DebugAnnotator(Annotator):
     """
     Annotate a trace with copious debug information
@@ -3927,7 +4000,7 @@ class DebugAnnotator(Annotator):
             dest_value = transition.dest.value_for_region[region]
             if region in transition.src.value_for_region:
                 src_value = transition.src.value_for_region[region]
-                if dest_value != src_value:
+                if value_has_changed(src_value, dest_value):
                     result.append(Note(loc,
                                        ('%s now has value: %s'
                                         % (region, dest_value))))
@@ -4016,7 +4089,8 @@ class ExceptionStateAnnotator(Annotator):
         result = []
 
         if hasattr(transition.dest, 'cpython'):
-            if transition.dest.cpython.exception_rvalue != transition.src.cpython.exception_rvalue:
+            if value_has_changed(transition.src.cpython.exception_rvalue,
+                                 transition.dest.cpython.exception_rvalue):
                 result.append(Note(loc,
                                    ('thread-local exception state now has value: %s'
                                     % transition.dest.cpython.exception_rvalue)))
@@ -4205,9 +4279,123 @@ def make_stmt_graph(fun):
     stmtgraph = StmtGraph(fun, False, omit_complex_edges=True)
     return stmtgraph
 
+def describe_exceeded_limit(limits):
+    """
+    Get the text of the note to emit when the analysis of a function is
+    stopped early
+    """
+    if limits.exceeded == 'time':
+        return ('analysis of this function by the reference-count checker'
+                ' was stopped after %g seconds: not all paths were analyzed'
+                % limits.maxtime)
+    elif limits.exceeded == 'memory':
+        return ('analysis of this function by the reference-count checker'
+                ' was stopped after using %i MB of memory: not all paths'
+                ' were analyzed'
+                % (limits.maxmem // 1024))
+    elif limits.exceeded == 'deadline':
+        return ('the time budget of the reference-count checker for this'
+                ' translation unit ran out whilst analyzing this function:'
+                ' not all paths were analyzed')
+    else:
+        return ('this function is too complicated for the reference-count'
+                ' checker to fully analyze: not all paths were analyzed')
+
+def record_function_stats(stats_file, fun, stats):
+    """
+    Append a line of JSON to stats_file, giving the resources used when
+    analyzing the given function, so that the slow ones can be found
+    """
+    import json
+    record = OrderedDict([('file', fun.start.file),
+                          ('function', fun.decl.name),
+                          ('line', fun.start.line)])
+    record.update(stats)
+    # Many compiler processes may be appending to the same file; write
+    # each record as a single line in a single call:
+    with open(stats_file, 'a') as f:
+        f.write(json.dumps(record) + '\n')
+
+def check_trace(fun, trace, i, rep, show_possible_null_derefs):
+    """
+    Check one complete trace through the function, adding any reports
+    to the Reporter
+    """
+    trace.log(log, 'TRACE %i' % i)
+    if trace.err:
+        # This trace bails early with a fatal error; it probably doesn't
+        # have a return value
+        log('trace.err: %s %r', trace.err, trace.err)
+
+        # Unless explicitly enabled, don't report on NULL pointer
+        # dereferences that are only possible, not definite: it may be
+        # that there are invariants that we know nothing about that mean
+        # that they can't happen:
+        # (similarly for arithmetic issues e.g. negative shift, divide by
+        # zero, etc)
+        if isinstance(trace.err, (NullPtrDereference, NullPtrArgument,
+                                  PredictedArithmeticError)):
+            if not trace.err.isdefinite:
+                if not show_possible_null_derefs:
+                    return
+
+        w = rep.make_warning(fun, trace.err.loc, str(trace.err))
+        w.add_trace(trace)
+        if hasattr(trace.err, 'why'):
+            if trace.err.why:
+                w.add_note(trace.err.loc,
+                           trace.err.why)
+        # FIXME: in our example this ought to mention where the values came from
+        return
+    # Otherwise, the trace proceeds normally
+    v_return = trace.return_value()
+    log('trace.return_value(): %s', trace.return_value())
+
+    # Ideally, we should "own" exactly one reference, and it should be
+    # the return value.  Anything else is an error (and there are other
+    # kinds of error...)
+
+    # Locate all PyObject that we touched
+    endstate = trace.states[-1]
+    endstate.log(log)
+    log('return_value: %r', v_return)
+    log('endstate.region_for_var: %r', endstate.region_for_var)
+    log('endstate.value_for_region: %r', endstate.value_for_region)
+
+    if endstate.not_returning:
+        # We have a function that calls exit() or abort() or similar
+        # Don't bother reporting reference leaks etc: the process is
+        # going away
+        return
+
+    # Check the refcount of all Python objects we know about:
+    if hasattr(endstate, 'cpython'):
+        for r_obj, v_ob_refcnt in endstate.cpython.iter_python_refcounts():
+            check_refcount_for_one_object(r_obj, v_ob_refcnt, v_return,
+                                          trace, endstate, fun, rep)
+
+    # Detect returning a deallocated object:
+    if v_return:
+        if isinstance(v_return, PointerToRegion):
+            rvalue = endstate.value_for_region.get(v_return.region, None)
+            if isinstance(rvalue, DeallocatedMemory):
+                w = rep.make_warning(fun,
+                                     endstate.get_gcc_loc(fun),
+                                     'returning pointer to deallocated memory')
+                w.add_trace(trace)
+                w.add_note(rvalue.loc,
+                           'memory deallocated here')
+
+    warn_about_NULL_without_exception(v_return,
+                                      trace, endstate, fun, rep)
+
 def impl_check_refcounts(fun, dump_traces=False,
                          show_possible_null_derefs=False,
-                         maxtrans=256):
+                         maxtrans=256,
+                         record_summary=False,
+                         limits=None,
+                         profile=None,
+                         widen_loops=False):
     """
     Inner implementation of the refcount checker, checking the refcounting
     behavior of a function, returning a Reporter instance.
@@ -4219,6 +4407,17 @@ def impl_check_refcounts(fun, dump_traces=False,
 
     dump_traces: bool: if True, dump information about the traces through
     the function to stdout (for self tests)
+
+    record_summary: bool: if True, record a RefcountSummary for the function,
+    for use when checking its callers (see summaries.py)
+
+    limits: a Limits instance, for budgets other than maxtrans (which is
+    ignored if this is supplied)
+
+    profile: a profiling.FunctionProfile instance to be filled in, or None
+
+    widen_loops: bool: if True, follow loops until the states within them
+    reach a fixpoint, rather than abandoning paths that go around a loop
     """
     # Abstract interpretation:
     # Walk the CFG, gathering the information we're interested in
@@ -4234,117 +4433,87 @@ def impl_check_refcounts(fun, dump_traces=False,
     if get_PyObject():
         facets['cpython'] = CPython
 
-    limits=Limits(maxtrans=maxtrans)
+    if limits is None:
+        limits = Limits(maxtrans=maxtrans)
 
+    if profile:
+        start = time.time()
     stmtgraph = make_stmt_graph(fun)
+    if profile:
+        profile.stmtgraph_secs = time.time() - start
     if 0:
         dot = stmtgraph.to_dot('foo')
         from gccutils import invoke_dot
         invoke_dot(dot)
 
+    # Only hold onto every trace if something needs the full list; otherwise
+    # each trace is released once it has been checked, unless a report
+    # refers to it:
+    need_all_traces = (dump_traces
+                       or (record_summary and 'cpython' in facets))
+    all_traces = []
+
+    rep = Reporter()
+    # The position (see generate_traces) of the trace behind each report:
+    report_positions = []
+
+    # Check each trace as it is completed, adding reports to the Reporter:
+    gen = generate_traces(stmtgraph,
+                          facets,
+                          limits=limits,
+                          widening=widen_loops)
     try:
-        traces = iter_traces(stmtgraph,
-                             facets,
-                             limits=limits)
+        for i, (position, trace) in enumerate(gen):
+            if need_all_traces:
+                all_traces.append((position, trace))
+            if profile:
+                profile.on_trace(trace)
+            check_trace(fun, trace, i, rep, show_possible_null_derefs)
+            while len(report_positions) < len(rep.reports):
+                report_positions.append(position)
     except TooComplicated:
         err = sys.exc_info()[1]
-        gcc.inform(fun.start,
-                   'this function is too complicated for the reference-count checker to fully analyze: not all paths were analyzed')
-        traces = err.complete_traces
+        gcc.inform(fun.start, describe_exceeded_limit(limits))
+        # Put the reports (and traces) into the order they had when the
+        # partial results were gathered into lists, so that the same reports
+        # survive the removal of duplicates:
+        key = lambda position: get_partial_order_key(position, err.position)
+        order = sorted(range(len(rep.reports)),
+                       key=lambda idx: key(report_positions[idx]))
+        rep.reports = [rep.reports[idx] for idx in order]
+        all_traces.sort(key=lambda item: key(item[0]))
+        traces = [trace for position, trace in all_traces]
+    else:
+        traces = [trace for position, trace in all_traces]
+        # Only summarize functions for which we saw every path:
+        if record_summary and 'cpython' in facets:
+            from libcpychecker.summaries import record_summary
+            record_summary(fun, traces)
+    del all_traces
+
+    if profile:
+        profile.on_limits(limits)
 
     if dump_traces:
-        traces = list(traces)
         dump_traces_to_stdout(traces)
 
-    # Debug dump of all traces in HTML form:
+    # Debug dump of all traces in HTML form (needs need_all_traces):
     if 0:
         filename = ('%s.%s-refcount-traces.html'
                     % (gcc.get_dump_base_name(), fun.decl.name))
-        rep = Reporter()
+        debug_rep = Reporter()
         for i, trace in enumerate(traces):
             endstate = trace.states[-1]
-            r = rep.make_debug_dump(fun,
-                                    endstate.get_gcc_loc(fun),
-                                    'Debug dump of trace %i' % i)
+            r = debug_rep.make_debug_dump(fun,
+                                          endstate.get_gcc_loc(fun),
+                                          'Debug dump of trace %i' % i)
             r.add_trace(trace, DebugAnnotator())
-        rep.dump_html(fun, filename)
-        rep.flush()
+        debug_rep.dump_html(fun, filename)
+        debug_rep.flush()
         gcc.inform(fun.start,
                    ('graphical debug report for function %r written out to %r'
                     % (fun.decl.name, filename)))
 
-    rep = Reporter()
-
-    # Iterate through all traces, adding reports to the Reporter:
-    for i, trace in enumerate(traces):
-        trace.log(log, 'TRACE %i' % i)
-        if trace.err:
-            # This trace bails early with a fatal error; it probably doesn't
-            # have a return value
-            log('trace.err: %s %r', trace.err, trace.err)
-
-            # Unless explicitly enabled, don't report on NULL pointer
-            # dereferences that are only possible, not definite: it may be
-            # that there are invariants that we know nothing about that mean
-            # that they can't happen:
-            # (similarly for arithmetic issues e.g. negative shift, divide by
-            # zero, etc)
-            if isinstance(trace.err, (NullPtrDereference, NullPtrArgument,
-                                      PredictedArithmeticError)):
-                if not trace.err.isdefinite:
-                    if not show_possible_null_derefs:
-                        continue
-
-            w = rep.make_warning(fun, trace.err.loc, str(trace.err))
-            w.add_trace(trace)
-            if hasattr(trace.err, 'why'):
-                if trace.err.why:
-                    w.add_note(trace.err.loc,
-                               trace.err.why)
-            # FIXME: in our example this ought to mention where the values came from
-            continue
-        # Otherwise, the trace proceeds normally
-        v_return = trace.return_value()
-        log('trace.return_value(): %s', trace.return_value())
-
-        # Ideally, we should "own" exactly one reference, and it should be
-        # the return value.  Anything else is an error (and there are other
-        # kinds of error...)
-
-        # Locate all PyObject that we touched
-        endstate = trace.states[-1]
-        endstate.log(log)
-        log('return_value: %r', v_return)
-        log('endstate.region_for_var: %r', endstate.region_for_var)
-        log('endstate.value_for_region: %r', endstate.value_for_region)
-
-        if endstate.not_returning:
-            # We have a function that calls exit() or abort() or similar
-            # Don't bother reporting reference leaks etc: the process is
-            # going away
-            continue
-
-        # Check the refcount of all Python objects we know about:
-        if hasattr(endstate, 'cpython'):
-            for r_obj, v_ob_refcnt in endstate.cpython.iter_python_refcounts():
-                check_refcount_for_one_object(r_obj, v_ob_refcnt, v_return,
-                                              trace, endstate, fun, rep)
-
-        # Detect returning a deallocated object:
-        if v_return:
-            if isinstance(v_return, PointerToRegion):
-                rvalue = endstate.value_for_region.get(v_return.region, None)
-                if isinstance(rvalue, DeallocatedMemory):
-                    w = rep.make_warning(fun,
-                                         endstate.get_gcc_loc(fun),
-                                         'returning pointer to deallocated memory')
-                    w.add_trace(trace)
-                    w.add_note(rvalue.loc,
-                               'memory deallocated here')
-
-        warn_about_NULL_without_exception(v_return,
-                                          trace, endstate, fun, rep)
-
     # (all traces analysed)
 
     return rep
@@ -4354,7 +4523,14 @@ def check_refcounts(fun, dump_traces=False, show_traces=False,
                     show_possible_null_derefs=False,
                     show_timings=False,
                     maxtrans=256,
-                    dump_json=False):
+                    dump_json=False,
+                    record_summary=False,
+                    maxtime=None,
+                    maxmem=None,
+                    deadline=None,
+                    stats_file=None,
+                    profile_file=None,
+                    widen_loops=False):
     """
     The top-level function of the refcount checker, checking the refcounting
     behavior of a function
@@ -4367,6 +4543,28 @@ def check_refcounts(fun, dump_traces=False, show_traces=False,
     show_traces: bool: if True, display a diagram of the state transition graph
 
     show_timings: bool: if True, add timing information to stderr
+
+    record_summary: bool: if True, record a summary of the function's
+    behavior, for use when checking its callers
+
+    maxtime: float: if set, the maximum number of seconds of wall time to
+    spend analyzing the function
+
+    maxmem: int: if set, the maximum number of megabytes by which the
+    compiler process may grow whilst analyzing the function
+
+    deadline: float: if set, a time.time() value at which to stop, for
+    budgets that span the whole translation unit
+
+    stats_file: str: if set, the path of a file to which to append a line
+    of JSON giving the resources used when analyzing the function
+
+    profile_file: str: if set, the path of a file to which to append a line
+    of JSON profiling the analysis of the function (see profiling.py)
+
+    widen_loops: bool: if True, summarize loops by widening the values
+    within them until they reach a fixpoint, rather than abandoning paths
+    that go around a loop
     """
 
     log('check_refcounts(%r, %r, %r)', fun, dump_traces, show_traces)
@@ -4374,28 +4572,50 @@ def check_refcounts(fun, dump_traces=False, show_traces=False,
     # show_timings = 1
 
     if show_timings:
-        import time
-        start_cpusecs = time.clock()
+        start_cpusecs = profiling.get_cpu_time()
         gcc.inform(fun.start, 'Analyzing reference-counting within %s' % fun.decl.name)
 
     if show_traces:
         from libcpychecker.visualizations import StateGraphPrettyPrinter
         sg = StateGraph(fun, log, MyState)
         sgpp = StateGraphPrettyPrinter(sg)
-        dot = sgpp.to_dot()
-        #dot = sgpp.extra_items()
-        # print(dot)
-        invoke_dot(dot)
-
-    rep = impl_check_refcounts(fun,
-                               dump_traces,
-                               show_possible_null_derefs,
-                               maxtrans)
+        # Stream the (potentially huge) graph directly to graphviz:
+        invoke_dot(sgpp.write_dot)
+
+    limits = Limits(maxtrans=maxtrans,
+                    maxtime=maxtime,
+                    maxmem=maxmem * 1024 if maxmem else None,
+                    deadline=deadline)
+    if profile_file:
+        profile = profiling.FunctionProfile(fun)
+        profiling.active_profile = profile
+    else:
+        profile = None
+    try:
+        rep = impl_check_refcounts(fun,
+                                   dump_traces,
+                                   show_possible_null_derefs,
+                                   maxtrans,
+                                   record_summary,
+                                   limits,
+                                   profile,
+                                   widen_loops)
+    finally:
+        profiling.active_profile = None
+        # The interned values can refer to this function's Regions, so don't
+        # let them outlive the analysis, even if it fails:
+        clear_interned_values()
+    rep.exceeded = limits.exceeded
 
     # Organize the Report instances into equivalence classes, simplifying
     # the list of reports:
     rep.remove_duplicates()
 
+    if profile:
+        profile.on_reports(rep)
+        profile.finish()
+        profile.write(profile_file)
+
     # Flush the reporter's messages, which will actually emit gcc errors and
     # warnings (if any), for those Report instances that survived
     # de-duplication
@@ -4411,6 +4631,13 @@ def check_refcounts(fun, dump_traces=False, show_traces=False,
         filename = ('%s.%s-refcount-errors.html'
                     % (gcc.get_dump_base_name(), fun.decl.name))
         rep.dump_html(fun, filename)
+
+        # Machine-readable summary of each report, for indexing the results
+        # of mass rebuilds:
+        rep.dump_records(fun,
+                         ('%s.%s-refcount-errors.jsonl'
+                          % (gcc.get_dump_base_name(), fun.decl.name)),
+                         filename)
         gcc.inform(fun.start,
                    ('graphical error report for function %r written out to %r'
                     % (fun.decl.name, filename)))
@@ -4427,8 +4654,14 @@ def check_refcounts(fun, dump_traces=False, show_traces=False,
         srcfile.close()
 
 
+    if stats_file:
+        stats = limits.get_stats()
+        stats['reports'] = len([r for r in rep.reports
+                                if not r.is_duplicate])
+        record_function_stats(stats_file, fun, stats)
+
     if show_timings:
-        end_cpusecs = time.clock()
+        end_cpusecs = profiling.get_cpu_time()
         gcc.inform(fun.start, 'Finished analyzing reference-counting within %s' % fun.decl.name)
         gcc.inform(fun.start,
                    ('%i transitions, %fs CPU'
@@ -0,0 +1,214 @@
+#   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2012 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+############################################################################
+# Interprocedural refcount summaries
+#
+# When the refcount checker is run from the IPA pass, functions are
+# analyzed bottom-up over the callgraph (callees before their callers).
+# After a function has been analyzed, its traces are condensed into a
+# RefcountSummary, recorded in summaries_by_key.  Functions are identified
+# as in the partition summaries (see gccutils.graph.partitions), so that
+# static functions with the same name in different source files don't
+# overwrite each other's summaries.
+#
+# When a later function calls one that has a summary, the summary is used
+# in place of the default assumptions made about unknown functions (that
+# they return a new reference or NULL with an exception set, and don't steal
+# references to their arguments).
+#
+# Explicit attributes (see attributes.py) take precedence over summaries.
+############################################################################
+
+import gcc
+
+from gccutils import check_isinstance
+from gccutils.graph.partitions import get_function_key
+from libcpychecker.absinterp import ConcreteValue, PointerToRegion
+
+class RefcountSummary(object):
+    """
+    What a function does, from the point of view of reference-counting, as
+    seen by its callers
+    """
+    __slots__ = ('fnname',
+                 'returns_borrowed_ref',
+                 'stolen_args',
+                 'can_return_NULL_with_exception')
+
+    def __init__(self, fnname, returns_borrowed_ref, stolen_args,
+                 can_return_NULL_with_exception):
+        self.fnname = fnname
+
+        # bool: does it return a borrowed reference (rather than a new one)?
+        self.returns_borrowed_ref = returns_borrowed_ref
+
+        # frozenset of 1-based argument indices (as per
+        # __attribute__((cpychecker_steals_reference_to_arg(n)))):
+        self.stolen_args = stolen_args
+
+        # bool: can it fail, returning NULL with an exception set?
+        self.can_return_NULL_with_exception = can_return_NULL_with_exception
+
+    def __repr__(self):
+        return ('RefcountSummary(fnname=%r, returns_borrowed_ref=%r,'
+                ' stolen_args=%r, can_return_NULL_with_exception=%r)'
+                % (self.fnname, self.returns_borrowed_ref,
+                   sorted(self.stolen_args),
+                   self.can_return_NULL_with_exception))
+
+    def to_json(self):
+        return dict(fnname=self.fnname,
+                    returns_borrowed_ref=self.returns_borrowed_ref,
+                    stolen_args=sorted(self.stolen_args),
+                    can_return_NULL_with_exception=
+                        self.can_return_NULL_with_exception)
+
+    @classmethod
+    def from_json(cls, js):
+        return cls(js['fnname'],
+                   js['returns_borrowed_ref'],
+                   frozenset(js['stolen_args']),
+                   js['can_return_NULL_with_exception'])
+
+# A dictionary mapping from the key of each function (as per
+# get_function_key) to RefcountSummary:
+summaries_by_key = {}
+
+# get_function_key needs the decl's assembler name, which is too costly to
+# look up afresh for every call on every trace, so cache the key of each
+# gcc.FunctionDecl:
+key_for_decl = {}
+
+def _get_key(fndecl):
+    key = key_for_decl.get(fndecl)
+    if key is None:
+        key = get_function_key(fndecl)
+        key_for_decl[fndecl] = key
+    return key
+
+def get_summary(fndecl):
+    """
+    Get the RefcountSummary for the given gcc.FunctionDecl, or None
+    """
+    check_isinstance(fndecl, gcc.FunctionDecl)
+    # This is called for every call within every trace, even when no
+    # summaries have been recorded (e.g. without --cpychecker-ipa):
+    if not summaries_by_key:
+        return None
+    return summaries_by_key.get(_get_key(fndecl))
+
+def set_summary(fndecl, summary):
+    check_isinstance(fndecl, gcc.FunctionDecl)
+    check_isinstance(summary, RefcountSummary)
+    summaries_by_key[_get_key(fndecl)] = summary
+
+def get_net_refcount(state, region):
+    """
+    Get the number of references to the given PyObject region owned by the
+    code being analyzed at the given State, relative to when the function
+    was entered, discounting those held by globals and heap-allocated
+    memory.
+
+    Returns None if nothing is known about the refcount.
+    """
+    from libcpychecker.refcounts import RefcountValue
+    if 'ob_refcnt' not in region.fields:
+        return None
+    v_ob_refcnt = state.get_value_of_field_by_region(region, 'ob_refcnt')
+    if not isinstance(v_ob_refcnt, RefcountValue):
+        return None
+    return (v_ob_refcnt.relvalue
+            - len(state.get_persistent_refs_for_region(region)))
+
+def make_summary(fun, traces):
+    """
+    Given a gcc.Function and a complete list of the Trace instances through
+    it, generate a RefcountSummary, or None if no trace returns normally
+    """
+    from libcpychecker.refcounts import type_is_pyobjptr_subclass
+    check_isinstance(fun, gcc.Function)
+
+    seen_return = False
+    seen_new_ref = False
+    seen_borrowed_ref = False
+    can_return_NULL = False
+
+    # Candidate stolen arguments, as a dict from 1-based index to the
+    # gcc.ParmDecl; these are whittled down by each trace:
+    candidates = {}
+    for i, parm in enumerate(fun.decl.arguments):
+        if type_is_pyobjptr_subclass(parm.type):
+            candidates[i + 1] = parm
+
+    for trace in traces:
+        if trace.err:
+            continue
+        endstate = trace.states[-1]
+        if not endstate.has_returned:
+            # Truncated at a loop, or calls exit() or similar:
+            continue
+        seen_return = True
+
+        v_return = trace.return_value()
+        r_return = None
+        if isinstance(v_return, ConcreteValue):
+            if v_return.value == 0:
+                can_return_NULL = True
+        elif isinstance(v_return, PointerToRegion):
+            r_return = v_return.region
+            net = get_net_refcount(endstate, r_return)
+            if net is not None:
+                if net >= 1:
+                    seen_new_ref = True
+                else:
+                    seen_borrowed_ref = True
+        else:
+            # We don't know what was returned; it could be NULL:
+            can_return_NULL = True
+
+        # An argument is stolen if every path through the function
+        # consumes a reference to it:
+        for argindex, parm in list(candidates.items()):
+            v_parm = trace.states[0].eval_rvalue(parm, None)
+            if not isinstance(v_parm, PointerToRegion):
+                del candidates[argindex]
+                continue
+            if v_parm.region == r_return:
+                del candidates[argindex]
+                continue
+            net = get_net_refcount(endstate, v_parm.region)
+            if net is None or net >= 0:
+                del candidates[argindex]
+
+    if not seen_return:
+        return None
+
+    # A function that's inconsistent about what it returns will have been
+    # reported on its own; keep the default assumption for its callers:
+    returns_borrowed_ref = seen_borrowed_ref and not seen_new_ref
+
+    return RefcountSummary(fun.decl.name,
+                           returns_borrowed_ref,
+                           frozenset(candidates.keys()),
+                           can_return_NULL)
+
+def record_summary(fun, traces):
+    summary = make_summary(fun, traces)
+    if summary:
+        set_summary(fun.decl, summary)
+    return summary
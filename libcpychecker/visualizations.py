@@ -15,6 +15,8 @@
 #   along with this program.  If not, see
 #   <http://www.gnu.org/licenses/>.
 
+from six import StringIO
+
 import gcc
 from gccutils import CfgPrettyPrinter, get_src_for_loc, check_isinstance
 
@@ -135,33 +137,38 @@ class StateGraphPrettyPrinter(StatePrettyPrinter):
 
     def extra_items(self):
         # Hook for expansion
-        result = ''
-        result += ' subgraph cluster_state_transitions {\n'
-        result += '  label="State Transitions";\n'
-        result += '  node [shape=box];\n'
+        out = StringIO()
+        self.write_extra_items(out)
+        return out.getvalue()
+
+    def write_extra_items(self, out):
+        # Stream the states and transitions, since there can be very many
+        # of them:
+        out.write(' subgraph cluster_state_transitions {\n')
+        out.write('  label="State Transitions";\n')
+        out.write('  node [shape=box];\n')
         for state in self.sg.states:
             prevstate = self.sg.get_prev_state(state)
-            result += ('  %s [label=<%s>];\n'
-                       % (self.state_id(state),
-                          self.state_to_dot_label(state, prevstate)))
+            out.write('  %s [label=<%s>];\n'
+                      % (self.state_id(state),
+                         self.state_to_dot_label(state, prevstate)))
 
-            #result += ('  %s -> %s:stmt%i;\n'
-            #           % (self.state_id(state),
-            #              self.block_id(state.loc.bb),
-            #              state.loc.idx))
+            #out.write('  %s -> %s:stmt%i;\n'
+            #          % (self.state_id(state),
+            #             self.block_id(state.loc.bb),
+            #             state.loc.idx))
 
         for transition in self.sg.transitions:
             if transition.desc:
                 attrliststr = '[label = "%s"]' % self.to_html(transition.desc)
             else:
                 attrliststr = ''
-            result += ('  %s -> %s %s;\n'
-                       % (self.state_id(transition.src),
-                          self.state_id(transition.dest),
-                          attrliststr))
+            out.write('  %s -> %s %s;\n'
+                      % (self.state_id(transition.src),
+                         self.state_id(transition.dest),
+                         attrliststr))
 
-        result += ' }\n';
-        return result
+        out.write(' }\n')
 
     #def to_dot(self):
     #    result = 'digraph {\n'
@@ -0,0 +1,87 @@
+#   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2012 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+# Benchmark of the attributes of the wrapper objects that are implemented
+# via the simplest gcc-c-api accessors, and of the garbage-collector's
+# marking of the wrapper objects.
+#
+# Run it via the plugin, e.g.:
+#   ./gcc-with-python misc/bench-attribute-access.py test.c
+#
+# To compare the "static inline" accessors with calls into libgcc-c-api.so,
+# run it with a plugin built with the default settings, and again with one
+# built via:
+#   make clean && make plugin INLINE_GCC_C_API=
+
+import time
+
+import gcc
+
+REPEATS = 100000
+NUM_GC_ITERATIONS = 20
+
+def timed(label, fn, *args):
+    start = time.time()
+    result = fn(*args)
+    print('%-40s %8.3fs' % (label, time.time() - start))
+    return result
+
+def get_block_indexes(blocks):
+    for i in range(REPEATS):
+        for bb in blocks:
+            bb.index
+
+def get_edge_flags(edges):
+    for i in range(REPEATS):
+        for e in edges:
+            e.true_value
+            e.false_value
+            e.loop_exit
+            e.can_fallthru
+            e.complex
+            e.eh
+
+def get_location_lines(locs):
+    for i in range(REPEATS):
+        for loc in locs:
+            loc.line
+
+def collect_garbage():
+    # Every wrapper object that's alive gets marked on each collection:
+    for i in range(NUM_GC_ITERATIONS):
+        gcc._force_garbage_collection()
+
+def on_pass_execution(p, fn):
+    if p.name != '*warn_function_return':
+        return
+    if not fn or not fn.cfg:
+        return
+
+    blocks = list(fn.cfg.basic_blocks)
+    edges = [e for bb in blocks for e in bb.succs]
+    locs = [stmt.loc for bb in blocks for stmt in (bb.gimple or [])
+            if stmt.loc]
+    print('%s: %i blocks, %i edges, %i locations'
+          % (fn.decl.name, len(blocks), len(edges), len(locs)))
+
+    timed('BasicBlock.index', get_block_indexes, blocks)
+    timed('Edge flags', get_edge_flags, edges)
+    timed('Location.line', get_location_lines, locs)
+    timed('_force_garbage_collection', collect_garbage)
+
+gcc.register_callback(gcc.PLUGIN_PASS_EXECUTION,
+                      on_pass_execution)
@@ -0,0 +1,68 @@
+#   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2012 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+# Benchmark of the algorithms on gccutils.graph.Graph, using a synthetic
+# graph of roughly a million edges.
+#
+# Run it via the plugin (gccutils imports the "gcc" module), e.g.:
+#   ./gcc-with-python misc/bench-graph-algorithms.py test.c
+
+import random
+import time
+
+from gccutils.graph import Graph, Node
+
+NUM_NODES = 200000
+EDGES_PER_NODE = 5
+
+def make_graph(seed=0):
+    """
+    Build a graph with a long backbone path (to give deep traversals),
+    plus random forward and backward edges (to give large cycles)
+    """
+    rng = random.Random(seed)
+    g = Graph()
+    nodes = [g.add_node(Node()) for i in range(NUM_NODES)]
+    for i in range(NUM_NODES - 1):
+        g.add_edge(nodes[i], nodes[i + 1])
+    for i in range(NUM_NODES):
+        for j in range(EDGES_PER_NODE - 1):
+            g.add_edge(nodes[i], nodes[rng.randrange(NUM_NODES)])
+    return g, nodes
+
+def timed(label, fn, *args):
+    start = time.time()
+    result = fn(*args)
+    print('%-40s %8.3fs' % (label, time.time() - start))
+    return result
+
+def main():
+    g, nodes = timed('building graph', make_graph)
+    print('%i nodes, %i edges' % (len(g.nodes), len(g.edges)))
+    timed('get_index', g.get_index)
+    timed('topologically_sorted_nodes', g.topologically_sorted_nodes)
+    sccs = timed('get_strongly_connected_components',
+                 g.get_strongly_connected_components)
+    print('  (%i components)' % len(sccs))
+    timed('get_immediate_dominators',
+          g.get_immediate_dominators, nodes[0])
+    timed('get_shortest_path (local query)',
+          g.get_shortest_path, nodes[1000], nodes[1003])
+    timed('get_shortest_path (whole graph)',
+          g.get_shortest_path, nodes[0], nodes[-1])
+
+main()
@@ -17,17 +17,31 @@
 
 # Walk a directory hierarchy looking for *-refcount-errors.html files,
 # building an index.html linking to them all
+#
+# Where the checker also wrote out a *-refcount-errors.jsonl file of records
+# alongside the HTML, that is used instead of scraping the HTML
 
 from collections import namedtuple
+import json
 import os
 import re
 
-from BeautifulSoup import BeautifulSoup
-
 from bugreporting import BugReportDb, Srpm
 
 class ErrorReport(namedtuple('ErrorReport',
                              ('htmlpath', 'htmlid', 'filename', 'function', 'errmsg', 'htmlpre'))):
+    @classmethod
+    def from_record(cls, recordpath, record):
+        # The text of the messages stands in for the marked-up source code,
+        # for the purposes of the heuristics below:
+        return cls(htmlpath=os.path.join(os.path.dirname(recordpath),
+                                         record['htmlpath']),
+                   htmlid=record['htmlid'],
+                   filename=record['filename'],
+                   function=record['function'],
+                   errmsg=record['errmsg'],
+                   htmlpre='\n'.join(record['messages']))
+
     def href(self):
         return '%s#%s' % (self.htmlpath, self.htmlid)
 
@@ -83,11 +97,45 @@ class ErrorReport(namedtuple('ErrorReport',
 
         return False
 
+def get_records_from_file(recordpath):
+    """
+    Read the records from a -refcount-errors.jsonl file, yielding a
+    sequence of dicts
+    """
+    with open(recordpath) as f:
+        for line in f:
+            if line.strip():
+                yield json.loads(line)
+
+def get_errors_from_records(recordpath):
+    """
+    Read a -refcount-errors.jsonl file, yielding a sequence of ErrorReport
+    """
+    for record in get_records_from_file(recordpath):
+        yield ErrorReport.from_record(recordpath, record)
+
+def get_records_path(htmlpath):
+    # Get the path of the records written alongside a -refcount-errors.html
+    # file:
+    assert htmlpath.endswith('.html')
+    return htmlpath[:-len('.html')] + '.jsonl'
+
+def get_errors(htmlpath):
+    """
+    Get the ErrorReport instances for a -refcount-errors.html file, using the
+    records file alongside it if there is one
+    """
+    recordpath = get_records_path(htmlpath)
+    if os.path.exists(recordpath):
+        return get_errors_from_records(recordpath)
+    return get_errors_from_file(htmlpath)
+
 def get_errors_from_file(htmlpath):
     """
     Scrape metadata from out of a -refcount-errors.html file,
     yielding a sequence of ErrorReport
     """
+    from BeautifulSoup import BeautifulSoup
     with open(htmlpath) as f:
         soup = BeautifulSoup(f)
         # Look within top-level <div> elements for result summaries that
@@ -355,7 +403,7 @@ class Index:
                     if filename.endswith('-refcount-errors.html'):
                         #print '  ', os.path.join(dirpath, filename)
                         htmlpath = os.path.join(dirpath, filename)
-                        for er in get_errors_from_file(htmlpath):
+                        for er in get_errors(htmlpath):
                             if er is None:
                                 continue
                             #print(er.filename)
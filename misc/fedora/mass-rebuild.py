@@ -141,13 +141,14 @@ def local_rebuild_of_srpm_in_mock(srpmpath, mockcfg):
     shutil.copy('/var/lib/mock/%s/result/build.log' % mockcfg,
                 resultdir)
 
-    # Scrape out *refcount-errors.html:
+    # Scrape out *refcount-errors.html, and the *refcount-errors.jsonl
+    # records alongside them (for use by resultsdb.py):
     BUILD_PREFIX='/builddir/build/BUILD'
     out, err = run_mock(['chroot',
-                         'find %s -name *-refcount-errors.html' % BUILD_PREFIX],
+                         'find %s -name *-refcount-errors.*' % BUILD_PREFIX],
                         captureOut=True)
     for line in out.splitlines():
-        if line.endswith('-refcount-errors.html'):
+        if line.endswith(('-refcount-errors.html', '-refcount-errors.jsonl')):
             # Convert from e.g.
             #    '/builddir/build/BUILD/gst-python-0.10.19/gst/.libs/gstmodule.c.init_gst-refcount-errors.html'
             # to:
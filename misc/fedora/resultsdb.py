@@ -0,0 +1,200 @@
+#   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2012 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+# Incremental index of the results of a mass rebuild, stored in an SQLite
+# database.
+#
+# Each result directory "LOGS/NAME-VERSION-RELEASE" is walked for
+# *-refcount-errors.html files; the reports within each are read (from the
+# *-refcount-errors.jsonl records written alongside it, or by scraping the
+# HTML for results from older versions of the checker), classified using
+# makeindex.Triager, and stored as rows of the "reports" table.
+#
+# Files are only re-read if their modification time has changed since they
+# were last indexed, so updating the index after rebuilding a few packages
+# is quick.
+#
+# Usage:
+#   python resultsdb.py [--db results.db] [LOGS]
+#   python resultsdb.py --query "SELECT srpm, COUNT(*) FROM reports
+#                                WHERE might_be_borrowed_ref GROUP BY srpm"
+
+import os
+import sqlite3
+import sys
+
+from makeindex import Triager, get_errors, get_records_from_file, \
+    get_records_path
+
+SCHEMA = '''
+CREATE TABLE IF NOT EXISTS files (
+    htmlpath TEXT PRIMARY KEY,
+    srpm TEXT,
+    mtime REAL
+);
+
+CREATE TABLE IF NOT EXISTS reports (
+    id INTEGER PRIMARY KEY,
+    srpm TEXT,
+    htmlpath TEXT,
+    htmlid TEXT,
+    filename TEXT,
+    function TEXT,
+    line INTEGER,
+    errmsg TEXT,
+    severity INTEGER,
+    severity_title TEXT,
+    might_be_borrowed_ref INTEGER,
+    contains_failure INTEGER,
+    is_within_initialization INTEGER
+);
+
+CREATE INDEX IF NOT EXISTS reports_by_srpm ON reports (srpm);
+CREATE INDEX IF NOT EXISTS reports_by_function ON reports (function);
+CREATE INDEX IF NOT EXISTS reports_by_severity ON reports (severity);
+CREATE INDEX IF NOT EXISTS reports_by_location ON reports (filename, line);
+CREATE INDEX IF NOT EXISTS reports_by_htmlpath ON reports (htmlpath);
+'''
+
+class ResultsDb:
+    def __init__(self, dbpath='results.db'):
+        self.conn = sqlite3.connect(dbpath)
+        self.conn.executescript(SCHEMA)
+        self.triager = Triager()
+
+    def close(self):
+        self.conn.close()
+
+    def update(self, logsdir='LOGS'):
+        """
+        Bring the index up-to-date with the result directories within
+        logsdir, returning the number of files that were (re)indexed
+        """
+        num_indexed = 0
+        seen = set()
+        for resultdir in sorted(os.listdir(logsdir)):
+            srpm = resultdir
+            resultpath = os.path.join(logsdir, resultdir)
+            for dirpath, dirnames, filenames in os.walk(resultpath):
+                for filename in filenames:
+                    if filename.endswith('-refcount-errors.html'):
+                        htmlpath = os.path.join(dirpath, filename)
+                        seen.add(htmlpath)
+                        if self._update_file(srpm, htmlpath):
+                            num_indexed += 1
+
+        # Purge files that have gone away (e.g. a package was rebuilt):
+        for (htmlpath, ) in self.conn.execute('SELECT htmlpath FROM files').fetchall():
+            if htmlpath not in seen:
+                self._remove_file(htmlpath)
+
+        self.conn.commit()
+        return num_indexed
+
+    def _get_mtime(self, htmlpath):
+        # The records file is written after the HTML, so use it when present:
+        recordpath = get_records_path(htmlpath)
+        if os.path.exists(recordpath):
+            return os.path.getmtime(recordpath)
+        return os.path.getmtime(htmlpath)
+
+    def _update_file(self, srpm, htmlpath):
+        mtime = self._get_mtime(htmlpath)
+        row = self.conn.execute('SELECT mtime FROM files WHERE htmlpath = ?',
+                                (htmlpath, )).fetchone()
+        if row and row[0] == mtime:
+            # Unchanged:
+            return False
+
+        self._remove_file(htmlpath)
+        self._add_reports(srpm, htmlpath)
+        self.conn.execute('INSERT INTO files (htmlpath, srpm, mtime)'
+                          ' VALUES (?, ?, ?)',
+                          (htmlpath, srpm, mtime))
+        return True
+
+    def _remove_file(self, htmlpath):
+        self.conn.execute('DELETE FROM reports WHERE htmlpath = ?',
+                          (htmlpath, ))
+        self.conn.execute('DELETE FROM files WHERE htmlpath = ?',
+                          (htmlpath, ))
+
+    def _add_reports(self, srpm, htmlpath):
+        # Line numbers are only available from the records:
+        record_lines = {}
+        recordpath = get_records_path(htmlpath)
+        if os.path.exists(recordpath):
+            for record in get_records_from_file(recordpath):
+                record_lines[record['htmlid']] = record['line']
+
+        for er in get_errors(htmlpath):
+            if er is None:
+                continue
+            sev = self.triager.classify(er)
+            self.conn.execute('INSERT INTO reports (srpm, htmlpath, htmlid,'
+                              '   filename, function, line, errmsg,'
+                              '   severity, severity_title,'
+                              '   might_be_borrowed_ref, contains_failure,'
+                              '   is_within_initialization)'
+                              ' VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)',
+                              (srpm, htmlpath, er.htmlid,
+                               er.filename, er.function,
+                               record_lines.get(er.htmlid),
+                               er.errmsg,
+                               sev.priority, sev.title,
+                               er.might_be_borrowed_ref(),
+                               er.contains_failure(),
+                               er.is_within_initialization()))
+
+    def query(self, sql, params=()):
+        return self.conn.execute(sql, params).fetchall()
+
+    def iter_srpm_summary(self):
+        """
+        Yield (srpm, severity_title, count) triples, most severe first
+        """
+        for row in self.conn.execute('SELECT srpm, severity_title, COUNT(*)'
+                                     ' FROM reports'
+                                     ' GROUP BY srpm, severity'
+                                     ' ORDER BY srpm, severity DESC'):
+            yield row
+
+def main(argv):
+    import argparse
+    parser = argparse.ArgumentParser(
+        description='Index the results of a mass rebuild in an SQLite database')
+    parser.add_argument('--db', default='results.db',
+                        help='path to the database (default: results.db)')
+    parser.add_argument('--query',
+                        help='run the given SQL query after updating the index')
+    parser.add_argument('logsdir', nargs='?', default='LOGS',
+                        help='directory of per-SRPM results (default: LOGS)')
+    ns = parser.parse_args(argv[1:])
+
+    db = ResultsDb(ns.db)
+    num_indexed = db.update(ns.logsdir)
+    print('%i file(s) (re)indexed' % num_indexed)
+    if ns.query:
+        for row in db.query(ns.query):
+            print('\t'.join([str(col) for col in row]))
+    else:
+        for srpm, title, count in db.iter_srpm_summary():
+            print('%s\t%s\t%i' % (srpm, title, count))
+    db.close()
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
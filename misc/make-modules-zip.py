@@ -0,0 +1,55 @@
+#   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2012 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+# Build a zipfile of precompiled bytecode for the Python packages that ship
+# with the plugin, for use as "PLUGIN_NAME-modules.zip" alongside the
+# plugin's DSO.
+#
+# The plugin puts such a file onto sys.path ahead of the plugin's directory,
+# so that each invocation of the compiler imports gccutils and libcpychecker
+# from a single archive, rather than stat()-ing and reading many small
+# files (and potentially recompiling them, if the .pyc files can't be
+# written).
+#
+# This needs to be run with the same Python that the plugin is linked
+# against, so that the bytecode matches.
+#
+# Usage:
+#   python make-modules-zip.py OUTPUT.zip PACKAGE_DIR [PACKAGE_DIR...]
+
+import os
+import sys
+import zipfile
+
+def make_modules_zip(outpath, pkgdirs):
+    # Write to a temporary file and rename it into place, so that a
+    # concurrent compilation never sees a partially-written archive:
+    tmppath = outpath + '.tmp'
+    zf = zipfile.PyZipFile(tmppath, 'w', zipfile.ZIP_STORED)
+    try:
+        for pkgdir in pkgdirs:
+            zf.writepy(os.path.normpath(pkgdir))
+    finally:
+        zf.close()
+    os.rename(tmppath, outpath)
+
+if __name__ == '__main__':
+    if len(sys.argv) < 3:
+        sys.stderr.write('usage: %s OUTPUT.zip PACKAGE_DIR [PACKAGE_DIR...]\n'
+                         % sys.argv[0])
+        sys.exit(1)
+    make_modules_zip(sys.argv[1], sys.argv[2:])
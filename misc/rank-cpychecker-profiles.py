@@ -0,0 +1,116 @@
+#   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2012 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+# Rank the functions that were most expensive for the refcount checker to
+# analyze, across a whole build, using the "*.cpychecker-profile.jsonl"
+# files written by "gcc-with-cpychecker --cpychecker-profile" (one per
+# translation unit; see libcpychecker/profiling.py).
+#
+# Also totals up the time spent within each of the "impl_" handlers for the
+# functions of the CPython API, to show which are worth optimizing.
+#
+# Usage:
+#   python rank-cpychecker-profiles.py [--top N] [--sort KEY] PATH [PATH...]
+# where each PATH is either a profile file, or a directory to be searched
+# for them.
+
+from __future__ import print_function
+
+import json
+import os
+import sys
+
+SUFFIX = '.cpychecker-profile.jsonl'
+
+def iter_profile_paths(paths):
+    for path in paths:
+        if os.path.isdir(path):
+            for dirpath, dirnames, filenames in os.walk(path):
+                for filename in sorted(filenames):
+                    if filename.endswith(SUFFIX):
+                        yield os.path.join(dirpath, filename)
+        else:
+            yield path
+
+def iter_records(paths):
+    for path in iter_profile_paths(paths):
+        with open(path) as f:
+            for line in f:
+                line = line.strip()
+                if line:
+                    yield json.loads(line)
+
+def total_handlers(records):
+    """
+    Get a list of (methname, calls, seconds) triples, most expensive first
+    """
+    calls = {}
+    secs = {}
+    for record in records:
+        for methname, info in record['handlers'].items():
+            calls[methname] = calls.get(methname, 0) + info['calls']
+            secs[methname] = secs.get(methname, 0.0) + info['seconds']
+    return sorted([(methname, calls[methname], secs[methname])
+                   for methname in calls],
+                  key=lambda item: -item[2])
+
+def main(argv):
+    import argparse
+    parser = argparse.ArgumentParser(
+        description=('Rank the functions that were slowest for cpychecker'
+                     ' to analyze'))
+    parser.add_argument('--top', type=int, default=20,
+                        help='number of functions to show (default: 20)')
+    parser.add_argument('--sort', default='seconds',
+                        choices=('seconds', 'transitions', 'traces',
+                                 'max_depth', 'stmtgraph_seconds'),
+                        help='what to rank the functions by (default: seconds)')
+    parser.add_argument('paths', nargs='+',
+                        help='profile files, or directories containing them')
+    ns = parser.parse_args(argv[1:])
+
+    records = list(iter_records(ns.paths))
+    if not records:
+        print('no profiles found')
+        return 1
+
+    total_secs = sum([record['seconds'] for record in records])
+    print('%i function(s) analyzed in %.3fs' % (len(records), total_secs))
+    print()
+
+    print('%10s %8s %8s %6s %6s %-11s %s'
+          % ('seconds', 'trans', 'traces', 'depth', 'dedup', 'exceeded',
+             'function'))
+    records.sort(key=lambda record: -record[ns.sort])
+    for record in records[:ns.top]:
+        print('%10.3f %8i %8i %6i %6.2f %-11s %s:%i:%s'
+              % (record['seconds'],
+                 record['transitions'],
+                 record['traces'],
+                 record['max_depth'],
+                 record['dedup_ratio'],
+                 record['exceeded'] or '',
+                 record['file'], record['line'], record['function']))
+    print()
+
+    print('%10s %8s %s' % ('seconds', 'calls', 'handler'))
+    for methname, calls, secs in total_handlers(records)[:ns.top]:
+        print('%10.3f %8i %s' % (secs, calls, methname))
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
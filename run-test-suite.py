@@ -303,6 +303,10 @@ def run_test(testdir, srcdir):
 
     env = dict(os.environ)
     env['LC_ALL'] = 'C'
+    if options.fast:
+        # Run the embedded interpreter as if with -O, which puts the
+        # cpychecker into its "fast" mode:
+        env['PYTHONOPTIMIZE'] = '1'
 
     # Generate the command-line for invoking gcc:
     args = [CC]
@@ -437,6 +441,10 @@ parser.add_option("--srcdir",
 parser.add_option("-s", "--show",
                   action="store_true", dest="show", default=False,
                   help="Show stdout, stderr and the command line for each test")
+parser.add_option("--fast",
+                  action="store_true", dest="fast", default=False,
+                  help=("Run the plugin's Python code with -O (so that the"
+                        " cpychecker runs without its internal checks)"))
 (options, args) = parser.parse_args()
 
 if options.srcdir is None:
@@ -779,6 +787,11 @@ if GCC_VERSION < 6000:
 if GCC_VERSION < 6000:
     exclude_test('tests/plugin/rich-location')
 
+# loop structures are only preserved from CFG construction onwards by
+# GCC 4.9 and later:
+if GCC_VERSION < 4009:
+    exclude_test('tests/plugin/dominance')
+
 # compound locations are only supported for GCC 7 and later:
 if GCC_VERSION < 7000:
     exclude_test('tests/plugin/compound-locations')
@@ -205,6 +205,74 @@ struct PyExampleType {
         # Cleanup successful test runs:
         bm.cleanup()
 
+    def test_arg_parser(self):
+        # Verify the functions generated by PyArgParser
+        MODNAME = 'arg_parser'
+        sm = SimpleModule()
+
+        sm.cu.add_defn("""
+static PyObject *
+example_describe_impl(PyObject *self, const char *name, int count,
+                      PyObject *extra)
+{
+    return Py_BuildValue("siO", name, count, extra);
+}
+
+static PyObject *
+example_first_impl(PyObject *self, PyObject *seq)
+{
+    Py_INCREF(seq);
+    return seq;
+}
+""")
+        describe = PyArgParser('example_describe', 'describe',
+                               'example_describe_impl',
+                               [PyArg('name', 's'),
+                                PyArg('count', 'i'),
+                                PyArg('extra', 'O', default='Py_None')])
+        sm.cu.add_arg_parser(describe)
+        first = PyArgParser('example_first', 'first', 'example_first_impl',
+                            [PyArg('seq', 'O!', typeobj='PyList_Type')],
+                            keywords=False)
+        sm.cu.add_arg_parser(first)
+
+        methods = PyMethodTable('example_methods', [])
+        methods.add_parsed_method(describe, 'Describe something.')
+        methods.add_parsed_method(first, 'Return the given list.')
+        sm.cu.add_defn(methods.c_defn())
+
+        sm.add_module_init(MODNAME, modmethods=methods, moddoc='This is a doc string')
+
+        # Build the module:
+        bm = BuiltModule(sm)
+        bm.build(MODNAME)
+
+        # Verify that it built:
+        sys.path.append(bm.tmpdir)
+        import arg_parser
+        self.assertEqual(arg_parser.describe('foo', 3),
+                         ('foo', 3, None))
+        self.assertEqual(arg_parser.describe('foo', 3, 'bar'),
+                         ('foo', 3, 'bar'))
+        self.assertEqual(arg_parser.describe(count=3, name='foo', extra=[]),
+                         ('foo', 3, []))
+        self.assertEqual(arg_parser.describe('foo', extra=1, count=2),
+                         ('foo', 2, 1))
+        self.assertRaises(TypeError, arg_parser.describe, 'foo')
+        self.assertRaises(TypeError, arg_parser.describe, 'foo', 1, 2, 3)
+        self.assertRaises(TypeError, arg_parser.describe, 42, 1)
+        self.assertRaises(TypeError, arg_parser.describe, 'foo', 1.5)
+        self.assertRaises(TypeError, arg_parser.describe, 'foo', 1, bogus=2)
+        self.assertRaises(TypeError, arg_parser.describe, 'foo', 1, name='bar')
+        self.assertRaises(OverflowError, arg_parser.describe, 'foo', 2**40)
+
+        self.assertEqual(arg_parser.first([1, 2]), [1, 2])
+        self.assertRaises(TypeError, arg_parser.first, (1, 2))
+        self.assertRaises(TypeError, arg_parser.first, seq=[1, 2])
+
+        # Cleanup successful test runs:
+        bm.cleanup()
+
     def test_version_parsing(self):
         vi  = PyVersionInfo.from_text("sys.version_info(major=2, minor=7, micro=1, releaselevel='final', serial=0)")
         self.assertEqual(vi,
@@ -0,0 +1,80 @@
+/*
+   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+   Copyright 2012 Red Hat, Inc.
+
+   This is free software: you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see
+   <http://www.gnu.org/licenses/>.
+*/
+
+/*
+  The parsing of each format string is memoized (see
+  ParsedFormatString.parse); verify that a cached failure is reported at
+  every callsite, and that what's learned about an "O!" unit at one
+  callsite doesn't leak into the next one
+*/
+
+#include <Python.h>
+
+extern PyTypeObject *unknown_type_obj_ptr;
+
+PyObject *
+bogus_format_string_1(PyObject *self, PyObject *args)
+{
+    if (!PyArg_ParseTuple(args, "This is not a valid format string")) {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+PyObject *
+bogus_format_string_2(PyObject *self, PyObject *args)
+{
+    if (!PyArg_ParseTuple(args, "This is not a valid format string")) {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+PyObject *
+known_type_object(PyObject *self, PyObject *args)
+{
+    PyCodeObject *code_obj;
+
+    /* This is correct, PyCode_Type -> PyCodeObject */
+    if (!PyArg_ParseTuple(args, "O!", &PyCode_Type, &code_obj)) {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+PyObject *
+unknown_type_object(PyObject *self, PyObject *args)
+{
+    struct UnknownObject *unknown_obj;
+
+    /* This must report a warning, without reusing "PyCode_Type" from the
+       previous callsite: */
+    if (!PyArg_ParseTuple(args, "O!", unknown_type_obj_ptr, &unknown_obj)) {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+/*
+  PEP-7
+Local variables:
+c-basic-offset: 4
+indent-tabs-mode: nil
+End:
+*/
@@ -0,0 +1,50 @@
+#   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2012 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+import sys
+
+import gcc
+from libcpychecker import main
+from libcpychecker.formatstrings import FormatStringWarning
+from libcpychecker.PyArg_ParseTuple import PyArgParseFmt
+from gccutils.selftests import assertEqual
+
+main()
+
+def verify_format_string_cache():
+    # A parse failure is cached, but each lookup raises a fresh exception
+    # (rather than re-raising the same one, accumulating tracebacks):
+    excs = []
+    for i in range(2):
+        try:
+            PyArgParseFmt.parse('This is not a valid format string', False)
+        except FormatStringWarning:
+            excs.append(sys.exc_info()[1])
+    assertEqual(len(excs), 2)
+    assert excs[0] is not excs[1]
+    assertEqual(type(excs[0]), type(excs[1]))
+    assertEqual(str(excs[0]), str(excs[1]))
+
+    # A successful parse is cached, and reset on each lookup:
+    fmt = PyArgParseFmt.parse('O!', False)
+    unit = list(fmt.iter_exp_types())[0][0]
+    unit.typeobject = 'stale'
+    assert PyArgParseFmt.parse('O!', False) is fmt
+    assertEqual(unit.typeobject, None)
+
+gcc.register_callback(gcc.PLUGIN_FINISH_UNIT,
+                      verify_format_string_cache)
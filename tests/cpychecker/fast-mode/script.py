@@ -0,0 +1,38 @@
+#   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2012 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+# "run-test-suite.py --fast" runs the compiler with PYTHONOPTIMIZE=1 in the
+# environment; verify that this really does put the checker into its fast
+# mode (and that it's in strict mode otherwise)
+
+import os
+
+import libcpychecker
+from libcpychecker import absinterp, refcounts
+from gccutils import check_isinstance
+from gccutils.selftests import assertEqual
+
+# (as per CPython, a value of "0" doesn't turn optimization on)
+fast = os.environ.get('PYTHONOPTIMIZE', '0') not in ('', '0')
+
+assertEqual(absinterp.verify_states, not fast)
+for module in (absinterp, refcounts):
+    if fast:
+        assertEqual(module.check_isinstance,
+                    libcpychecker._skip_check_isinstance)
+    else:
+        assertEqual(module.check_isinstance, check_isinstance)
@@ -0,0 +1,49 @@
+/*
+   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+   Copyright 2012 Red Hat, Inc.
+
+   This is free software: you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see
+   <http://www.gnu.org/licenses/>.
+*/
+
+#include <Python.h>
+
+/*
+  Test of the LTO cache of the interprocedural mode of the refcount
+  checker, over a real link of two source files.
+
+  The functions are analyzed at link time, bottom-up over the callgraph of
+  the whole program: make_none() in input-helper.c is summarized as always
+  returning a new reference (never NULL), so the Py_DECREF() in test()
+  can't dereference NULL, even with show_possible_null_derefs enabled.
+*/
+
+extern PyObject *make_none(void);
+
+PyObject *
+test(PyObject *self, PyObject *args)
+{
+    PyObject *obj = make_none();
+    Py_DECREF(obj);
+
+    Py_RETURN_NONE;
+}
+
+/*
+  PEP-7
+Local variables:
+c-basic-offset: 4
+indent-tabs-mode: nil
+End:
+*/
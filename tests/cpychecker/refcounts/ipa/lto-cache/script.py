@@ -0,0 +1,72 @@
+# -*- coding: utf-8 -*-
+#   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2012 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+
+# Run the interprocedural mode of the refcount checker with an LTO cache,
+# then, within lto1, relink against the cache that it saved, showing its
+# keys and that every function's results can be reused
+
+import json
+import os
+import shutil
+import tempfile
+
+import gcc
+
+from gccutils import sorted_callgraph
+from gccutils.graph.partitions import get_function_key
+from libcpychecker import main
+from libcpychecker.ltocache import LtoCache
+
+# Each process (cc1 for each source file, then lto1) gets an empty cache
+# directory of its own, so that the link starts afresh:
+tmpdir = tempfile.mkdtemp()
+path = os.path.join(tmpdir, 'cache.json')
+
+main(verify_refcounting=True,
+     show_possible_null_derefs=True,
+     interprocedural=True,
+     lto_cache=path)
+
+class Relink(gcc.IpaPass):
+    # (registered after the checker's own pass, and so run after it)
+    def execute(self):
+        if not gcc.is_lto():
+            return
+        with open(path) as f:
+            js = json.load(f)
+        cache = LtoCache(path, js['config'])
+        # (ignoring any inline functions from the Python headers):
+        keys = []
+        for node in reversed(sorted_callgraph()):
+            fun = node.decl.function
+            if (fun and fun.cfg
+                and os.path.basename(fun.start.file).startswith('input-')):
+                key = get_function_key(fun.decl)
+                keys.append(key)
+                print('%s: %s'
+                      % (key,
+                         'reused' if cache.reuse(fun, node) else 'changed'))
+        print('saved: %s' % sorted([key for key in js['functions']
+                                    if key in keys]))
+
+ps = Relink(name='relink')
+ps.register_before('whole-program')
+
+def on_finish():
+    shutil.rmtree(tmpdir)
+
+gcc.register_callback(gcc.PLUGIN_FINISH, on_finish)
@@ -0,0 +1,51 @@
+/*
+   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+   Copyright 2012 Red Hat, Inc.
+
+   This is free software: you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see
+   <http://www.gnu.org/licenses/>.
+*/
+
+#include <Python.h>
+
+/*
+  Test of the interprocedural mode of the refcount checker: get_none() is
+  analyzed before test(), and is summarized as always returning a new
+  reference (never NULL).  Hence the Py_DECREF() in test() can't dereference
+  NULL, even with show_possible_null_derefs enabled.
+*/
+
+static PyObject *
+get_none(void)
+{
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+PyObject *
+test(PyObject *self, PyObject *args)
+{
+    PyObject *obj = get_none();
+    Py_DECREF(obj);
+
+    Py_RETURN_NONE;
+}
+
+/*
+  PEP-7
+Local variables:
+c-basic-offset: 4
+indent-tabs-mode: nil
+End:
+*/
@@ -0,0 +1,38 @@
+# -*- coding: utf-8 -*-
+#   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2012 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+import gcc
+
+from libcpychecker import main
+from libcpychecker.summaries import summaries_by_key
+
+main(verify_refcounting=True,
+     show_possible_null_derefs=True,
+     interprocedural=True)
+
+# Show the summaries that the IPA pass computed for the functions in
+# input.c (rather than any inline functions from the Python headers), and
+# their keys (the static function get_none() is prefixed by its source
+# file):
+def on_finish_unit():
+    for key in sorted(summaries_by_key):
+        summary = summaries_by_key[key]
+        if summary.fnname in ('get_none', 'test'):
+            print('%s: %r' % (key, summary))
+
+gcc.register_callback(gcc.PLUGIN_FINISH_UNIT, on_finish_unit)
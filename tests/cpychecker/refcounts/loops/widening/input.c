@@ -0,0 +1,70 @@
+/*
+   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+   Copyright 2012 Red Hat, Inc.
+
+   This is free software: you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see
+   <http://www.gnu.org/licenses/>.
+*/
+
+#include <Python.h>
+
+/*
+  Test of --cpychecker-widen-loops
+*/
+
+PyObject *
+counting_loop(PyObject *self, PyObject *args)
+{
+    int i;
+
+    /*
+      Only the counter changes between iterations; once it has been widened
+      the loop reaches a fixpoint, and the path leaving the loop is analyzed:
+    */
+    for (i = 0; i < 100; i++) {
+    }
+
+    Py_RETURN_NONE;
+}
+
+PyObject *
+incref_loop(PyObject *self, PyObject *args)
+{
+    int i;
+
+    /*
+      Each iteration adds a reference to Py_None, which is never widened,
+      so this loop never reaches a fixpoint; the analysis gives up after
+      Trace.MAX_WIDENINGS iterations:
+    */
+    for (i = 0; i < 100; i++) {
+        Py_INCREF(Py_None);
+    }
+
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef test_methods[] = {
+    {"counting_loop", counting_loop, METH_VARARGS, NULL},
+    {"incref_loop", incref_loop, METH_VARARGS, NULL},
+    {NULL, NULL, 0, NULL} /* Sentinel */
+};
+
+/*
+  PEP-7
+Local variables:
+c-basic-offset: 4
+indent-tabs-mode: nil
+End:
+*/
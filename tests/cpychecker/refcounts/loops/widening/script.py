@@ -0,0 +1,60 @@
+# -*- coding: utf-8 -*-
+#   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2012 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+# Verify the traces generated with and without loop widening, and that
+# a loop that never reaches a fixpoint is cut off at Trace.MAX_WIDENINGS
+
+import gcc
+from libcpychecker.absinterp import iter_traces, Limits, Trace
+from libcpychecker.refcounts import make_stmt_graph, CPython
+
+def get_returning_traces(fun, widening):
+    stmtgraph = make_stmt_graph(fun)
+    traces = iter_traces(stmtgraph,
+                         {'cpython':CPython},
+                         limits=Limits(maxtrans=1024),
+                         widening=widening)
+    return [trace for trace in traces
+            if trace.states[-1].has_returned]
+
+def get_max_widenings(traces):
+    result = 0
+    for trace in traces:
+        for count in trace.num_widenings.values():
+            assert count <= Trace.MAX_WIDENINGS
+            result = max(result, count)
+    return result
+
+def verify_traces(optpass, fun):
+    # Only run in one pass
+    if optpass.name == '*warn_function_return':
+        if fun:
+            print('%s:' % fun.decl.name)
+
+            traces = get_returning_traces(fun, widening=False)
+            print('  without widening: %i returning trace(s)' % len(traces))
+
+            traces = get_returning_traces(fun, widening=True)
+            print('  with widening: returns: %s' % (len(traces) > 0))
+            max_widenings = get_max_widenings(traces)
+            print('  with widening: widened: %s' % (max_widenings > 0))
+            print('  with widening: cut off: %s'
+                  % (max_widenings == Trace.MAX_WIDENINGS))
+
+gcc.register_callback(gcc.PLUGIN_PASS_EXECUTION,
+                      verify_traces)
@@ -25,9 +25,21 @@
 #   ┘ : U+2518 BOX DRAWINGS LIGHT UP AND LEFT
 # (the arrows are the greater than/less than and the letters A and V)
 
+import os
 import unittest
 
+from six import StringIO
+
 from gccutils.graph import Graph, Node, Edge
+from gccutils.graph.compact import CompactGraph
+from gccutils.graph.dataflow import DataflowProblem, Numbering, solve, \
+    FORWARD, BACKWARD
+from gccutils.graph.partitions import FunctionSummary, PartitionSummary, \
+    MergedSupergraph, MergedCallNode, find_partition_summaries
+from gccutils.graph.stmtgraph import StmtNode, EntryNode
+from gccutils.graph.supergraph import SupergraphNode, CallNode, ReturnNode, \
+    SupergraphEdge, CallToReturnSiteEdge, CallToStart, ExitToReturnSite
+from gccutils.graph.ivpgraph import IvpGraph
 
 class NamedNode(Node):
     def __init__(self, name=None):
@@ -102,6 +114,25 @@ class GraphTests(unittest.TestCase):
         self.assertEqual(len(g.nodes), LENGTH)
         dot = g.to_dot('example')
 
+    def test_write_dot(self):
+        LENGTH = 10
+        g = Graph()
+        first, last = add_long_path(g, LENGTH)
+        out = StringIO()
+        g.write_dot(out, 'example', cluster=False)
+        self.assertEqual(out.getvalue(), g.to_dot('example', cluster=False))
+        self.assertEqual(out.getvalue().count(' -> '), LENGTH)
+
+    def test_write_dot_with_budget(self):
+        LENGTH = 10
+        g = Graph()
+        first, last = add_long_path(g, LENGTH)
+        dot = g.to_dot('example', max_subgraph_nodes=4)
+        self.assertIn('(7 more nodes)', dot)
+        nodelines = [line for line in dot.splitlines()
+                     if '[label=<' in line and '->' not in line]
+        self.assertEqual(len(nodelines), 4)
+
 class PathfindingTests(unittest.TestCase):
     def test_no_path(self):
         g = Graph()
@@ -165,6 +196,465 @@ class PathfindingTests(unittest.TestCase):
         self.assertEqual(p1, be)
         self.assertEqual(p2, ef)
 
+class AlgorithmTests(unittest.TestCase):
+    def test_topological_sort(self):
+        #  a ─> b─┬─> c ─> d ─┬─> f
+        #         └─> e ──────┘
+        g, a, b, ab = make_trivial_graph()
+        c = g.add_node(NamedNode('c'))
+        d = g.add_node(NamedNode('d'))
+        e = g.add_node(NamedNode('e'))
+        f = g.add_node(NamedNode('f'))
+        g.add_edge(b, c)
+        g.add_edge(c, d)
+        g.add_edge(b, e)
+        g.add_edge(d, f)
+        g.add_edge(e, f)
+        result = g.topologically_sorted_nodes()
+        self.assertEqual(len(result), 6)
+        for edge in g.edges:
+            self.assertLess(result.index(edge.srcnode),
+                            result.index(edge.dstnode))
+
+    def test_topological_sort_of_deep_graph(self):
+        # Verify that we don't hit the recursion limit:
+        LENGTH = 100000
+        g = Graph()
+        first, last = add_long_path(g, LENGTH)
+        result = g.topologically_sorted_nodes()
+        self.assertEqual(len(result), LENGTH + 1)
+        self.assertEqual(result[0], first)
+        self.assertEqual(result[-1], last)
+
+    def test_topological_sort_of_sinkless_cycle(self):
+        #  a ─> b ─> c ┐
+        #        A     │
+        #        └─────┘
+        # (no node is without successors; all must still be listed)
+        g, a, b, ab = make_trivial_graph()
+        c = g.add_node(NamedNode('c'))
+        g.add_edge(b, c)
+        g.add_edge(c, b)
+        result = g.topologically_sorted_nodes()
+        self.assertEqual(sorted([node.name for node in result]),
+                         ['a', 'b', 'c'])
+        self.assertLess(result.index(a), result.index(b))
+
+        # Likewise for the callgraph's sort:
+        from gccutils import topological_sort
+        result = topological_sort(g.nodes,
+                                  get_srcs=lambda n: [e.srcnode
+                                                      for e in n.preds],
+                                  get_dsts=lambda n: [e.dstnode
+                                                      for e in n.succs])
+        self.assertEqual(sorted([node.name for node in result]),
+                         ['a', 'b', 'c'])
+        self.assertLess(result.index(a), result.index(b))
+
+    def test_strongly_connected_components(self):
+        g = Graph()
+        a = add_cycle(g, 5)
+        b = add_cycle(g, 3)
+        c = g.add_node(NamedNode('c'))
+        g.add_edge(a, b)
+        g.add_edge(b, c)
+        sccs = g.get_strongly_connected_components()
+        self.assertEqual(sorted([len(scc) for scc in sccs]), [1, 3, 5])
+        # Reverse topological order:
+        self.assertEqual(sccs[0], [c])
+        self.assertIn(b, sccs[1])
+        self.assertIn(a, sccs[2])
+
+    def test_dominators(self):
+        # Diamond, with a loop back from d to b:
+        #  a ─> b─┬─> c ─┬─> d ─> e
+        #    A    └─> f ─┘   │
+        #    └───────────────┘
+        g, a, b, ab = make_trivial_graph()
+        c = g.add_node(NamedNode('c'))
+        d = g.add_node(NamedNode('d'))
+        e = g.add_node(NamedNode('e'))
+        f = g.add_node(NamedNode('f'))
+        g.add_edge(b, c)
+        g.add_edge(b, f)
+        g.add_edge(c, d)
+        g.add_edge(f, d)
+        g.add_edge(d, b)
+        g.add_edge(d, e)
+        idoms = g.get_immediate_dominators(a)
+        self.assertEqual(idoms, {a: None, b: a, c: b, f: b, d: b, e: d})
+        ipdoms = g.get_immediate_postdominators(e)
+        self.assertEqual(ipdoms, {e: None, d: e, c: d, f: d, b: d, a: b})
+
+class NamedCompactGraph(CompactGraph):
+    node_fields = ('name', )
+
+class CompactGraphTests(unittest.TestCase):
+    def make_fork(self):
+        #  a ─> b─┬─> c ─> d ─┬─> f
+        #         └─> e ──────┘
+        g = NamedCompactGraph()
+        nodes = {}
+        for name in 'abcdef':
+            nodes[name] = g.add_node(NamedNode(name))
+        for src, dst in ('ab', 'bc', 'cd', 'be', 'df', 'ef'):
+            g.add_edge(nodes[src], nodes[dst])
+        return g, nodes
+
+    def test_views(self):
+        g, nodes = self.make_fork()
+        self.assertEqual(len(g.nodes), 6)
+        self.assertEqual(len(g.edges), 6)
+        a, b = nodes['a'], nodes['b']
+        self.assertIsInstance(a, NamedNode)
+        self.assertEqual(a.name, 'a')
+        self.assertIn(a, g.nodes)
+        # Views are created on demand, but compare equal:
+        succs = a.succs
+        self.assertEqual(len(succs), 1)
+        self.assertEqual(succs[0].srcnode, a)
+        self.assertEqual(succs[0].dstnode, b)
+        self.assertEqual(succs[0], b.preds[0])
+        self.assertEqual(set(g.nodes), set(nodes.values()))
+        dot = g.to_dot('example')
+
+    def test_algorithms(self):
+        g, nodes = self.make_fork()
+        path = g.get_shortest_path(nodes['a'], nodes['f'])
+        self.assertEqual([edge.dstnode.name for edge in path],
+                         ['b', 'e', 'f'])
+        result = [node.name for node in g.topologically_sorted_nodes()]
+        self.assertEqual(result[0], 'a')
+        self.assertEqual(result[-1], 'f')
+        idoms = g.get_immediate_dominators(nodes['a'])
+        self.assertEqual(idoms[nodes['f']], nodes['b'])
+        self.assertEqual(len(g.get_strongly_connected_components()), 6)
+
+class NamedDefsUses(DataflowProblem):
+    """
+    A problem in which each NamedNode defines and uses the variables listed
+    in the "defs" and "uses" dicts
+    """
+    def __init__(self, defs, uses):
+        self.vars = Numbering('xyz')
+        self.defs = defs
+        self.uses = uses
+
+    def get_bits(self, table, node):
+        return self.vars.get_bits(table.get(node.name, ''))
+
+class ReachingNames(NamedDefsUses):
+    # Which variables have been assigned to:
+    direction = FORWARD
+
+    def get_gen(self, node):
+        return self.get_bits(self.defs, node)
+
+class LiveNames(NamedDefsUses):
+    direction = BACKWARD
+
+    def get_gen(self, node):
+        return self.get_bits(self.uses, node)
+
+    def get_kill(self, node):
+        return self.get_bits(self.defs, node)
+
+class DataflowTests(unittest.TestCase):
+    def make_loop(self, cls=Graph):
+        #  a ─> b─┬─> c ─┬─> d ─> e
+        #    A    └─> f ─┘   │
+        #    └───────────────┘
+        g = cls()
+        nodes = {}
+        for name in 'abcdef':
+            nodes[name] = g.add_node(NamedNode(name))
+        for src, dst in ('ab', 'bc', 'bf', 'cd', 'fd', 'db', 'de'):
+            g.add_edge(nodes[src], nodes[dst])
+        return g, nodes
+
+    def test_forward(self):
+        g, nodes = self.make_loop()
+        problem = ReachingNames({'a': 'x', 'c': 'y', 'f': 'z'}, {})
+        result = solve(problem, g)
+        def names(node):
+            return ''.join(problem.vars.get_items(result.get_before(node)))
+        self.assertEqual(names(nodes['a']), '')
+        # The assignments within the loop reach its head via the back edge:
+        self.assertEqual(names(nodes['b']), 'xyz')
+        self.assertEqual(names(nodes['e']), 'xyz')
+        self.assertEqual(''.join(problem.vars.get_items(
+                    result.get_after(nodes['c']))), 'xyz')
+
+    def test_backward(self):
+        g, nodes = self.make_loop(NamedCompactGraph)
+        problem = LiveNames({'a': 'xy', 'c': 'y', 'f': 'z'},
+                            {'d': 'y', 'e': 'x', 'f': 'y'})
+        result = solve(problem, g)
+        def live(node):
+            return ''.join(problem.vars.get_items(result.get_before(node)))
+        self.assertEqual(live(nodes['a']), '')
+        self.assertEqual(live(nodes['b']), 'xy')
+        self.assertEqual(live(nodes['c']), 'x')
+        self.assertEqual(live(nodes['f']), 'xy')
+        self.assertEqual(live(nodes['e']), 'x')
+
+    def test_must_and_edges(self):
+        # Which variables are definitely assigned on every path, where the
+        # edge from d back to b also assigns to z:
+        class Assigned(ReachingNames):
+            may = False
+            refines_edges = True
+            def get_universe(self):
+                return self.vars.get_all_bits()
+            def transfer_edge(self, edge, bits):
+                if (edge.srcnode.name, edge.dstnode.name) == ('d', 'b'):
+                    return bits | self.vars.get_bit('z')
+                return bits
+        g, nodes = self.make_loop()
+        problem = Assigned({'a': 'x', 'c': 'y', 'f': 'z'}, {})
+        result = solve(problem, g)
+        def names(node):
+            return ''.join(problem.vars.get_items(result.get_before(node)))
+        self.assertEqual(names(nodes['b']), 'x')
+        self.assertEqual(names(nodes['d']), 'x')
+        self.assertEqual(names(nodes['e']), 'x')
+        # Nodes that the boundary value doesn't flow to keep the initial
+        # value:
+        result = solve(problem, g, boundary_nodes=[nodes['b']])
+        self.assertEqual(names(nodes['b']), '')
+        self.assertEqual(names(nodes['a']), 'xyz')
+
+class PartitionTests(unittest.TestCase):
+    def make_summaries(self):
+        # Two partitions: "main" calls "f" (in the other partition) and
+        # "puts" (not within the program), and "f" calls a static helper
+        # function:
+        main = FunctionSummary('main', 'main', 'a.c', True,
+                               [1, 2, 2, 3, 3, 4], 0, 5,
+                               [0, 1, 2, 3, 4, 5],
+                               [(1, 2, 'f'), (3, 4, 'puts')])
+        f = FunctionSummary('f', 'f', 'b.c', True,
+                            [1, 2, 2, 3], 0, 3,
+                            [0, 1, 2, 3],
+                            [(1, 2, 'b.c:helper')])
+        helper = FunctionSummary('b.c:helper', 'helper', 'b.c', False,
+                                 [5, 6], 0, 1,
+                                 [0, 1],
+                                 [])
+        return [PartitionSummary([main]), PartitionSummary([f, helper])]
+
+    def test_merge(self):
+        sg = MergedSupergraph(self.make_summaries())
+        self.assertEqual(sg.get_functions(), ['b.c:helper', 'f', 'main'])
+        self.assertEqual(len(sg.nodes), 13)
+        self.assertEqual(len(sg.edges), 15)
+        # The calls across partitions have been reconnected:
+        path = sg.get_shortest_path(sg.get_function_entry('main'),
+                                    sg.get_function_exit('b.c:helper'))
+        self.assertEqual([edge.__class__.__name__ for edge in path],
+                         ['MergedEdge', 'MergedCallToStart',
+                          'MergedEdge', 'MergedCallToStart',
+                          'MergedEdge'])
+        self.assertIsInstance(path[1].srcnode, MergedCallNode)
+        self.assertEqual(path[1].srcnode.function, 'main')
+        self.assertEqual(path[1].srcnode.line, 2)
+        # Only the non-static functions are entrypoints:
+        entry = list(sg.get_entry_nodes())[0]
+        self.assertEqual(sorted([edge.dstnode.function
+                                 for edge in entry.succs]),
+                         ['f', 'main'])
+        dot = sg.to_dot('example')
+
+    def test_promoted_statics(self):
+        # WPA renames static functions as it makes them public when moving
+        # them between partitions, so two "helper" functions from different
+        # source files have different keys:
+        a = FunctionSummary('helper.lto_priv.0', 'helper', 'a.c', True,
+                            [1, 2], 0, 1,
+                            [0, 1],
+                            [])
+        b = FunctionSummary('helper.lto_priv.1', 'helper', 'b.c', True,
+                            [5, 6, 7], 0, 2,
+                            [0, 1, 1, 2],
+                            [])
+        sg = MergedSupergraph([PartitionSummary([a]), PartitionSummary([b])])
+        self.assertEqual(sg.get_functions(),
+                         ['helper.lto_priv.0', 'helper.lto_priv.1'])
+        self.assertEqual(len(sg.nodes), 6)
+
+        # Different summaries with the same key are an error, rather than
+        # being taken for copies of an inline function:
+        c = FunctionSummary('helper.lto_priv.0', 'helper', 'b.c', True,
+                            [5, 6, 7], 0, 2,
+                            [0, 1, 1, 2],
+                            [])
+        with self.assertRaises(ValueError):
+            MergedSupergraph([PartitionSummary([a]), PartitionSummary([c])])
+
+    def test_round_trip(self):
+        import shutil
+        import tempfile
+        tmpdir = tempfile.mkdtemp()
+        try:
+            for i, summary in enumerate(self.make_summaries()):
+                summary.write(os.path.join(tmpdir,
+                                           'ltrans%i.supergraph.json' % i))
+            # The body of an inline function can be in several partitions:
+            PartitionSummary([self.make_summaries()[1].functions[0]]).write(
+                os.path.join(tmpdir, 'ltrans2.supergraph.json'))
+            paths = find_partition_summaries(tmpdir)
+            self.assertEqual(len(paths), 3)
+            sg = MergedSupergraph.from_files(paths)
+            self.assertEqual(len(sg.nodes), 13)
+            self.assertEqual(len(sg.edges), 15)
+        finally:
+            shutil.rmtree(tmpdir)
+
+class FakeFunction(object):
+    # Stands in for a gcc.Function (and its StmtGraph) within
+    # HandBuiltSupergraph
+    def __init__(self, name):
+        self.name = name
+        self.fun = self
+
+class HandBuiltSupergraph(Graph):
+    """
+    A supergraph built from the supergraph's node and edge classes, with
+    each function a chain of nodes, for testing IvpGraph without needing
+    real functions
+    """
+    def __init__(self):
+        Graph.__init__(self)
+        self.entries = {}
+        self.exits = {}
+        self.entrypoints = []
+
+    def _make_edge(self, srcnode, dstnode, cls):
+        return cls(srcnode, dstnode, None)
+
+    def add_function(self, name, numcalls):
+        """
+        Add a function: ENTRY, then a CallNode/ReturnNode pair per call,
+        then EXIT, returning the FakeFunction and the list of CallNodes
+        """
+        fun = FakeFunction(name)
+        def add_node(cls, label):
+            return self.add_node(cls(NamedNode('%s.%s' % (name, label)),
+                                     fun))
+        prev = self.entries[fun] = add_node(SupergraphNode, 'entry')
+        callnodes = []
+        for i in range(numcalls):
+            callnode = add_node(CallNode, 'call%i' % i)
+            callnode.returnnode = add_node(ReturnNode, 'return%i' % i)
+            self.add_edge(prev, callnode, SupergraphEdge)
+            self.add_edge(callnode, callnode.returnnode, CallToReturnSiteEdge)
+            callnodes.append(callnode)
+            prev = callnode.returnnode
+        self.exits[fun] = add_node(SupergraphNode, 'exit')
+        self.add_edge(prev, self.exits[fun], SupergraphEdge)
+        return fun, callnodes
+
+    def add_call(self, callnode, fun):
+        self.add_edge(callnode, self.entries[fun], CallToStart)
+        self.add_edge(self.exits[fun], callnode.returnnode, ExitToReturnSite)
+
+    def get_entry_nodes(self):
+        return [self.entries[fun] for fun in self.entrypoints]
+
+    def get_function_entry(self, fun):
+        return self.entries[fun]
+
+    def get_functions(self):
+        return list(self.entries)
+
+class IvpGraphTests(unittest.TestCase):
+    def make_supergraph(self):
+        # "main" calls "f" twice, and "f" calls "g":
+        sg = HandBuiltSupergraph()
+        main, (c1, c2) = sg.add_function('main', 2)
+        f, (cg, ) = sg.add_function('f', 1)
+        g, () = sg.add_function('g', 0)
+        sg.add_call(c1, f)
+        sg.add_call(c2, f)
+        sg.add_call(cg, g)
+        sg.entrypoints = [main]
+        return sg, main, f, g, c1, c2, cg
+
+    def describe(self, ivpnode):
+        # Get a (callstring, supernode) pair of names for the IvpNode:
+        return (tuple([str(callnode)
+                       for callnode in ivpnode.callstring.callnodes]),
+                str(ivpnode.innernode))
+
+    def get_succs(self, ivp, callnodes, supernode):
+        # Describe the successors of the IvpNode for the given callstring
+        # and supernode:
+        ivpnode = ivp.ivpnodes[(ivp.get_callstring(callnodes), supernode)]
+        return sorted([self.describe(edge.dstnode)
+                       for edge in ivpnode.succs])
+
+    def test_valid_paths(self):
+        sg, main, f, g, c1, c2, cg = self.make_supergraph()
+        ivp = IvpGraph(sg, 2)
+        # 6 nodes in main, 4 in f for each call of it, and 2 in g for each
+        # call of f:
+        self.assertEqual(len(ivp.nodes), 6 + 4 * 2 + 2 * 2)
+        # Returning from f only leads back to the caller on the stack:
+        self.assertEqual(self.get_succs(ivp, (c1, ), sg.exits[f]),
+                         [((), 'main.return0')])
+        self.assertEqual(self.get_succs(ivp, (c2, ), sg.exits[f]),
+                         [((), 'main.return1')])
+        self.assertEqual(self.get_succs(ivp, (c2, cg), sg.exits[g]),
+                         [(('main.call1', ), 'f.return0')])
+        self.assertEqual([str(node.innernode)
+                          for node in ivp.get_entry_nodes()],
+                         ['main.entry'])
+
+    def test_truncated_callstrings(self):
+        sg, main, f, g, c1, c2, cg = self.make_supergraph()
+        ivp = IvpGraph(sg, 1)
+        # The callstring within g loses the call of f:
+        self.assertEqual(len(ivp.nodes), 6 + 4 * 2 + 2)
+        # ...so returning from g leads to f for either call of f, but not
+        # to f with an empty callstring, since no such node exists:
+        self.assertEqual(self.get_succs(ivp, (cg, ), sg.exits[g]),
+                         [(('main.call0', ), 'f.return0'),
+                          (('main.call1', ), 'f.return0')])
+        # Callstrings are interned:
+        self.assertIs(ivp.get_callstring((c1, )),
+                      ivp.get_callstring((c1, )))
+        self.assertEqual(sorted([tuple([str(callnode)
+                                        for callnode in cs.callnodes])
+                                 for cs in ivp.all_callstrings]),
+                         [(), ('f.call0', ), ('main.call0', ),
+                          ('main.call1', )])
+
+    def test_functions(self):
+        # Only build the part of the graph reachable from "f":
+        sg, main, f, g, c1, c2, cg = self.make_supergraph()
+        ivp = IvpGraph(sg, 2, functions=[f])
+        self.assertEqual([str(node.innernode)
+                          for node in ivp.get_entry_nodes()],
+                         ['f.entry'])
+        self.assertEqual(sorted([self.describe(node) for node in ivp.nodes]),
+                         [((), 'f.call0'), ((), 'f.entry'),
+                          ((), 'f.exit'), ((), 'f.return0'),
+                          (('f.call0', ), 'g.entry'),
+                          (('f.call0', ), 'g.exit')])
+        # There's no caller on the stack to return to from f:
+        self.assertEqual(self.get_succs(ivp, (), sg.exits[f]), [])
+
+    def test_stmtless_nodes(self):
+        # Nodes without a statement (e.g. the ENTRY and EXIT of each
+        # function) are only equal to themselves:
+        a = EntryNode(None, 'bb0', None)
+        b = EntryNode(None, 'bb1', None)
+        self.assertEqual(a, a)
+        self.assertNotEqual(a, b)
+        self.assertEqual(len(set([a, b])), 2)
+        self.assertEqual(StmtNode(None, 'bb2', 'x = 1'),
+                         StmtNode(None, 'bb2', 'x = 1'))
+
 import sys
 sys.argv = ['foo', '-v']
 
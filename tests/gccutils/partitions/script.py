@@ -0,0 +1,93 @@
+#   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2012 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+# Verify that gccutils.graph.partitions can summarize real functions, both
+# from the callgraph (after the IPA passes), and one function at a time (as
+# within LTRANS), and merge the summaries into a supergraph
+
+import shutil
+import tempfile
+
+import gcc
+from gccutils.graph.partitions import SUFFIX, PartitionSummarizer, \
+    PartitionSummary, MergedSupergraph, find_partition_summaries, \
+    write_partition_summary
+
+tmpdir = tempfile.mkdtemp()
+summarizer = PartitionSummarizer(tempfile.mkdtemp())
+# This is cc1, so this one should ignore everything:
+lto_summarizer = PartitionSummarizer(tempfile.mkdtemp(), lto_only=True)
+from_callgraph = {}
+
+def describe(summary):
+    result = {}
+    for fs in summary.functions:
+        result[fs.key] = (fs.is_public,
+                          sorted([calleekey
+                                  for callidx, returnidx, calleekey
+                                  in fs.calls]))
+    return result
+
+def get_functions_along_path(path):
+    result = [path[0].srcnode.function]
+    for edge in path:
+        if edge.dstnode.function != result[-1]:
+            result.append(edge.dstnode.function)
+    return result
+
+def on_all_ipa_passes_end():
+    path = write_partition_summary(tmpdir)
+    assert path.endswith(SUFFIX)
+    paths = find_partition_summaries(tmpdir)
+    assert paths == [path]
+
+    summary = PartitionSummary.read(path)
+    from_callgraph.update(describe(summary))
+    for key in sorted(from_callgraph):
+        print('%s: public=%r calls=%r' % ((key, ) + from_callgraph[key]))
+
+    sg = MergedSupergraph.from_files(paths)
+    helper = [key for key in sg.get_functions() if key.endswith(':helper')][0]
+    path = sg.get_shortest_path(sg.get_function_entry('main'),
+                                sg.get_function_exit(helper))
+    print('path: %r' % get_functions_along_path(path))
+    entry = list(sg.get_entry_nodes())[0]
+    print('entrypoints: %r' % sorted([edge.dstnode.function
+                                      for edge in entry.succs]))
+    shutil.rmtree(tmpdir)
+
+def on_finish():
+    # Each function was summarized once, as it reached the per-function
+    # passes, with the same call sites as seen from the callgraph:
+    summarizer.on_finish()
+    assert summarizer.path.endswith(SUFFIX)
+    assert describe(PartitionSummary.read(summarizer.path)) == from_callgraph
+    shutil.rmtree(summarizer.dirname)
+
+    lto_summarizer.on_finish()
+    assert lto_summarizer.functions == []
+    assert lto_summarizer.path is None
+    shutil.rmtree(lto_summarizer.dirname)
+
+gcc.register_callback(gcc.PLUGIN_PASS_EXECUTION,
+                      summarizer.on_pass_execution)
+gcc.register_callback(gcc.PLUGIN_PASS_EXECUTION,
+                      lto_summarizer.on_pass_execution)
+gcc.register_callback(gcc.PLUGIN_ALL_IPA_PASSES_END,
+                      on_all_ipa_passes_end)
+gcc.register_callback(gcc.PLUGIN_FINISH,
+                      on_finish)
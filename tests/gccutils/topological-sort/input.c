@@ -31,6 +31,9 @@ int g(int);
 int h(int);
 int j(int);
 int k(int);
+int l(int);
+int m(int);
+int n(int);
 
 int a(int i)
 {
@@ -86,6 +89,25 @@ int j(int i)
 
 /* k is not defined */
 
+/*
+  m and n are mutually recursive, and call nothing else, so there is no
+  path from them to a function without callees
+*/
+int l(int i)
+{
+    return m(i);
+}
+
+int m(int i)
+{
+    return i ? n(i - 1) : 0;
+}
+
+int n(int i)
+{
+    return i ? m(i - 1) : 1;
+}
+
 /*
   PEP-7
 Local variables:
@@ -36,6 +36,12 @@ def on_pass_execution(p, fn):
 
         assert index['j'] < index['f']
 
+        # m and n can't reach a function without callees, but must still be
+        # listed:
+        assert 'm' in index
+        assert 'n' in index
+        assert index['l'] < index['m']
+
 
 
 gcc.register_callback(gcc.PLUGIN_PASS_EXECUTION,
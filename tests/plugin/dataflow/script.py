@@ -0,0 +1,105 @@
+# -*- coding: utf-8 -*-
+#   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2012 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+# Verify the dataflow problems in gccutils.graph.dataflow on a real
+# function, both before and after it is converted to SSA form (where the
+# parameters are read through their default definitions, e.g. "p_1(D)")
+
+import gcc
+
+from gccutils.graph.stmtgraph import StmtGraph
+from gccutils.graph.dataflow import solve, \
+    get_defined_variable, get_used_variables, \
+    ReachingDefinitions, Liveness, MaybeNull
+
+def get_name(var):
+    # The name of the underlying declaration, dropping any SSA version:
+    if isinstance(var, gcc.SsaName):
+        var = var.var
+    return getattr(var, 'name', None)
+
+def get_names(vars_):
+    return sorted(set([name for name in map(get_name, vars_)
+                       if name is not None]))
+
+def find_node(graph, predicate):
+    nodes = [node for node in graph.nodes
+             if node.stmt is not None and predicate(node.stmt)]
+    assert len(nodes) == 1
+    return nodes[0]
+
+def is_call_to_get(stmt):
+    return (isinstance(stmt, gcc.GimpleCall)
+            and stmt.fndecl and stmt.fndecl.name == 'get')
+
+def is_copy_of_p(stmt):
+    return (isinstance(stmt, gcc.GimpleAssign)
+            and get_name(stmt.lhs) == 'q'
+            and get_name(stmt.rhs[0]) == 'p')
+
+def is_deref(stmt):
+    return (isinstance(stmt, gcc.GimpleAssign)
+            and isinstance(stmt.rhs[0], gcc.MemRef))
+
+class TestDataflow(gcc.GimplePass):
+    def execute(self, fun):
+        print('%s:' % self.name)
+        graph = StmtGraph(fun, split_phi_nodes=False)
+        n_get = find_node(graph, is_call_to_get)
+        n_copy = find_node(graph, is_copy_of_p)
+        n_deref = find_node(graph, is_deref)
+
+        print('  defined by "q = get ()": %s'
+              % get_name(get_defined_variable(n_get)))
+        print('  defined by "q = p": %s'
+              % get_name(get_defined_variable(n_copy)))
+        print('  used by "q = p": %s'
+              % get_names(get_used_variables(n_copy)))
+        print('  used by the dereference: %s'
+              % get_names(get_used_variables(n_deref)))
+
+        # Before SSA, both assignments to q reach the dereference; after,
+        # it reads the single SSA name defined by the PHI node merging them:
+        rd = ReachingDefinitions(graph)
+        result = solve(rd, graph)
+        deref_var = get_used_variables(n_deref)[0]
+        defs = rd.get_definitions(result, n_deref, deref_var)
+        print('  definitions of q reaching the dereference: %i' % len(defs))
+
+        lv = Liveness(graph)
+        result = solve(lv, graph)
+        print('  live before "q = get ()": %s'
+              % get_names(lv.get_live_before(result, n_get)))
+        print('  live after the dereference: %s'
+              % get_names(lv.get_live_after(result, n_deref)))
+
+        mn = MaybeNull(graph)
+        result = solve(mn, graph)
+        p = get_used_variables(n_copy)[0]
+        print('  p may be NULL on entry: %s'
+              % ('p' in get_names(mn.get_maybe_null(result, graph.entry))))
+        print('  p is non-NULL at "q = p": %s'
+              % mn.is_nonnull(result, n_copy, p))
+        print('  q is non-NULL at the dereference: %s'
+              % mn.is_nonnull(result, n_deref, deref_var))
+
+ps = TestDataflow(name='test-dataflow-cfg')
+ps.register_after('cfg')
+
+ps = TestDataflow(name='test-dataflow-ssa')
+ps.register_after('ssa')
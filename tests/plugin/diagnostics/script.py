@@ -59,6 +59,19 @@ def on_pass_execution(p, fn):
         else:
             raise RuntimeError('expected exception was not raised')
 
+        # Verify that bad arguments are rejected with a TypeError (the
+        # messages vary between Python versions, so aren't checked):
+        for args, kwargs in [((fn.end, ), {}),
+                             (('not a location', 'message'), {}),
+                             ((fn.end, 'message'), {'bogus': 1}),
+                             ((fn.end, 'message'), {'location': fn.end})]:
+            try:
+                gcc.warning(*args, **kwargs)
+            except TypeError:
+                pass
+            else:
+                raise RuntimeError('expected exception was not raised')
+
         # Exercise gcc.inform:
         gcc.inform(fn.start, 'This is the start of the function')
         gcc.inform(fn.end, 'This is the end of the function')
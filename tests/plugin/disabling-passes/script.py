@@ -0,0 +1,51 @@
+#   Copyright 2011 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2011 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+import gcc
+
+# Verify that a pass can be disabled via its "enabled" attribute:
+class SelfDisablingPass(gcc.GimplePass):
+    def execute(self, fun):
+        print('within SelfDisablingPass.execute for %r' % fun)
+        # Nothing more to do in this unit; don't call us again:
+        self.enabled = False
+        print('ps1.enabled: %r' % self.enabled)
+
+ps1 = SelfDisablingPass(name='self-disabling-pass')
+print('ps1.enabled: %r' % ps1.enabled)
+ps1.register_after('cfg')
+
+class DisabledPass(gcc.GimplePass):
+    def gate(self, fun):
+        # This shouldn't get called, since the pass is disabled
+        print('within DisabledPass.gate for %r' % fun)
+        return True
+
+    def execute(self, fun):
+        # Likewise:
+        print('within DisabledPass.execute for %r' % fun)
+
+ps2 = DisabledPass(name='disabled-pass')
+ps2.register_after('cfg')
+ps2.enabled = False
+print('ps2.enabled: %r' % ps2.enabled)
+
+# Verify that re-enabling works:
+ps2.enabled = True
+print('ps2.enabled: %r' % ps2.enabled)
+ps2.enabled = False
+print('ps2.enabled: %r' % ps2.enabled)
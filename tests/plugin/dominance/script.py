@@ -0,0 +1,84 @@
+#   Copyright 2012 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2012 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+# Verify the dominance and loop information exposed on gcc.BasicBlock and
+# gcc.Function
+
+import gcc
+
+def on_pass_execution(p, fn):
+    if p.name == '*warn_function_return':
+        entry = fn.cfg.entry
+        exit = fn.cfg.exit
+        blocks = list(fn.cfg.basic_blocks)
+        print('entry.idom: %r' % entry.idom)
+        print('exit.ipostdom: %r' % exit.ipostdom)
+
+        for bb in blocks:
+            assert bb.dominated_by(bb)
+            assert bb.dominated_by(entry)
+            assert bb.postdominated_by(bb)
+            assert bb.postdominated_by(exit)
+            if bb != entry:
+                assert bb.dominated_by(bb.idom)
+                assert bb in bb.idom.dom_children
+                assert not bb.idom.dominated_by(bb)
+            if bb != exit:
+                assert bb.postdominated_by(bb.ipostdom)
+                assert bb in bb.ipostdom.postdom_children
+
+        # The dominator tree, in preorder:
+        tree = list(entry.iter_dominated())
+        assert tree[0] == entry
+        assert sorted([bb.index for bb in tree]) == \
+            sorted([bb.index for bb in blocks])
+        for i, bb in enumerate(tree):
+            if bb != entry:
+                assert bb.idom in tree[:i]
+
+        # Only the outermost loop is listed; the other is nested within it:
+        print('len(fn.loops): %r' % len(fn.loops))
+        outer = fn.loops[0]
+        print('outer: %r' % outer)
+        print('outer.depth: %r' % outer.depth)
+        print('outer.outer: %r' % outer.outer)
+        print('len(outer.inner): %r' % len(outer.inner))
+        inner = outer.inner[0]
+        print('inner.depth: %r' % inner.depth)
+        print('inner.inner: %r' % inner.inner)
+        assert inner.outer == outer
+        assert inner.num != outer.num
+
+        for loop in (outer, inner):
+            print('len(%s.exits): %r'
+                  % ('outer' if loop == outer else 'inner', len(loop.exits)))
+            assert loop.blocks[0] == loop.header
+            for bb in loop.blocks:
+                assert bb.dominated_by(loop.header)
+            if loop.latch:
+                assert loop.latch in loop.blocks
+            for edge in loop.exits:
+                assert edge.src in loop.blocks
+                assert edge.dest not in loop.blocks
+
+        # The blocks of the inner loop are also within the outer one:
+        for bb in inner.blocks:
+            assert bb in outer.blocks
+        assert len(inner.blocks) < len(outer.blocks)
+
+gcc.register_callback(gcc.PLUGIN_PASS_EXECUTION,
+                      on_pass_execution)
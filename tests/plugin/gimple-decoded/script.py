@@ -0,0 +1,60 @@
+#   Copyright 2011 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2011 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+# Verify the behavior of gcc.GimpleAssign.decoded and gcc.GimpleCall.decoded
+
+import gcc
+
+def on_pass_execution(p, fn):
+    if p.name == '*warn_function_return':
+        for bb in fn.cfg.basic_blocks:
+            for stmt in bb.gimple or []:
+                if not isinstance(stmt, (gcc.GimpleAssign, gcc.GimpleCall)):
+                    continue
+                d = stmt.decoded
+                print(type(stmt).__name__)
+                print('  type(d).__name__: %r' % type(d).__name__)
+                print('  d.exprcode.__name__: %r' % d.exprcode.__name__)
+                print('  len(d.rhs): %r' % len(d.rhs))
+                if d.args is None:
+                    print('  d.args: None')
+                else:
+                    print('  len(d.args): %r' % len(d.args))
+                print('  d.noreturn: %r' % d.noreturn)
+
+                # Same values as the individual attributes:
+                assert d.loc == stmt.loc
+                assert d.exprcode == stmt.exprcode
+                assert d.lhs == stmt.lhs
+                assert list(d.rhs) == stmt.rhs
+                assert d.stmt == stmt
+                if isinstance(stmt, gcc.GimpleCall):
+                    assert d.fn == stmt.fn
+                    assert d.fndecl == stmt.fndecl
+                    assert list(d.args) == stmt.args
+                    assert d.noreturn == stmt.noreturn
+
+                assert type(d) is gcc.DecodedGimple
+
+                # Unpacks like a tuple:
+                loc, exprcode, lhs, rhs, fn, fndecl, args, noreturn = d
+
+                # Memoized within the pass:
+                assert stmt.decoded is d
+
+gcc.register_callback(gcc.PLUGIN_PASS_EXECUTION,
+                      on_pass_execution)
@@ -0,0 +1,58 @@
+#   Copyright 2011 David Malcolm <dmalcolm@redhat.com>
+#   Copyright 2011 Red Hat, Inc.
+#
+#   This is free software: you can redistribute it and/or modify it
+#   under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+
+# Verify the behavior of gcc.WrapperSequence
+
+import gcc
+
+def on_pass_execution(p, fn):
+    if p.name == '*warn_function_return':
+        blocks = fn.cfg.basic_blocks
+        print('type(blocks).__name__: %r' % type(blocks).__name__)
+        assert len(blocks) >= 3
+        assert blocks[0] == fn.cfg.entry
+        assert blocks[-1] == blocks[len(blocks) - 1]
+        assert list(blocks) == blocks[:]
+        assert list(blocks) == blocks
+
+        # Repeated access within the pass gives the same sequence:
+        assert fn.cfg.basic_blocks is blocks
+
+        laststmt = None
+        for bb in blocks:
+            if bb.gimple:
+                stmts = bb.gimple
+                assert bb.gimple is stmts
+                assert len(stmts) == len(list(stmts))
+                assert stmts[0] is stmts[0]
+                assert repr(stmts) == repr(list(stmts))
+                try:
+                    stmts[len(stmts)]
+                except IndexError:
+                    pass
+                else:
+                    raise AssertionError('expected IndexError')
+                laststmt = stmts[-1]
+        print('laststmt: %r' % laststmt)
+
+        # Empty sequences are false:
+        print('bool(fn.cfg.entry.gimple): %r' % bool(fn.cfg.entry.gimple))
+        print('fn.cfg.entry.gimple == []: %r' % (fn.cfg.entry.gimple == []))
+
+gcc.register_callback(gcc.PLUGIN_PASS_EXECUTION,
+                      on_pass_execution)